@@ -0,0 +1,70 @@
+/*
+ ESPiLight deep sleep example: listens for some time after every wake and
+ keeps the protocol tables and the repeat detection in the RTC memory
+ during deep sleep (see ESPiLight::saveState()). On the ESP8266, GPIO16
+ has to be connected to RST for the wake.
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+#include <tools/statestore.h>
+
+#define RECEIVER_PIN 4  // any intterupt able pin
+#define TRANSMITTER_PIN -1
+#define LISTEN_TIME 2000     // ms
+#define SLEEP_TIME 10000000  // us
+
+ESPiLight *rf;  // constructed after the warm start
+RtcStateStore store;
+
+// callback function. It is called on successfully received and parsed rc signal
+void rfCallback(const String &protocol, const String &message, int status,
+                size_t repeats, const String &deviceID) {
+  Serial.print("RF signal arrived [");
+  Serial.print(protocol);  // protocoll used to parse
+  Serial.print("][");
+  Serial.print(deviceID);  // value of id key in json message
+  Serial.print("] (");
+  Serial.print(status);  // status of message, depending on repeat, either:
+                         // FIRST   - first message of this protocoll within the
+                         //           last 0.5 s
+                         // INVALID - message repeat is not equal to the
+                         //           previous message
+                         // VALID   - message is equal to the previous message
+                         // KNOWN   - repeat of a already valid message
+  Serial.print(") ");
+  Serial.print(message);  // message in json format
+  Serial.println();
+
+  // check if message is valid and process it
+  if (status == VALID) {
+    Serial.print("Valid message: [");
+    Serial.print(protocol);
+    Serial.print("] ");
+    Serial.print(message);
+    Serial.println();
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  // the snapshot is invalid after power on, then the protocols are
+  // initialized as usual
+  if (ESPiLight::restoreState(store, SLEEP_TIME) < 0) {
+    ESPiLight::limitProtocols("[\"arctech_switch\",\"elro_800_switch\"]");
+  }
+  rf = new ESPiLight(TRANSMITTER_PIN);
+  rf->setCallback(rfCallback);
+  rf->initReceiver(RECEIVER_PIN);
+}
+
+void loop() {
+  // process input queue and may fire calllback
+  rf->loop();
+  if (millis() > LISTEN_TIME) {
+    rf->saveState(store);
+    ESP.deepSleep(SLEEP_TIME);
+  }
+  delay(10);
+}
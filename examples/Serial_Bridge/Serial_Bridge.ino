@@ -0,0 +1,37 @@
+/*
+ ESPiLight serial bridge example: streams received pulse trains and
+ decoded messages in a binary framing to the host and transmits its
+ commands (see tools/serialbridge.h and extras/host/bridge)
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+#include <tools/serialbridge.h>
+
+#define RECEIVER_PIN 4  // any intterupt able pin
+#define TRANSMITTER_PIN 13
+
+ESPiLight rf(TRANSMITTER_PIN);  // use -1 to disable transmitter
+SerialBridge bridge(Serial, rf);
+
+void setup() {
+  Serial.begin(115200);
+  // the binary frames need Serial alone, write the pilight messages to
+  // Serial1 (TX only on GPIO2 of the ESP8266)
+  Serial1.begin(115200);
+  ESPiLight::setErrorOutput(Serial1);
+  // frames are written only with credits of the host
+  rf.setCallback(bridge.callback());
+  rf.setPulseTrainCallBack(bridge.pulseTrainCallback());
+  // inittilize receiver
+  rf.initReceiver(RECEIVER_PIN);
+}
+
+void loop() {
+  // process input queue and may fire calllback
+  rf.loop();
+  // execute commands of the host and write the batched frames
+  bridge.loop();
+  delay(10);
+}
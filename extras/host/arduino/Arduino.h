@@ -0,0 +1,82 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+/*
+  Minimal Arduino API for host builds (see "Host build" in README.md).
+  Only the parts used by ESPiLight and the host tools are provided.
+*/
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
+
+#include "Esp.h"
+#include "Print.h"
+#include "Stream.h"
+#include "WString.h"
+#include "pgmspace.h"
+
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define CHANGE 3
+#define NOT_AN_INTERRUPT -1
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+
+#define interrupts()
+#define noInterrupts()
+
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(uint8_t interrupt, void (*handler)(void), int mode);
+void detachInterrupt(uint8_t interrupt);
+
+class HardwareSerial : public Stream {
+ public:
+  void begin(unsigned long baud) { (void)baud; }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  int available() override;
+  int read() override;
+  int peek() override;
+  using Print::write;
+
+ private:
+  int _peeked = -1;
+};
+
+extern HardwareSerial Serial;
+
+#endif  // ARDUINO_H
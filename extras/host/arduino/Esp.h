@@ -0,0 +1,45 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef ESP_H
+#define ESP_H
+
+#include <stdint.h>
+
+class EspClass {
+ public:
+  /**
+   * Terminates the host program.
+   */
+  void restart();
+
+  /**
+   * Returns: HOST_HEAP_SIZE minus the heap in use (see host.h)
+   */
+  uint32_t getFreeHeap();
+
+  /**
+   * Returns: time stamp counter, or nanoseconds if not available
+   */
+  uint32_t getCycleCount();
+};
+
+extern EspClass ESP;
+
+#endif  // ESP_H
@@ -0,0 +1,90 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include "Print.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "WString.h"
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::print(const String &str) {
+  return write(str.c_str(), str.length());
+}
+
+size_t Print::print(long n, int base) {
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), base == 16 ? "%lx" : "%ld", n);
+  return write(buffer);
+}
+
+size_t Print::print(unsigned long n, int base) {
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), base == 16 ? "%lx" : "%lu", n);
+  return write(buffer);
+}
+
+size_t Print::print(long long n, int base) {
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), base == 16 ? "%llx" : "%lld", n);
+  return write(buffer);
+}
+
+size_t Print::print(unsigned long long n, int base) {
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), base == 16 ? "%llx" : "%llu", n);
+  return write(buffer);
+}
+
+size_t Print::print(double n, int digits) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+  return write(buffer);
+}
+
+size_t Print::printf(const char *format, ...) {
+  char temp[64];
+  char *buffer = temp;
+  va_list arg;
+  va_start(arg, format);
+  int len = vsnprintf(temp, sizeof(temp), format, arg);
+  va_end(arg);
+  if (len < 0) {
+    return 0;
+  }
+  if ((size_t)len > sizeof(temp) - 1) {
+    buffer = new char[len + 1];
+    va_start(arg, format);
+    vsnprintf(buffer, len + 1, format, arg);
+    va_end(arg);
+  }
+  size_t n = write((const uint8_t *)buffer, (size_t)len);
+  if (buffer != temp) {
+    delete[] buffer;
+  }
+  return n;
+}
@@ -0,0 +1,79 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef PRINT_H
+#define PRINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+class String;
+class __FlashStringHelper;
+#define F(string_literal) \
+  (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) {
+    return write((const uint8_t *)str, strlen(str));
+  }
+  size_t write(const char *buffer, size_t size) {
+    return write((const uint8_t *)buffer, size);
+  }
+
+  size_t print(const __FlashStringHelper *str) {
+    return write(reinterpret_cast<const char *>(str));
+  }
+  size_t print(const String &str);
+  size_t print(const char *str) { return write(str); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char n, int base = 10) {
+    return print((unsigned long)n, base);
+  }
+  size_t print(int n, int base = 10) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = 10) {
+    return print((unsigned long)n, base);
+  }
+  size_t print(long n, int base = 10);
+  size_t print(unsigned long n, int base = 10);
+  size_t print(long long n, int base = 10);
+  size_t print(unsigned long long n, int base = 10);
+  size_t print(double n, int digits = 2);
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T &value) {
+    size_t n = print(value);
+    return n + println();
+  }
+  template <typename T>
+  size_t println(const T &value, int format) {
+    size_t n = print(value, format);
+    return n + println();
+  }
+
+  size_t printf(const char *format, ...)
+      __attribute__((format(printf, 2, 3)));
+};
+
+#endif  // PRINT_H
@@ -0,0 +1,192 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include "WString.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+String::String(const char *cstr) : _buffer(nullptr), _capacity(0), _length(0) {
+  if (cstr != nullptr) {
+    concat(cstr, (unsigned int)strlen(cstr));
+  }
+}
+
+String::String(const String &str)
+    : _buffer(nullptr), _capacity(0), _length(0) {
+  concat(str.c_str(), str.length());
+}
+
+String::String(String &&str)
+    : _buffer(str._buffer), _capacity(str._capacity), _length(str._length) {
+  str._buffer = nullptr;
+  str._capacity = 0;
+  str._length = 0;
+}
+
+String::String(char c) : _buffer(nullptr), _capacity(0), _length(0) {
+  concat(&c, 1);
+}
+
+String::String(int value) : String((long)value) {}
+
+String::String(unsigned int value) : String((unsigned long)value) {}
+
+String::String(long value) : _buffer(nullptr), _capacity(0), _length(0) {
+  char buffer[24];
+  concat(buffer, (unsigned int)snprintf(buffer, sizeof(buffer), "%ld", value));
+}
+
+String::String(unsigned long value)
+    : _buffer(nullptr), _capacity(0), _length(0) {
+  char buffer[24];
+  concat(buffer, (unsigned int)snprintf(buffer, sizeof(buffer), "%lu", value));
+}
+
+String::~String() { free(_buffer); }
+
+String &String::operator=(const String &str) {
+  if (this != &str) {
+    _length = 0;
+    concat(str.c_str(), str.length());
+  }
+  return *this;
+}
+
+String &String::operator=(String &&str) {
+  if (this != &str) {
+    free(_buffer);
+    _buffer = str._buffer;
+    _capacity = str._capacity;
+    _length = str._length;
+    str._buffer = nullptr;
+    str._capacity = 0;
+    str._length = 0;
+  }
+  return *this;
+}
+
+String &String::operator=(const char *cstr) {
+  _length = 0;
+  concat(cstr, (unsigned int)strlen(cstr));
+  return *this;
+}
+
+bool String::reserve(unsigned int size) {
+  if ((_buffer != nullptr) && (_capacity >= size)) {
+    return true;
+  }
+  char *buffer = (char *)realloc(_buffer, size + 1);
+  if (buffer == nullptr) {
+    return false;
+  }
+  if (_buffer == nullptr) {
+    buffer[0] = '\0';
+  }
+  _buffer = buffer;
+  _capacity = size;
+  return true;
+}
+
+bool String::concat(const char *cstr, unsigned int length) {
+  if (!reserve(_length + length)) {
+    return false;
+  }
+  memcpy(_buffer + _length, cstr, length);
+  _length += length;
+  _buffer[_length] = '\0';
+  return true;
+}
+
+String &String::operator+=(const String &str) {
+  concat(str.c_str(), str.length());
+  return *this;
+}
+
+String &String::operator+=(const char *cstr) {
+  concat(cstr, (unsigned int)strlen(cstr));
+  return *this;
+}
+
+String &String::operator+=(char c) {
+  concat(&c, 1);
+  return *this;
+}
+
+String &String::operator+=(int value) { return *this += String(value); }
+
+String &String::operator+=(unsigned int value) {
+  return *this += String(value);
+}
+
+String &String::operator+=(long value) { return *this += String(value); }
+
+String &String::operator+=(unsigned long value) {
+  return *this += String(value);
+}
+
+char String::operator[](unsigned int index) const {
+  return index < _length ? _buffer[index] : '\0';
+}
+
+bool String::operator==(const String &str) const {
+  return (_length == str._length) && (strcmp(c_str(), str.c_str()) == 0);
+}
+
+bool String::operator==(const char *cstr) const {
+  return strcmp(c_str(), cstr) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  for (unsigned int i = from; i < _length; i++) {
+    if (_buffer[i] == c) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+String String::substring(unsigned int from) const {
+  return substring(from, _length);
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  String str;
+  if (from > to) {
+    unsigned int tmp = from;
+    from = to;
+    to = tmp;
+  }
+  if (from < _length) {
+    if (to > _length) {
+      to = _length;
+    }
+    str.concat(_buffer + from, to - from);
+  }
+  return str;
+}
+
+long String::toInt() const { return atol(c_str()); }
+
+String operator+(const String &lhs, const String &rhs) {
+  String str(lhs);
+  str += rhs;
+  return str;
+}
@@ -0,0 +1,77 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef WSTRING_H
+#define WSTRING_H
+
+#include <stddef.h>
+
+/*
+  Like the Arduino String, the content is always stored on the heap, so
+  allocation counts of host builds are comparable.
+*/
+class String {
+ public:
+  String(const char *cstr = "");
+  String(const String &str);
+  String(String &&str);
+  explicit String(char c);
+  explicit String(int value);
+  explicit String(unsigned int value);
+  explicit String(long value);
+  explicit String(unsigned long value);
+  ~String();
+
+  String &operator=(const String &str);
+  String &operator=(String &&str);
+  String &operator=(const char *cstr);
+
+  const char *c_str() const { return _buffer != nullptr ? _buffer : ""; }
+  unsigned int length() const { return _length; }
+  bool reserve(unsigned int size);
+
+  bool concat(const char *cstr, unsigned int length);
+  String &operator+=(const String &str);
+  String &operator+=(const char *cstr);
+  String &operator+=(char c);
+  String &operator+=(int value);
+  String &operator+=(unsigned int value);
+  String &operator+=(long value);
+  String &operator+=(unsigned long value);
+
+  char operator[](unsigned int index) const;
+  bool operator==(const String &str) const;
+  bool operator==(const char *cstr) const;
+  bool operator!=(const String &str) const { return !(*this == str); }
+  bool operator!=(const char *cstr) const { return !(*this == cstr); }
+
+  int indexOf(char c, unsigned int from = 0) const;
+  String substring(unsigned int from) const;
+  String substring(unsigned int from, unsigned int to) const;
+  long toInt() const;
+
+ private:
+  char *_buffer;
+  unsigned int _capacity;
+  unsigned int _length;
+};
+
+String operator+(const String &lhs, const String &rhs);
+
+#endif  // WSTRING_H
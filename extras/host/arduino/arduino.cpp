@@ -0,0 +1,132 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include <Arduino.h>
+
+#include <poll.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "host.h"
+
+static const std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+
+unsigned long micros() {
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+unsigned long millis() { return micros() / 1000; }
+
+void delay(unsigned long ms) { usleep((useconds_t)(ms * 1000)); }
+
+void delayMicroseconds(unsigned int us) {
+  const unsigned long begin = micros();
+  while (micros() - begin < us) {
+  }
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  (void)pin;
+  (void)val;
+}
+
+int digitalRead(uint8_t pin) {
+  (void)pin;
+  return LOW;
+}
+
+int digitalPinToInterrupt(uint8_t pin) {
+  (void)pin;
+  return NOT_AN_INTERRUPT;  // call ESPiLight::interruptHandler() yourself
+}
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(void), int mode) {
+  (void)interrupt;
+  (void)handler;
+  (void)mode;
+}
+
+void detachInterrupt(uint8_t interrupt) { (void)interrupt; }
+
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  return fwrite(buffer, 1, size, stdout);
+}
+
+int HardwareSerial::available() {
+  if (_peeked >= 0) {
+    return 1;
+  }
+  struct pollfd fds = {STDIN_FILENO, POLLIN, 0};
+  return poll(&fds, 1, 0) > 0 ? 1 : 0;
+}
+
+int HardwareSerial::read() {
+  const int c = peek();
+  _peeked = -1;
+  return c;
+}
+
+int HardwareSerial::peek() {
+  if ((_peeked < 0) && available()) {
+    uint8_t c;
+    if (::read(STDIN_FILENO, &c, 1) == 1) {
+      _peeked = c;
+    }
+  }
+  return _peeked;
+}
+
+EspClass ESP;
+
+void EspClass::restart() {
+  fflush(stdout);
+  _exit(EXIT_FAILURE);
+}
+
+uint32_t EspClass::getFreeHeap() {
+  const size_t used = host_heap_stats().inUse;
+  return used < HOST_HEAP_SIZE ? (uint32_t)(HOST_HEAP_SIZE - used) : 0;
+}
+
+uint32_t EspClass::getCycleCount() {
+#if defined(__x86_64__) || defined(__i386__)
+  return (uint32_t)__rdtsc();
+#else
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+#endif
+}
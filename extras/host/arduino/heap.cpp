@@ -0,0 +1,110 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+/*
+  Count heap usage by wrapping the glibc allocator.
+*/
+
+#include <malloc.h>
+#include <stdlib.h>
+
+#include "host.h"
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+}
+
+static HostHeapStats_t heap_stats = {};
+
+static void heap_add(void *ptr, size_t size) {
+  if (ptr == nullptr) {
+    return;
+  }
+  const size_t usable = malloc_usable_size(ptr);
+  __atomic_add_fetch(&heap_stats.allocations, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&heap_stats.allocated, size, __ATOMIC_RELAXED);
+  const size_t used =
+      __atomic_add_fetch(&heap_stats.inUse, usable, __ATOMIC_RELAXED);
+  size_t peak = __atomic_load_n(&heap_stats.peak, __ATOMIC_RELAXED);
+  while ((used > peak) &&
+         !__atomic_compare_exchange_n(&heap_stats.peak, &peak, used, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
+
+static void heap_remove(void *ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  __atomic_add_fetch(&heap_stats.frees, 1, __ATOMIC_RELAXED);
+  __atomic_sub_fetch(&heap_stats.inUse, malloc_usable_size(ptr),
+                     __ATOMIC_RELAXED);
+}
+
+extern "C" {
+
+void *malloc(size_t size) {
+  void *ptr = __libc_malloc(size);
+  heap_add(ptr, size);
+  return ptr;
+}
+
+void *calloc(size_t nmemb, size_t size) {
+  void *ptr = __libc_calloc(nmemb, size);
+  heap_add(ptr, nmemb * size);
+  return ptr;
+}
+
+void *realloc(void *ptr, size_t size) {
+  heap_remove(ptr);
+  void *nptr = __libc_realloc(ptr, size);
+  if ((nptr == nullptr) && (size > 0)) {
+    heap_add(ptr, 0);  // ptr is still valid
+    return nullptr;
+  }
+  heap_add(nptr, size);
+  return nptr;
+}
+
+void free(void *ptr) {
+  heap_remove(ptr);
+  __libc_free(ptr);
+}
+
+}  // extern "C"
+
+HostHeapStats_t host_heap_stats() {
+  HostHeapStats_t stats;
+  stats.allocations =
+      __atomic_load_n(&heap_stats.allocations, __ATOMIC_RELAXED);
+  stats.frees = __atomic_load_n(&heap_stats.frees, __ATOMIC_RELAXED);
+  stats.allocated = __atomic_load_n(&heap_stats.allocated, __ATOMIC_RELAXED);
+  stats.inUse = __atomic_load_n(&heap_stats.inUse, __ATOMIC_RELAXED);
+  stats.peak = __atomic_load_n(&heap_stats.peak, __ATOMIC_RELAXED);
+  return stats;
+}
+
+void host_heap_reset_peak() {
+  __atomic_store_n(&heap_stats.peak,
+                   __atomic_load_n(&heap_stats.inUse, __ATOMIC_RELAXED),
+                   __ATOMIC_RELAXED);
+}
@@ -0,0 +1,44 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stddef.h>
+
+/*
+  Host only extensions to measure the library.
+*/
+
+#ifndef HOST_HEAP_SIZE
+#define HOST_HEAP_SIZE 81920  // emulated free heap of ESP.getFreeHeap()
+#endif
+
+typedef struct HostHeapStats_t {
+  unsigned long allocations;  // number of malloc/calloc/realloc calls
+  unsigned long frees;
+  size_t allocated;  // bytes requested in total
+  size_t inUse;      // bytes currently allocated
+  size_t peak;       // maximum of inUse since host_heap_reset_peak()
+} HostHeapStats_t;
+
+HostHeapStats_t host_heap_stats();
+void host_heap_reset_peak();
+
+#endif  // HOST_H
@@ -0,0 +1,266 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+/*
+  Decode throughput benchmark of the host build.
+
+  Usage: bench [-n iterations] [-s json|prometheus] [corpus]
+
+  Every line of the corpus is either a pulse train in the pilight USB Nano
+  format ("c:...;p:...@") or a protocol name followed by a json message,
+  which is turned into a pulse train with ESPiLight::createPulseTrain().
+  Empty lines and lines starting with '#' are ignored. Without corpus, a
+  built-in set of frames is used.
+*/
+
+#include <ESPiLight.h>
+#include <host.h>
+
+extern "C" {
+#include <pilight/libs/pilight/protocols/protocol.h>
+}
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char *const default_corpus[] = {
+    "elro_800_switch {\"systemcode\":17,\"unitcode\":1,\"on\":1}",
+    "elro_800_switch {\"systemcode\":17,\"unitcode\":1,\"off\":1}",
+    "arctech_switch {\"id\":100,\"unit\":1,\"on\":1}",
+    "arctech_screen {\"id\":100,\"unit\":1,\"down\":1}",
+    "mumbi {\"systemcode\":17,\"unitcode\":1,\"on\":1}",
+    "c:10011001100101010101100110011001100101011002;p:300,900,10200@",
+};
+
+struct Frame {
+  std::string name;
+  std::string json;  // empty for raw pulse trains
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  uint8_t length;
+};
+
+class NullPrint : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    (void)c;
+    return 1;
+  }
+  using Print::write;
+};
+
+double elapsed_ns(std::chrono::steady_clock::time_point start) {
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+bool load_frame(const std::string &line, Frame &frame) {
+  int length;
+  if (line.compare(0, 2, "c:") == 0) {
+    frame.name = "raw";
+    frame.json.clear();
+    length = ESPiLight::stringToPulseTrain(line.c_str(), line.size(),
+                                           frame.pulses, MAXPULSESTREAMLENGTH);
+  } else {
+    const size_t split = line.find(' ');
+    if (split == std::string::npos) {
+      return false;
+    }
+    frame.name = line.substr(0, split);
+    frame.json = line.substr(split + 1);
+    length = ESPiLight::createPulseTrain(frame.pulses, frame.name.c_str(),
+                                         frame.json.c_str());
+  }
+  if (length <= 0) {
+    fprintf(stderr, "skipping frame (error %d): %s\n", length, line.c_str());
+    return false;
+  }
+  frame.length = (uint8_t)length;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned long iterations = 1000;
+  int stats = -1;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+    if (opt == 'n') {
+      iterations = strtoul(optarg, nullptr, 10);
+    } else if ((opt == 's') && (strcmp(optarg, "json") == 0)) {
+      stats = STATS_JSON;
+    } else if ((opt == 's') && (strcmp(optarg, "prometheus") == 0)) {
+      stats = STATS_PROMETHEUS;
+    } else {
+      fprintf(stderr,
+              "usage: %s [-n iterations] [-s json|prometheus] [corpus]\n",
+              argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (iterations == 0) {
+    iterations = 1;
+  }
+
+  NullPrint null;
+  ESPiLight rf(-1);
+  ESPiLight::setErrorOutput(null);
+  size_t matches = 0;
+  rf.setCallback([&matches](const String &protocol, const String &message,
+                            int status, size_t repeats,
+                            const String &deviceID) {
+    (void)protocol;
+    (void)message;
+    (void)status;
+    (void)repeats;
+    (void)deviceID;
+    matches++;
+  });
+
+  std::vector<Frame> frames;
+  Frame frame;
+  if (optind < argc) {
+    FILE *corpus = fopen(argv[optind], "r");
+    if (corpus == nullptr) {
+      perror(argv[optind]);
+      return EXIT_FAILURE;
+    }
+    char line[1024];
+    while (fgets(line, sizeof(line), corpus) != nullptr) {
+      std::string str(line);
+      str.erase(str.find_last_not_of("\r\n") + 1);
+      if (!str.empty() && (str[0] != '#') && load_frame(str, frame)) {
+        frames.push_back(frame);
+      }
+    }
+    fclose(corpus);
+  } else {
+    for (const char *line : default_corpus) {
+      if (load_frame(line, frame)) {
+        frames.push_back(frame);
+      }
+    }
+  }
+  if (frames.empty()) {
+    fprintf(stderr, "no frames to decode\n");
+    return EXIT_FAILURE;
+  }
+
+  if (stats >= 0) {
+    ESPiLight::setProtocolStatsEnabled(true);
+  }
+  printf("%-24s %6s %7s %12s %13s\n", "frame", "pulses", "matches",
+         "ns/decode", "allocs/decode");
+  double total_ns = 0;
+  unsigned long total_allocations = 0;
+  for (const Frame &f : frames) {
+    uint16_t pulses[MAXPULSESTREAMLENGTH];
+    // warm up, first decode of a protocol reports repeats
+    memcpy(pulses, f.pulses, f.length * sizeof(uint16_t));
+    rf.parsePulseTrain(pulses, f.length);
+
+    matches = 0;
+    const HostHeapStats_t heap = host_heap_stats();
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; i++) {
+      memcpy(pulses, f.pulses, f.length * sizeof(uint16_t));
+      rf.parsePulseTrain(pulses, f.length);
+    }
+    const double ns = elapsed_ns(start);
+    const unsigned long allocations =
+        host_heap_stats().allocations - heap.allocations;
+    total_ns += ns;
+    total_allocations += allocations;
+    printf("%-24s %6u %7.2f %12.0f %13.2f\n", f.name.c_str(), f.length,
+           (double)matches / iterations, ns / iterations,
+           (double)allocations / iterations);
+  }
+  const double decodes = (double)frames.size() * iterations;
+  printf("\ndecode: %.0f frames/s, %.0f ns/frame, %.2f allocs/frame\n",
+         decodes * 1e9 / total_ns, total_ns / decodes,
+         total_allocations / decodes);
+  if (stats >= 0) {
+    ESPiLight::printProtocolStats(Serial, (StatsFormat_t)stats);
+    ESPiLight::setProtocolStatsEnabled(false);
+  }
+
+  // pilight USB Nano string codec
+  char buffer[MAXPULSESTREAMLENGTH + 6 * MAX_PULSE_TYPES + 7];
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  double encode_ns = 0;
+  double decode_ns = 0;
+  for (const Frame &f : frames) {
+    auto start = std::chrono::steady_clock::now();
+    size_t size = 0;
+    for (unsigned long i = 0; i < iterations; i++) {
+      size = ESPiLight::pulseTrainToString(f.pulses, f.length, buffer,
+                                           sizeof(buffer));
+    }
+    encode_ns += elapsed_ns(start);
+    start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; i++) {
+      ESPiLight::stringToPulseTrain(buffer, size, pulses,
+                                    MAXPULSESTREAMLENGTH);
+    }
+    decode_ns += elapsed_ns(start);
+  }
+  double bits_ns = 0;
+  volatile unsigned long checksum = 0;  // keep the loop
+  for (const Frame &f : frames) {
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; i++) {
+      protocol_pulse_bits_reset();
+      const pulse_bits_t *bits = protocol_pulse_bits(f.pulses, f.length);
+      checksum += pulse_bits_to_dec(bits->pulses, 0, 23);
+    }
+    bits_ns += elapsed_ns(start);
+  }
+  printf("protocol_pulse_bits: %.0f ns/frame\n", bits_ns / decodes);
+  printf("pulseTrainToString: %.0f ns/frame\n", encode_ns / decodes);
+  printf("stringToPulseTrain: %.0f ns/frame\n", decode_ns / decodes);
+
+  double create_ns = 0;
+  unsigned long creates = 0;
+  for (const Frame &f : frames) {
+    if (f.json.empty()) {
+      continue;
+    }
+    const String protocol(f.name.c_str());
+    const String json(f.json.c_str());
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; i++) {
+      ESPiLight::createPulseTrain(pulses, protocol, json);
+    }
+    create_ns += elapsed_ns(start);
+    creates += iterations;
+  }
+  if (creates > 0) {
+    printf("createPulseTrain: %.0f ns/frame\n", create_ns / creates);
+  }
+
+  return EXIT_SUCCESS;
+}
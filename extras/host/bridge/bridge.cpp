@@ -0,0 +1,391 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+/*
+  Host side of the serial bridge (see tools/serialbridge.h).
+
+  Usage: bridge [-c credits] [-s "protocol json"] [-x pulse train]
+                [-r repeats] [-w ms] [device]
+         bridge -e [-p] [-u] [-w ms] [corpus]
+
+  Without -e, the frames of a device are read from the serial device (or
+  pseudo-terminal) or stdin and printed as text. On a device, -c credits
+  (default: 16) are granted at start and one more for every received
+  frame. -s transmits a message, -x a pulse train in the pilight USB Nano
+  format, both with -r repeats. Reading stops after -w ms (default: 1000)
+  without data.
+
+  With -e, a device is emulated: every line of the corpus (same format as
+  for bench) is decoded by ESPiLight and streamed by a SerialBridge to
+  stdout, the commands are read from stdin and the pilight messages are
+  written to stderr. -p uses a new pseudo-terminal instead, its name is
+  printed to stderr. -u disables the flow control, e.g. to pipe into the
+  reader:
+
+    bridge -e -u corpus.txt | bridge
+
+  test.sh checks the resynchronization and the credits with both modes.
+*/
+
+#include <ESPiLight.h>
+#include <tools/serialbridge.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <string>
+
+namespace {
+
+class FdStream : public Stream {
+ public:
+  FdStream(int in, int out) : _in(in), _out(out), _peek(-1), _eof(false) {}
+
+  bool eof() const { return _eof; }
+
+  // waits up to timeout ms for input
+  bool wait(int timeout) {
+    if (_peek >= 0) {
+      return true;
+    }
+    struct pollfd fd = {_in, POLLIN, 0};
+    return (poll(&fd, 1, timeout) > 0) && (fd.revents != 0);
+  }
+
+  int available() override { return (!_eof && wait(0)) ? 1 : 0; }
+  int read() override {
+    const int c = peek();
+    _peek = -1;
+    return c;
+  }
+  int peek() override {
+    uint8_t c;
+    if (_peek < 0) {
+      // EIO: the other side of a pseudo-terminal is closed
+      const ssize_t n = ::read(_in, &c, 1);
+      if (n == 1) {
+        _peek = c;
+      } else if ((n == 0) || ((errno != EAGAIN) && (errno != EINTR))) {
+        _eof = true;
+      }
+    }
+    return _peek;
+  }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size) override {
+    size_t written = 0;
+    while (written < size) {
+      const ssize_t n = ::write(_out, buffer + written, size - written);
+      if (n <= 0) {
+        break;
+      }
+      written += (size_t)n;
+    }
+    return written;
+  }
+  using Print::write;
+
+ private:
+  int _in;
+  int _out;
+  int _peek;
+  bool _eof;
+};
+
+void make_raw(int fd) {
+  struct termios tio;
+  if (isatty(fd) && (tcgetattr(fd, &tio) == 0)) {
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+}
+
+int load_pulse_train(const std::string &line, uint16_t *pulses) {
+  if (line.compare(0, 2, "c:") == 0) {
+    return ESPiLight::stringToPulseTrain(line.c_str(), line.size(), pulses,
+                                         MAXPULSESTREAMLENGTH);
+  }
+  const size_t split = line.find(' ');
+  if (split == std::string::npos) {
+    return ESPiLight::ERROR_INVALID_PILIGHT_MSG;
+  }
+  return ESPiLight::createPulseTrain(pulses,
+                                     line.substr(0, split).c_str(),
+                                     line.substr(split + 1).c_str());
+}
+
+int emulate(FILE *corpus, bool pty, bool flowControl, int idle) {
+  int in = STDIN_FILENO;
+  int out = STDOUT_FILENO;
+  int slave = -1;
+  if (pty) {
+    in = out = posix_openpt(O_RDWR | O_NOCTTY);
+    if ((in < 0) || (grantpt(in) != 0) || (unlockpt(in) != 0)) {
+      perror("posix_openpt");
+      return EXIT_FAILURE;
+    }
+    // keep the slave open and raw, the reader may reopen it
+    slave = open(ptsname(in), O_RDWR | O_NOCTTY);
+    make_raw(slave);
+    fprintf(stderr, "%s\n", ptsname(in));
+  }
+
+  // the pilight messages would corrupt the frames on stdout
+  static FdStream log(-1, STDERR_FILENO);
+  ESPiLight::setErrorOutput(log);
+  ESPiLight rf(0);
+  FdStream stream(in, out);
+  SerialBridge bridge(stream, rf);
+  bridge.setFlowControl(flowControl);
+  rf.setCallback(bridge.callback());
+  rf.setPulseTrainCallBack(bridge.pulseTrainCallback());
+
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  char line[1024];
+  while (fgets(line, sizeof(line), corpus) != nullptr) {
+    std::string str(line);
+    str.erase(str.find_last_not_of("\r\n") + 1);
+    if (str.empty() || (str[0] == '#')) {
+      continue;
+    }
+    const int length = load_pulse_train(str, pulses);
+    if (length <= 0) {
+      fprintf(stderr, "skipping frame (error %d): %s\n", length, str.c_str());
+      continue;
+    }
+    // wait for the credits of the message and the pulse train frame, like
+    // a paced transmitter
+    while (flowControl && (bridge.credits() < 2) && !stream.eof() &&
+           stream.wait(idle)) {
+      bridge.loop();
+    }
+    rf.parsePulseTrain(pulses, (uint8_t)length);
+    bridge.loop();
+  }
+  // serve the commands until the host is idle
+  while (!stream.eof() && stream.wait(idle)) {
+    bridge.loop();
+  }
+  bridge.loop();
+
+  const BridgeStats_t &stats = bridge.stats();
+  fprintf(stderr,
+          "frames: %lu, writes: %lu, dropped: %lu, commands: %lu, "
+          "errors: %lu\n",
+          stats.frames, stats.writes, stats.dropped, stats.commands,
+          stats.errors);
+  if (slave >= 0) {
+    close(slave);
+  }
+  return EXIT_SUCCESS;
+}
+
+void send_frame(FdStream &stream, uint8_t type, const uint8_t *payload,
+                size_t length) {
+  uint8_t frame[1024];
+  const size_t size =
+      encodeBridgeFrame(type, payload, length, frame, sizeof(frame));
+  if (size == 0) {
+    fprintf(stderr, "command too long\n");
+    return;
+  }
+  stream.write(frame, size);
+}
+
+void grant_credits(FdStream &stream, uint16_t credits) {
+  const uint8_t payload[2] = {(uint8_t)(credits & 0xFF),
+                              (uint8_t)(credits >> 8)};
+  send_frame(stream, BRIDGE_CREDIT, payload, sizeof(payload));
+}
+
+void print_frame(const BridgeFrameParser &parser) {
+  const uint8_t *payload = parser.payload();
+  const size_t length = parser.length();
+  switch (parser.type()) {
+    case BRIDGE_PULSETRAIN: {
+      uint16_t pulses[MAXPULSESTREAMLENGTH];
+      const int count = ESPiLight::binaryToPulseTrain(
+          payload, length, pulses, MAXPULSESTREAMLENGTH);
+      if (count > 0) {
+        printf("pulsetrain %s\n",
+               ESPiLight::pulseTrainToString(pulses, (size_t)count).c_str());
+      } else {
+        printf("pulsetrain invalid (error %d)\n", count);
+      }
+      break;
+    }
+    case BRIDGE_MESSAGE: {
+      // fields are '\0' terminated, the parser terminates the payload
+      const char *protocol = (const char *)payload + 2;
+      const char *device = protocol + strlen(protocol) + 1;
+      const char *message = device + strlen(device) + 1;
+      if ((length < 4) || (message > (const char *)payload + length)) {
+        printf("message invalid\n");
+        break;
+      }
+      printf("message [%s] (%d/%u) %s%s%s\n", protocol, (int8_t)payload[0],
+             payload[1], device, (*device != '\0') ? " " : "", message);
+      break;
+    }
+    case BRIDGE_RESULT:
+      if (length == 3) {
+        printf("result 0x%02x %d\n", payload[0],
+               (int16_t)(payload[1] | (payload[2] << 8)));
+      }
+      break;
+    default:
+      printf("unknown frame 0x%02x (%zu bytes)\n", parser.type(), length);
+      break;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  bool emulator = false;
+  bool pty = false;
+  bool flowControl = true;
+  unsigned long credits = 16;
+  unsigned long repeats = 0;
+  int idle = 1000;
+  const char *message = nullptr;
+  const char *pulseTrain = nullptr;
+  int opt;
+  while ((opt = getopt(argc, argv, "epuc:s:x:r:w:")) != -1) {
+    switch (opt) {
+      case 'e':
+        emulator = true;
+        break;
+      case 'p':
+        pty = true;
+        break;
+      case 'u':
+        flowControl = false;
+        break;
+      case 'c':
+        credits = strtoul(optarg, nullptr, 10);
+        break;
+      case 's':
+        message = optarg;
+        break;
+      case 'x':
+        pulseTrain = optarg;
+        break;
+      case 'r':
+        repeats = strtoul(optarg, nullptr, 10);
+        break;
+      case 'w':
+        idle = (int)strtol(optarg, nullptr, 10);
+        break;
+      default:
+        fprintf(stderr,
+                "usage: %s [-c credits] [-s \"protocol json\"] "
+                "[-x pulse train] [-r repeats] [-w ms] [device]\n"
+                "       %s -e [-p] [-u] [-w ms] [corpus]\n",
+                argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (emulator) {
+    FILE *corpus = stdin;
+    if (optind < argc) {
+      corpus = fopen(argv[optind], "r");
+      if (corpus == nullptr) {
+        perror(argv[optind]);
+        return EXIT_FAILURE;
+      }
+    }
+    const int result = emulate(corpus, pty, flowControl, idle);
+    if (corpus != stdin) {
+      fclose(corpus);
+    }
+    return result;
+  }
+
+  int fd = STDIN_FILENO;
+  if (optind < argc) {
+    fd = open(argv[optind], O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+      perror(argv[optind]);
+      return EXIT_FAILURE;
+    }
+    make_raw(fd);
+  } else if ((message != nullptr) || (pulseTrain != nullptr)) {
+    fprintf(stderr, "commands need a device\n");
+    return EXIT_FAILURE;
+  }
+  FdStream stream(fd, fd);
+  const bool device = (fd != STDIN_FILENO);
+  if (device && (credits > 0)) {
+    grant_credits(stream, (uint16_t)((credits > 0xFFFF) ? 0xFFFF : credits));
+  }
+  if (message != nullptr) {
+    std::string payload(1, (char)repeats);
+    payload += message;
+    const size_t split = payload.find(' ');
+    if (split != std::string::npos) {
+      payload[split] = '\0';
+    }
+    send_frame(stream, BRIDGE_SEND_MESSAGE, (const uint8_t *)payload.data(),
+               payload.size());
+  }
+  if (pulseTrain != nullptr) {
+    uint16_t pulses[MAXPULSESTREAMLENGTH];
+    uint8_t payload[512];
+    const int length = ESPiLight::stringToPulseTrain(
+        pulseTrain, strlen(pulseTrain), pulses, MAXPULSESTREAMLENGTH);
+    const size_t size = (length > 0) ? ESPiLight::pulseTrainToBinary(
+                                           pulses, (size_t)length,
+                                           payload + 1, sizeof(payload) - 1)
+                                     : 0;
+    if (size == 0) {
+      fprintf(stderr, "invalid pulse train\n");
+      return EXIT_FAILURE;
+    }
+    payload[0] = (uint8_t)repeats;
+    send_frame(stream, BRIDGE_SEND_PULSETRAIN, payload, size + 1);
+  }
+
+  BridgeFrameParser parser(0xFFFF);
+  unsigned long frames = 0;
+  while (!stream.eof() && stream.wait(idle)) {
+    const int c = stream.read();
+    if ((c < 0) || !parser.feed((uint8_t)c)) {
+      continue;
+    }
+    frames++;
+    print_frame(parser);
+    fflush(stdout);
+    if (device && (parser.type() != BRIDGE_RESULT)) {
+      grant_credits(stream, 1);
+    }
+  }
+  fprintf(stderr, "frames: %lu, errors: %lu\n", frames, parser.errors());
+  if (device) {
+    close(fd);
+  }
+  return EXIT_SUCCESS;
+}
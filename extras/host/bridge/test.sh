@@ -0,0 +1,97 @@
+#!/bin/sh
+# ESPiLight - pilight 433.92 MHz protocols library for Arduino
+# Copyright (c) 2016 Puuu.  All right reserved.
+#
+# Project home: https://github.com/puuu/espilight/
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 3 of the License, or (at your option) any later version.
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with library. If not, see <http://www.gnu.org/licenses/>
+
+# Usage: test.sh bridge
+#
+# Streams a corpus through an emulated device into the reader:
+#  - over a pipe, also with garbage and a corrupted frame, which has to be
+#    skipped without losing the following frames
+#  - over a pseudo-terminal with and without credits of the reader
+
+BRIDGE=${1:-extras/host/build/bridge}
+TMP=$(mktemp -d)
+trap 'kill $EMULATOR 2>/dev/null; rm -rf "$TMP"' EXIT
+RESULT=0
+
+check() {
+  if [ "$2" = "$3" ]; then
+    echo "$1: OK"
+  else
+    echo "$1: FAILED (expected: $3, got: $2)"
+    RESULT=1
+  fi
+}
+
+# value of name in the "name: value, ..." statistics of file
+stat() {
+  sed -n "s/.*\\b$2: \\([0-9]*\\).*/\\1/p" "$1" | tail -n 1
+}
+
+cat > "$TMP/corpus.txt" <<EOF
+c:10011001100101010101100110011001100101011002;p:300,900,10200@
+c:01100110011010101010011001100110011010100112;p:300,900,10200@
+c:10101010101010101010101010101010101010101002;p:300,900,10200@
+EOF
+
+"$BRIDGE" -e -u -w 0 "$TMP/corpus.txt" > "$TMP/frames.bin" \
+  2> "$TMP/emulator.txt" < /dev/null
+FRAMES=$(stat "$TMP/emulator.txt" frames)
+"$BRIDGE" -w 0 < "$TMP/frames.bin" > "$TMP/clean.txt" 2> "$TMP/reader.txt"
+check "pipe frames" "$(stat "$TMP/reader.txt" frames)" "$FRAMES"
+check "pipe errors" "$(stat "$TMP/reader.txt" errors)" 0
+check "pipe lines" "$(wc -l < "$TMP/clean.txt")" "$FRAMES"
+check "pipe pulse trains" "$(grep -c '^pulsetrain c:' "$TMP/clean.txt")" 3
+
+# garbage around the first frame and a flipped payload byte in it: only
+# the first frame is skipped
+FIRST=$(od -An -v -tu1 -j 2 -N 2 "$TMP/frames.bin" |
+  awk '{print 6 + $1 + 256 * $2}')
+{
+  printf 'garbage'
+  head -c 5 "$TMP/frames.bin"
+  head -c 6 "$TMP/frames.bin" | tail -c 1 | tr '\000-\377' '\001-\377\000'
+  head -c "$FIRST" "$TMP/frames.bin" | tail -c +7
+  printf 'garbage'
+  tail -c +$((FIRST + 1)) "$TMP/frames.bin"
+} > "$TMP/corrupt.bin"
+"$BRIDGE" -w 0 < "$TMP/corrupt.bin" > "$TMP/corrupt.txt" 2> "$TMP/reader.txt"
+check "resync frames" "$(stat "$TMP/reader.txt" frames)" $((FRAMES - 1))
+check "resync errors" "$(stat "$TMP/reader.txt" errors)" 1
+check "resync last frame" "$(tail -n 1 "$TMP/corrupt.txt")" \
+  "$(tail -n 1 "$TMP/clean.txt")"
+
+# the emulator waits up to -w ms for credits of every corpus line
+pty() {
+  rm -f "$TMP/emulator.txt"
+  "$BRIDGE" -e -p -w "$2" "$TMP/corpus.txt" 2> "$TMP/emulator.txt" &
+  EMULATOR=$!
+  while ! grep -q '^/dev/' "$TMP/emulator.txt" 2>/dev/null; do
+    sleep 0.1
+  done
+  "$BRIDGE" -c "$1" -w 3000 "$(grep '^/dev/' "$TMP/emulator.txt")" \
+    > "$TMP/pty.txt" 2> "$TMP/reader.txt"
+  wait $EMULATOR
+}
+
+pty 16 3000
+check "credits frames" "$(stat "$TMP/reader.txt" frames)" "$FRAMES"
+check "credits dropped" "$(stat "$TMP/emulator.txt" dropped)" 0
+pty 0 100
+check "no credits frames" "$(stat "$TMP/reader.txt" frames)" 0
+check "no credits dropped" "$(stat "$TMP/emulator.txt" dropped)" "$FRAMES"
+
+exit $RESULT
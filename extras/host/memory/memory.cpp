@@ -0,0 +1,266 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+/*
+  Memory footprint of the library for standard workloads.
+
+  Usage: memory [-w] [-t tolerance] [-b baseline] [corpus]
+
+  Runs the workloads init, decode (every frame of the corpus twice, to
+  fill the repeat detection), encode (createPulseTrain() of every json
+  frame) and limit (limitProtocols() of all protocols of the corpus) and
+  prints the numbers of ESPiLight::getMemoryUsage() and of the host heap
+  as "name value" lines. The corpus has the format of bench; without
+  corpus, a built-in set of frames is used.
+
+  With -b, the numbers are compared against the baseline file and the
+  exit status is 1 if a number is larger than the baseline plus tolerance
+  percent (default 0). Numbers missing in the baseline are not compared.
+  With -w, the baseline file is written instead.
+*/
+
+#include <ESPiLight.h>
+#include <host.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char *const default_corpus[] = {
+    "elro_800_switch {\"systemcode\":17,\"unitcode\":1,\"on\":1}",
+    "arctech_switch {\"id\":100,\"unit\":1,\"on\":1}",
+    "arctech_screen {\"id\":100,\"unit\":1,\"down\":1}",
+    "mumbi {\"systemcode\":17,\"unitcode\":1,\"on\":1}",
+    "c:10011001100101010101100110011001100101011002;p:300,900,10200@",
+};
+
+class NullPrint : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    (void)c;
+    return 1;
+  }
+  using Print::write;
+};
+
+typedef std::vector<std::pair<std::string, size_t>> Results;
+
+void add(Results &results, const char *name, size_t value) {
+  results.push_back(std::make_pair(std::string(name), value));
+}
+
+bool read_baseline(const char *path, std::map<std::string, size_t> &values) {
+  FILE *file = fopen(path, "r");
+  if (file == nullptr) {
+    perror(path);
+    return false;
+  }
+  char name[64];
+  unsigned long value;
+  while (fscanf(file, "%63s %lu", name, &value) == 2) {
+    values[name] = value;
+  }
+  fclose(file);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const char *baseline = nullptr;
+  bool write = false;
+  unsigned long tolerance = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "wt:b:")) != -1) {
+    switch (opt) {
+      case 'w':
+        write = true;
+        break;
+      case 't':
+        tolerance = strtoul(optarg, nullptr, 10);
+        break;
+      case 'b':
+        baseline = optarg;
+        break;
+      default:
+        fprintf(stderr,
+                "usage: %s [-w] [-t tolerance] [-b baseline] [corpus]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+  if (write && (baseline == nullptr)) {
+    fprintf(stderr, "-w needs a baseline file (-b)\n");
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::string> corpus;
+  if (optind < argc) {
+    FILE *file = fopen(argv[optind], "r");
+    if (file == nullptr) {
+      perror(argv[optind]);
+      return EXIT_FAILURE;
+    }
+    char line[1024];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+      std::string str(line);
+      str.erase(str.find_last_not_of("\r\n") + 1);
+      if (!str.empty() && (str[0] != '#')) {
+        corpus.push_back(str);
+      }
+    }
+    fclose(file);
+  } else {
+    corpus.assign(std::begin(default_corpus), std::end(default_corpus));
+  }
+
+  Results results;
+  NullPrint null;
+  MemoryUsage_t usage;
+
+  // init, relative to the heap of the host process (stdio, libstdc++)
+  const size_t process = host_heap_stats().inUse;
+  host_heap_reset_peak();
+  ESPiLight rf(-1);
+  ESPiLight::setErrorOutput(null);
+  rf.setCallback([](const String &protocol, const String &message, int status,
+                    size_t repeats, const String &deviceID) {
+    (void)protocol;
+    (void)message;
+    (void)status;
+    (void)repeats;
+    (void)deviceID;
+  });
+  ESPiLight::getMemoryUsage(usage, true);
+  add(results, "static.receiver", usage.receiverBytes);
+  add(results, "static.stack", usage.stackBytes);
+  add(results, "init.protocols", usage.protocols);
+  add(results, "init.protocol_bytes", usage.protocolBytes);
+  // independent of the protocols of the pilight submodule
+  const size_t protocols = (usage.protocols > 0) ? usage.protocols : 1;
+  add(results, "init.bytes_per_protocol", usage.protocolBytes / protocols);
+  add(results, "init.heap_in_use", host_heap_stats().inUse - process);
+  add(results, "init.heap_peak", host_heap_stats().peak - process);
+
+  // decode
+  std::vector<std::string> names;
+  std::vector<std::vector<uint16_t>> frames;
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  for (const std::string &line : corpus) {
+    int length;
+    if (line.compare(0, 2, "c:") == 0) {
+      length = ESPiLight::stringToPulseTrain(line.c_str(), line.size(), pulses,
+                                             MAXPULSESTREAMLENGTH);
+    } else {
+      const size_t split = line.find(' ');
+      if (split == std::string::npos) {
+        continue;
+      }
+      names.push_back(line.substr(0, split));
+      length = ESPiLight::createPulseTrain(pulses, names.back().c_str(),
+                                           line.c_str() + split + 1);
+    }
+    if (length > 0) {
+      frames.push_back(std::vector<uint16_t>(pulses, pulses + length));
+    }
+  }
+  ESPiLight::getMemoryUsage(usage, true);
+  size_t inUse = host_heap_stats().inUse;
+  host_heap_reset_peak();
+  for (int i = 0; i < 2; i++) {
+    for (const std::vector<uint16_t> &frame : frames) {
+      memcpy(pulses, frame.data(), frame.size() * sizeof(uint16_t));
+      rf.parsePulseTrain(pulses, (uint8_t)frame.size());
+    }
+  }
+  ESPiLight::getMemoryUsage(usage, true);
+  add(results, "decode.repeat_bytes", usage.repeatBytes);
+  add(results, "decode.repeat_bytes_per_protocol",
+      usage.repeatBytes / protocols);
+  add(results, "decode.transient_peak", usage.decodePeak);
+  add(results, "decode.heap_peak", host_heap_stats().peak - inUse);
+
+  // encode
+  inUse = host_heap_stats().inUse;
+  host_heap_reset_peak();
+  for (const std::string &line : corpus) {
+    const size_t split = line.find(' ');
+    if ((line.compare(0, 2, "c:") != 0) && (split != std::string::npos)) {
+      ESPiLight::createPulseTrain(pulses, line.substr(0, split).c_str(),
+                                  line.c_str() + split + 1);
+    }
+  }
+  ESPiLight::getMemoryUsage(usage, true);
+  add(results, "encode.transient_peak", usage.encodePeak);
+  add(results, "encode.heap_peak", host_heap_stats().peak - inUse);
+
+  // limit
+  String limit("[");
+  for (const std::string &name : names) {
+    if (limit.length() > 1) {
+      limit += ',';
+    }
+    limit += '"';
+    limit += name.c_str();
+    limit += '"';
+  }
+  limit += ']';
+  inUse = host_heap_stats().inUse;
+  ESPiLight::limitProtocols(limit);
+  ESPiLight::getMemoryUsage(usage);
+  add(results, "limit.filter_bytes", usage.filterBytes);
+  add(results, "limit.heap_in_use", host_heap_stats().inUse - inUse);
+  ESPiLight::limitProtocols("[]");
+
+  std::map<std::string, size_t> expected;
+  if ((baseline != nullptr) && !write && !read_baseline(baseline, expected)) {
+    return EXIT_FAILURE;
+  }
+  FILE *out = stdout;
+  if (write) {
+    out = fopen(baseline, "w");
+    if (out == nullptr) {
+      perror(baseline);
+      return EXIT_FAILURE;
+    }
+  }
+  int status = EXIT_SUCCESS;
+  for (const auto &result : results) {
+    fprintf(out, "%s %zu", result.first.c_str(), result.second);
+    const auto it = expected.find(result.first);
+    if (it != expected.end()) {
+      fprintf(out, " (baseline %zu)", it->second);
+      if (result.second * 100 > it->second * (100 + tolerance)) {
+        fprintf(out, " REGRESSION");
+        status = EXIT_FAILURE;
+      }
+    }
+    fprintf(out, "\n");
+  }
+  if (write) {
+    fclose(out);
+  }
+  return status;
+}
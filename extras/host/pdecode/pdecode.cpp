@@ -0,0 +1,438 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+/*
+  Parallel offline decoder for capture files.
+
+  Usage: pdecode [-j workers] [-b shard size] [-w warmup] [-q] file...
+    -j workers     number of worker processes (default: number of cores)
+    -b shard size  maximal shard size in bytes (default 4194304)
+    -w warmup      bytes decoded before a shard without reporting, to
+                   resynchronize receiver and repeat detection
+                   (default 65536)
+    -q             only print the statistics
+
+  A file is either an edge capture (see ESPiLight::startCapture()) or has
+  a pulse train in the pilight USB Nano format per line, optionally
+  preceded by a time stamp in us ("123456 c:...;p:...@").
+
+  The protocols keep their decoder state in globals, so every shard is
+  decoded by a forked worker process with its own copy of the library.
+  Files are split into shards at line or edge boundaries. The decoded
+  messages of all shards are merged in time stamp order and printed as
+  "time protocol status repeats message", followed by statistics per
+  protocol. Status and repeats of repeat sequences longer than the warmup
+  may differ from a sequential decode.
+*/
+
+#include <ESPiLight.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char capture_header[] = "#espilight-capture";
+
+struct Input {
+  std::string name;
+  std::string data;
+  bool capture;
+};
+
+struct Shard {
+  size_t input;
+  size_t start;  // decoding starts here (warmup)
+  size_t begin;  // messages of [begin, end) are reported
+  size_t end;
+  unsigned long time;  // time stamp at start
+  FILE *output;
+};
+
+struct Event {
+  unsigned long time;
+  size_t shard;
+  size_t seq;
+  std::string protocol;
+  int status;
+  unsigned int repeats;
+  std::string message;
+};
+
+struct ShardStats {
+  unsigned long frames;
+  unsigned long rejected;
+  unsigned long decoded;
+};
+
+class NullPrint : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    (void)c;
+    return 1;
+  }
+  using Print::write;
+};
+
+unsigned long worker_time = 0;
+
+unsigned long worker_clock() { return worker_time; }
+
+bool is_space(char c) {
+  return (c == ' ') || (c == '\n') || (c == '\r') || (c == '\t');
+}
+
+/**
+ * Move pos to the start of the next token (capture) or line.
+ */
+size_t align(const Input &input, size_t pos) {
+  const std::string &data = input.data;
+  if ((pos == 0) || (pos >= data.size())) {
+    return std::min(pos, data.size());
+  }
+  if (input.capture) {
+    // skip comment lines completely
+    size_t line = data.rfind('\n', pos - 1);
+    line = (line == std::string::npos) ? 0 : line + 1;
+    if (data[line] == '#') {
+      pos = data.find('\n', pos);
+      return (pos == std::string::npos) ? data.size() : pos + 1;
+    }
+    while ((pos < data.size()) && !is_space(data[pos - 1])) {
+      pos++;
+    }
+    return pos;
+  }
+  while ((pos < data.size()) && (data[pos - 1] != '\n')) {
+    pos++;
+  }
+  return pos;
+}
+
+/**
+ * Call edge(pos, duration) for every edge of the capture in [start, end).
+ */
+template <typename EdgeFunction>
+void for_each_edge(const std::string &data, size_t start, size_t end,
+                   EdgeFunction edge) {
+  size_t pos = start;
+  while (pos < end) {
+    const char c = data[pos];
+    if (c == '#') {
+      while ((pos < end) && (data[pos] != '\n')) {
+        pos++;
+      }
+    } else if ((c >= '0') && (c <= '9')) {
+      const size_t token = pos;
+      unsigned long value = 0;
+      while ((pos < data.size()) && (data[pos] >= '0') && (data[pos] <= '9')) {
+        value = value * 10 + (unsigned long)(data[pos] - '0');
+        pos++;
+      }
+      edge(token, value);
+    } else if (c == 'x') {
+      // lost edges, the durations are unknown
+      pos++;
+      while ((pos < data.size()) && (data[pos] >= '0') && (data[pos] <= '9')) {
+        pos++;
+      }
+    } else {
+      pos++;
+    }
+  }
+}
+
+void run_worker(const Input &input, const Shard &shard) {
+  NullPrint null;
+  ESPiLight::setErrorOutput(null);
+  ESPiLight::setClock(&worker_clock);
+  ESPiLight rf(-1);
+  ShardStats stats = {0, 0, 0};
+  size_t seq = 0;
+  bool report = false;
+  rf.setCallback([&](const String &protocol, const String &message,
+                     int status, size_t repeats, const String &deviceID) {
+    (void)deviceID;
+    if (report) {
+      fprintf(shard.output, "%lu\t%zu\t%s\t%d\t%zu\t%s\n", worker_time, seq++,
+              protocol.c_str(), status, repeats, message.c_str());
+    }
+  });
+
+  const std::string &data = input.data;
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  if (input.capture) {
+    ESPiLight::enableReceiver();
+    worker_time = shard.time;
+    ESPiLight::handleEdge(worker_time);
+    for_each_edge(data, shard.start, shard.end,
+                  [&](size_t pos, unsigned long duration) {
+                    worker_time += duration;
+                    report = (pos >= shard.begin);
+                    const EdgeStatus_t status =
+                        ESPiLight::handleEdge(worker_time);
+                    if (report && (status == EDGE_FRAME)) {
+                      stats.frames++;
+                    } else if (report && (status == EDGE_REJECTED)) {
+                      stats.rejected++;
+                    }
+                    const uint8_t length =
+                        ESPiLight::receivePulseTrain(pulses);
+                    if ((length > 0) &&
+                        (rf.parsePulseTrain(pulses, length) > 0) && report) {
+                      stats.decoded++;
+                    }
+                  });
+  } else {
+    size_t pos = shard.start;
+    while (pos < shard.end) {
+      size_t eol = data.find('\n', pos);
+      if (eol == std::string::npos) {
+        eol = data.size();
+      }
+      size_t code = data.find("c:", pos);
+      if ((code != std::string::npos) && (code < eol)) {
+        if (code > pos) {
+          worker_time = strtoul(data.c_str() + pos, nullptr, 10);
+        }
+        report = (pos >= shard.begin);
+        const int length = ESPiLight::stringToPulseTrain(
+            data.c_str() + code, eol - code, pulses, MAXPULSESTREAMLENGTH);
+        if (length > 0) {
+          stats.frames += report ? 1 : 0;
+          if ((rf.parsePulseTrain(pulses, (uint8_t)length) > 0) && report) {
+            stats.decoded++;
+          }
+        } else if (report) {
+          stats.rejected++;
+        }
+      }
+      pos = eol + 1;
+    }
+  }
+  fprintf(shard.output, "#\t%lu\t%lu\t%lu\n", stats.frames, stats.rejected,
+          stats.decoded);
+  fflush(shard.output);
+}
+
+bool read_input(const char *name, Input &input) {
+  FILE *file = fopen(name, "rb");
+  if (file == nullptr) {
+    perror(name);
+    return false;
+  }
+  input.name = name;
+  char buffer[65536];
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    input.data.append(buffer, size);
+  }
+  fclose(file);
+  input.capture =
+      input.data.compare(0, sizeof(capture_header) - 1, capture_header) == 0;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  long workers = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t shardSize = 4194304;
+  size_t warmup = 65536;
+  bool quiet = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "j:b:w:q")) != -1) {
+    switch (opt) {
+      case 'j':
+        workers = strtol(optarg, nullptr, 10);
+        break;
+      case 'b':
+        shardSize = strtoul(optarg, nullptr, 10);
+        break;
+      case 'w':
+        warmup = strtoul(optarg, nullptr, 10);
+        break;
+      case 'q':
+        quiet = true;
+        break;
+      default:
+        fprintf(stderr,
+                "usage: %s [-j workers] [-b shard size] [-w warmup] [-q] "
+                "file...\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+  if (optind >= argc) {
+    fprintf(stderr, "no input files\n");
+    return EXIT_FAILURE;
+  }
+  workers = std::max(workers, 1L);
+  shardSize = std::max(shardSize, (size_t)1);
+  const auto start = std::chrono::steady_clock::now();
+
+  std::vector<Input> inputs(argc - optind);
+  std::vector<Shard> shards;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    if (!read_input(argv[optind + i], inputs[i])) {
+      return EXIT_FAILURE;
+    }
+    const Input &input = inputs[i];
+    size_t begin = 0;
+    while (begin < input.data.size()) {
+      const size_t end = align(input, begin + shardSize);
+      const size_t from = (begin > warmup) ? align(input, begin - warmup) : 0;
+      shards.push_back({i, from, begin, end, 0, nullptr});
+      begin = end;
+    }
+    if (input.capture) {
+      // time stamps of the shard starts
+      unsigned long time = 0;
+      size_t shard = shards.size();
+      while ((shard > 0) && (shards[shard - 1].input == i)) {
+        shard--;
+      }
+      for_each_edge(input.data, 0, input.data.size(),
+                    [&](size_t pos, unsigned long duration) {
+                      while ((shard < shards.size()) &&
+                             (shards[shard].start <= pos)) {
+                        shards[shard++].time = time;
+                      }
+                      time += duration;
+                    });
+    }
+  }
+
+  // decode, at most workers shards at a time
+  size_t running = 0;
+  for (size_t i = 0; i < shards.size(); i++) {
+    shards[i].output = tmpfile();
+    if (shards[i].output == nullptr) {
+      perror("tmpfile");
+      return EXIT_FAILURE;
+    }
+    if (running == (size_t)workers) {
+      wait(nullptr);
+      running--;
+    }
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      return EXIT_FAILURE;
+    }
+    if (pid == 0) {
+      run_worker(inputs[shards[i].input], shards[i]);
+      _exit(EXIT_SUCCESS);
+    }
+    running++;
+  }
+  int failed = 0;
+  while (running > 0) {
+    int status;
+    wait(&status);
+    if (!WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+      failed++;
+    }
+    running--;
+  }
+
+  // merge
+  std::vector<Event> events;
+  ShardStats total = {0, 0, 0};
+  char line[4096];
+  for (size_t i = 0; i < shards.size(); i++) {
+    rewind(shards[i].output);
+    while (fgets(line, sizeof(line), shards[i].output) != nullptr) {
+      std::vector<char *> fields;
+      for (char *field = strtok(line, "\t\n"); field != nullptr;
+           field = strtok(nullptr, "\t\n")) {
+        fields.push_back(field);
+      }
+      if ((fields.size() == 4) && (strcmp(fields[0], "#") == 0)) {
+        total.frames += strtoul(fields[1], nullptr, 10);
+        total.rejected += strtoul(fields[2], nullptr, 10);
+        total.decoded += strtoul(fields[3], nullptr, 10);
+      } else if (fields.size() == 6) {
+        events.push_back({strtoul(fields[0], nullptr, 10), i,
+                          strtoul(fields[1], nullptr, 10), fields[2],
+                          atoi(fields[3]),
+                          (unsigned int)strtoul(fields[4], nullptr, 10),
+                          fields[5]});
+      }
+    }
+    fclose(shards[i].output);
+  }
+  std::sort(events.begin(), events.end(), [](const Event &a, const Event &b) {
+    if (a.time != b.time) {
+      return a.time < b.time;
+    }
+    return (a.shard != b.shard) ? a.shard < b.shard : a.seq < b.seq;
+  });
+
+  struct ProtocolStats {
+    unsigned long messages;
+    unsigned long first;  // status FIRST, a new message
+    unsigned long firstTime;
+    unsigned long lastTime;
+  };
+  std::map<std::string, ProtocolStats> protocols;
+  for (const Event &event : events) {
+    if (!quiet) {
+      printf("%lu %s %d %u %s\n", event.time, event.protocol.c_str(),
+             event.status, event.repeats, event.message.c_str());
+    }
+    auto it = protocols.find(event.protocol);
+    if (it == protocols.end()) {
+      it = protocols.insert({event.protocol, {0, 0, event.time, 0}}).first;
+    }
+    it->second.messages++;
+    it->second.first += (event.status == FIRST) ? 1 : 0;
+    it->second.firstTime = std::min(it->second.firstTime, event.time);
+    it->second.lastTime = std::max(it->second.lastTime, event.time);
+  }
+
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  printf("\n%-24s %10s %10s %14s %14s\n", "protocol", "messages", "first",
+         "first time", "last time");
+  for (const auto &protocol : protocols) {
+    printf("%-24s %10lu %10lu %14lu %14lu\n", protocol.first.c_str(),
+           protocol.second.messages, protocol.second.first,
+           protocol.second.firstTime, protocol.second.lastTime);
+  }
+  printf("\nframes: %lu, rejected: %lu, decoded: %lu, messages: %zu\n",
+         total.frames, total.rejected, total.decoded, events.size());
+  printf("%zu shards of %zu files with %ld workers in %.3f s\n",
+         shards.size(), inputs.size(), workers, seconds);
+  if (failed > 0) {
+    fprintf(stderr, "%d workers failed\n", failed);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
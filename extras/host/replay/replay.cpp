@@ -0,0 +1,135 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+/*
+  Replay an edge capture (see ESPiLight::startCapture()) into the receiver.
+
+  Usage: replay [-s speed] [-l loop interval] [-q] [capture]
+
+  Reads the capture from stdin if no file is given. Decoded messages are
+  printed unless -q is given, followed by the replay statistics.
+*/
+
+#include <ESPiLight.h>
+#include <tools/edgecapture.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace {
+
+class FileStream : public Stream {
+ public:
+  explicit FileStream(FILE *file) : _file(file) {}
+  int available() override { return feof(_file) ? 0 : 1; }
+  int read() override { return fgetc(_file); }
+  int peek() override {
+    const int c = fgetc(_file);
+    if (c != EOF) {
+      ungetc(c, _file);
+    }
+    return c;
+  }
+  size_t write(uint8_t c) override { return fputc(c, _file) == EOF ? 0 : 1; }
+  using Print::write;
+
+ private:
+  FILE *_file;
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned int speed = 0;
+  unsigned long interval = 10000;
+  bool quiet = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:l:q")) != -1) {
+    switch (opt) {
+      case 's':
+        speed = (unsigned int)strtoul(optarg, nullptr, 10);
+        break;
+      case 'l':
+        interval = strtoul(optarg, nullptr, 10);
+        break;
+      case 'q':
+        quiet = true;
+        break;
+      default:
+        fprintf(stderr,
+                "usage: %s [-s speed] [-l loop interval] [-q] [capture]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  FILE *file = stdin;
+  if (optind < argc) {
+    file = fopen(argv[optind], "r");
+    if (file == nullptr) {
+      perror(argv[optind]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  ESPiLight rf(-1);
+  rf.setCallback([quiet](const String &protocol, const String &message,
+                         int status, size_t repeats, const String &deviceID) {
+    (void)deviceID;
+    if (!quiet) {
+      printf("%lu [%s] (%d/%zu) %s\n", EdgeReplay::now(), protocol.c_str(),
+             status, repeats, message.c_str());
+    }
+  });
+
+  FileStream input(file);
+  input.setTimeout(0);
+  EdgeReplay replay(rf);
+  replay.setSpeed(speed);
+  replay.setLoopInterval(interval);
+  const bool valid = replay.replay(input);
+  replay.printStats(Serial);
+  ReceiverTelemetry_t telemetry;
+  if (ESPiLight::getReceiverTelemetry(telemetry) && (telemetry.edges > 0)) {
+    printf("edge cycles: min %u, avg %llu, max %u\n", telemetry.edgeMinCycles,
+           (unsigned long long)(telemetry.edgeCycles / telemetry.edges),
+           telemetry.edgeMaxCycles);
+    printf("edge durations (us):");
+    for (uint8_t i = 0; i < RECEIVER_TELEMETRY_BINS; i++) {
+      printf(" %u+:%u", 1u << i, telemetry.durations[i]);
+    }
+    printf("\ntoo short: %u, too long: %u, busy: %u, queue high water: %u\n",
+           telemetry.tooShort, telemetry.tooLong, telemetry.busy,
+           telemetry.queueHighWater);
+    if (telemetry.dequeued > 0) {
+      printf("latency (us): min %u, avg %llu, max %u\n", telemetry.latencyMin,
+             (unsigned long long)(telemetry.latency / telemetry.dequeued),
+             telemetry.latencyMax);
+    }
+  }
+  if (file != stdin) {
+    fclose(file);
+  }
+  if (!valid) {
+    fprintf(stderr, "invalid capture\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,456 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+/*
+  Synthetic RF traffic generator to measure decode accuracy and CPU time.
+
+  Usage: trafficgen [options] [spec]
+    -t seconds     simulated time (default 60)
+    -r rate        transmissions per second (default 2)
+    -j jitter      maximal pulse jitter in us (default 50)
+    -g glitch      probability of a glitch within a pulse (default 0)
+    -x drop        probability of a lost pulse (default 0)
+    -n noise       noise spikes per second between frames (default 0)
+    -l interval    loop interval in us (default 10000)
+    -s seed        random seed (default 1)
+    -c             calibrate and apply the receiver filter, see
+                   ESPiLight::setCalibrationEnabled()
+    -v             print every transmission and decoded message
+
+  Every line of the spec is "protocol repeats json", where the json
+  template may contain "${min-max}" for a random integer and "${a|b|...}"
+  for a random choice, e.g.
+    elro_800_switch 10 {"systemcode":${0-31},"unitcode":${0-31},"${on|off}":1}
+  Every transmission renders its template, creates the pulse train with
+  the protocol's createCode and is sent with the given repeats. Randomly
+  timed transmissions may overlap (collisions). The edge stream is fed
+  through EdgeReplay into the receiver and decoder.
+
+  A decoded message is correct if the same protocol and message results
+  from decoding the clean pulse train of a transmission, that was on air
+  at most one second before. The clean pulse trains are decoded by a new
+  instance each, so the repeat state and the stats of the receiving
+  instance only see the edge stream. The validate() and parseCode() calls
+  and cycles of every protocol are reported as in
+  ESPiLight::printProtocolStats().
+*/
+
+#include <ESPiLight.h>
+#include <tools/calibration.h>
+#include <tools/edgecapture.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char *const default_spec[] = {
+    "elro_800_switch 10 "
+    "{\"systemcode\":${0-31},\"unitcode\":${0-31},\"${on|off}\":1}",
+    "arctech_switch 10 {\"id\":${0-67108863},\"unit\":${0-15},\"${on|off}\":1}",
+    "mumbi 10 {\"systemcode\":${0-31},\"unitcode\":${0-31},\"${on|off}\":1}",
+};
+
+struct Spec {
+  std::string protocol;
+  unsigned int repeats;
+  std::string json;
+};
+
+struct Message {
+  std::string protocol;
+  std::string message;
+  bool operator<(const Message &other) const {
+    return (protocol < other.protocol) ||
+           ((protocol == other.protocol) && (message < other.message));
+  }
+  bool operator==(const Message &other) const {
+    return (protocol == other.protocol) && (message == other.message);
+  }
+};
+
+struct Transmission {
+  unsigned long start;
+  unsigned long end;
+  std::string protocol;
+  std::vector<Message> expected;  // decodes of the clean pulse train
+  bool received;
+};
+
+struct Interval {
+  unsigned long start;
+  unsigned long end;
+  bool operator<(const Interval &other) const { return start < other.start; }
+};
+
+struct ProtocolStats {
+  unsigned long sent;
+  unsigned long received;
+  unsigned long correct;
+  unsigned long wrong;
+};
+
+std::mt19937 rng;
+
+unsigned long random_range(unsigned long min, unsigned long max) {
+  return std::uniform_int_distribution<unsigned long>(min, max)(rng);
+}
+
+bool chance(double probability) {
+  return (probability > 0) &&
+         (std::uniform_real_distribution<double>(0, 1)(rng) < probability);
+}
+
+std::string render(const std::string &json) {
+  std::string out;
+  size_t pos = 0;
+  while (true) {
+    const size_t start = json.find("${", pos);
+    if (start == std::string::npos) {
+      return out + json.substr(pos);
+    }
+    const size_t end = json.find('}', start);
+    if (end == std::string::npos) {
+      return out + json.substr(pos);
+    }
+    out += json.substr(pos, start - pos);
+    const std::string field = json.substr(start + 2, end - start - 2);
+    if (field.find('|') != std::string::npos) {
+      std::vector<std::string> choices;
+      size_t begin = 0;
+      size_t split;
+      while ((split = field.find('|', begin)) != std::string::npos) {
+        choices.push_back(field.substr(begin, split - begin));
+        begin = split + 1;
+      }
+      choices.push_back(field.substr(begin));
+      out += choices[random_range(0, choices.size() - 1)];
+    } else {
+      const size_t split = field.find('-', 1);
+      const unsigned long min = strtoul(field.c_str(), nullptr, 10);
+      const unsigned long max =
+          split == std::string::npos
+              ? min
+              : strtoul(field.c_str() + split + 1, nullptr, 10);
+      out += std::to_string(random_range(min, std::max(min, max)));
+    }
+    pos = end + 1;
+  }
+}
+
+bool parse_spec(const std::string &line, Spec &spec) {
+  const size_t first = line.find(' ');
+  const size_t second = line.find(' ', first + 1);
+  if ((first == std::string::npos) || (second == std::string::npos)) {
+    return false;
+  }
+  spec.protocol = line.substr(0, first);
+  spec.repeats = (unsigned int)strtoul(line.c_str() + first + 1, nullptr, 10);
+  spec.json = line.substr(second + 1);
+  return spec.repeats > 0;
+}
+
+class NullPrint : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    (void)c;
+    return 1;
+  }
+  using Print::write;
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  double seconds = 60;
+  double rate = 2;
+  unsigned long jitter = 50;
+  double glitch = 0;
+  double drop = 0;
+  double noise = 0;
+  unsigned long interval = 10000;
+  unsigned long seed = 1;
+  bool verbose = false;
+  bool calibrate = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "t:r:j:g:x:n:l:s:cv")) != -1) {
+    switch (opt) {
+      case 't':
+        seconds = atof(optarg);
+        break;
+      case 'r':
+        rate = atof(optarg);
+        break;
+      case 'j':
+        jitter = strtoul(optarg, nullptr, 10);
+        break;
+      case 'g':
+        glitch = atof(optarg);
+        break;
+      case 'x':
+        drop = atof(optarg);
+        break;
+      case 'n':
+        noise = atof(optarg);
+        break;
+      case 'l':
+        interval = strtoul(optarg, nullptr, 10);
+        break;
+      case 's':
+        seed = strtoul(optarg, nullptr, 10);
+        break;
+      case 'c':
+        calibrate = true;
+        break;
+      case 'v':
+        verbose = true;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-t seconds] [-r rate] [-j jitter] "
+                        "[-g glitch] [-x drop] [-n noise] [-l interval] "
+                        "[-s seed] [-c] [-v] [spec]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+  rng.seed(seed);
+
+  std::vector<Spec> specs;
+  Spec spec;
+  if (optind < argc) {
+    FILE *file = fopen(argv[optind], "r");
+    if (file == nullptr) {
+      perror(argv[optind]);
+      return EXIT_FAILURE;
+    }
+    char line[1024];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+      std::string str(line);
+      str.erase(str.find_last_not_of("\r\n") + 1);
+      if (!str.empty() && (str[0] != '#') && parse_spec(str, spec)) {
+        specs.push_back(spec);
+      }
+    }
+    fclose(file);
+  } else {
+    for (const char *line : default_spec) {
+      if (parse_spec(line, spec)) {
+        specs.push_back(spec);
+      }
+    }
+  }
+
+  NullPrint null;
+  ESPiLight rf(-1);
+  ESPiLight::setErrorOutput(null);
+  std::vector<Message> decoded;
+  const ESPiLightCallBack collect =
+      [&decoded](const String &protocol, const String &message, int status,
+                 size_t repeats, const String &deviceID) {
+        (void)status;
+        (void)repeats;
+        (void)deviceID;
+        decoded.push_back(Message{protocol.c_str(), message.c_str()});
+      };
+
+  // generate transmissions, the clean decode is the expected result
+  std::vector<Transmission> transmissions;
+  std::vector<Interval> highs;
+  std::map<std::string, ProtocolStats> stats;
+  const unsigned long duration = (unsigned long)(seconds * 1e6);
+  std::exponential_distribution<double> arrival(rate);
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  for (unsigned long time = 0; !specs.empty();) {
+    time += (unsigned long)(arrival(rng) * 1e6);
+    if (time >= duration) {
+      break;
+    }
+    const Spec &s = specs[random_range(0, specs.size() - 1)];
+    const std::string json = render(s.json);
+    const int length =
+        ESPiLight::createPulseTrain(pulses, s.protocol.c_str(), json.c_str());
+    if (length <= 0) {
+      fprintf(stderr, "createPulseTrain failed (%d): %s %s\n", length,
+              s.protocol.c_str(), json.c_str());
+      continue;
+    }
+    Transmission transmission;
+    transmission.protocol = s.protocol;
+    transmission.received = false;
+    decoded.clear();
+    uint16_t clean[MAXPULSESTREAMLENGTH];
+    std::copy(pulses, pulses + length, clean);
+    ESPiLight expect(-1);  // without the repeat state of other runs
+    expect.setCallback(collect);
+    expect.parsePulseTrain(clean, (uint8_t)length);
+    transmission.expected = decoded;
+    stats[s.protocol].sent++;
+
+    unsigned long t = time;
+    transmission.start = t;
+    for (unsigned int r = 0; r < s.repeats; r++) {
+      for (int i = 0; i < length; i++) {
+        if (chance(drop)) {
+          continue;
+        }
+        long width = (long)pulses[i] +
+                     (long)random_range(0, 2 * jitter) - (long)jitter;
+        width = std::max(width, 1L);
+        if ((i % 2 == 0) && chance(glitch)) {
+          // high pulse interrupted by a short low glitch
+          const unsigned long split = random_range(0, (unsigned long)width);
+          highs.push_back(Interval{t, t + split});
+          highs.push_back(Interval{t + split + random_range(20, 150),
+                                   t + (unsigned long)width});
+        } else if (i % 2 == 0) {
+          highs.push_back(Interval{t, t + (unsigned long)width});
+        } else if (chance(glitch)) {
+          // low pulse interrupted by a short spike
+          const unsigned long at = t + random_range(0, (unsigned long)width);
+          highs.push_back(Interval{at, at + random_range(20, 150)});
+        }
+        t += (unsigned long)width;
+      }
+    }
+    transmission.end = t;
+    if (verbose) {
+      printf("%lu sent [%s] %s\n", time, s.protocol.c_str(), json.c_str());
+    }
+    transmissions.push_back(transmission);
+  }
+  for (unsigned long i = 0; i < (unsigned long)(noise * seconds); i++) {
+    const unsigned long at = random_range(0, duration);
+    highs.push_back(Interval{at, at + random_range(20, 600)});
+  }
+
+  // collisions: the receiver sees the union of all carriers
+  std::sort(highs.begin(), highs.end());
+  std::vector<unsigned long> edges;
+  for (const Interval &high : highs) {
+    if (!edges.empty() && (high.start <= edges.back())) {
+      edges.back() = std::max(edges.back(), high.end);
+    } else {
+      edges.push_back(high.start);
+      edges.push_back(high.end);
+    }
+  }
+
+  // feed edges through the receiver and decoder
+  decoded.clear();
+  std::vector<unsigned long> times;
+  rf.setCallback([&decoded, &times](const String &protocol,
+                                    const String &message, int status,
+                                    size_t repeats, const String &deviceID) {
+    (void)status;
+    (void)repeats;
+    (void)deviceID;
+    decoded.push_back(Message{protocol.c_str(), message.c_str()});
+    times.push_back(EdgeReplay::now());
+  });
+  // the match stats of the clean decodes are not part of the result
+  MatchStats_t match;
+  ESPiLight::getMatchStats(match, true);
+  ESPiLight::setProtocolStatsEnabled(true);
+  EdgeReplay replay(rf);
+  if (calibrate) {
+    ESPiLight::setCalibrationEnabled(true, true);
+  }
+  replay.setLoopInterval(interval);
+  unsigned long last = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned long edge : edges) {
+    replay.feed(edge - last);
+    last = edge;
+  }
+  replay.feed(duration > last ? duration - last : 1);
+  replay.finish();
+  const double cpu_ns =
+      (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count();
+
+  // evaluate
+  unsigned long correct = 0;
+  for (size_t i = 0; i < decoded.size(); i++) {
+    bool match = false;
+    for (Transmission &transmission : transmissions) {
+      if ((transmission.start <= times[i]) &&
+          (times[i] <= transmission.end + 1000000) &&
+          (std::find(transmission.expected.begin(),
+                     transmission.expected.end(),
+                     decoded[i]) != transmission.expected.end())) {
+        if (!transmission.received) {
+          transmission.received = true;
+          stats[transmission.protocol].received++;
+        }
+        match = true;
+      }
+    }
+    if (match) {
+      correct++;
+      stats[decoded[i].protocol].correct++;
+    } else {
+      stats[decoded[i].protocol].wrong++;
+    }
+    if (verbose) {
+      printf("%lu %s [%s] %s\n", times[i], match ? "ok" : "FALSE",
+             decoded[i].protocol.c_str(), decoded[i].message.c_str());
+    }
+  }
+
+  printf("%-24s %8s %8s %8s %8s %8s\n", "protocol", "sent", "received",
+         "recall", "correct", "false");
+  unsigned long received = 0;
+  for (const auto &entry : stats) {
+    const ProtocolStats &s = entry.second;
+    received += s.received;
+    printf("%-24s %8lu %8lu %8.3f %8lu %8lu\n", entry.first.c_str(), s.sent,
+           s.received, s.sent > 0 ? (double)s.received / s.sent : 0.0,
+           s.correct, s.wrong);
+  }
+  printf("\ntransmissions: %zu, edges: %zu, decoded messages: %zu\n",
+         transmissions.size(), edges.size(), decoded.size());
+  printf("recall: %.3f, precision: %.3f\n",
+         transmissions.empty() ? 0.0
+                               : (double)received / transmissions.size(),
+         decoded.empty() ? 0.0 : (double)correct / decoded.size());
+  replay.printStats(Serial);
+  const PulseCalibration *calibration = ESPiLight::getCalibration();
+  if (calibration != nullptr) {
+    printf("calibrated: minpulselen %u, maxpulselen %u%s\n",
+           ESPiLight::minpulselen, ESPiLight::maxpulselen,
+           calibration->reverted() ? " (reverted)" : "");
+    calibration->print(Serial, ESPiLight::maxgaplen);
+  }
+  printf("cpu: %.3f ms total, %.0f ns/frame, %.2f%% of simulated time\n",
+         cpu_ns / 1e6,
+         replay.stats().frames > 0 ? cpu_ns / replay.stats().frames : 0.0,
+         cpu_ns / 10.0 / (double)duration);
+  printf("decoders: ");
+  ESPiLight::printProtocolStats(Serial);
+  ESPiLight::setProtocolStatsEnabled(false);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,373 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+
+/*
+  Wake-to-ready benchmark of the warm start.
+
+  Usage: wake [-n runs] [-l protocols] [-s sleep] [-f file]
+              [-e "protocol json"] [corpus]
+    -n runs       measured wakes per mode (default 100)
+    -l protocols  json array for ESPiLight::limitProtocols()
+                  (default: all protocols)
+    -s sleep      simulated deep sleep in us between the last message and
+                  the wake (default 100000)
+    -f file       snapshot file (default: a temporary file)
+    -e message    after every wake, transmit message with send() and
+                  decode it after limitProtocols() enabled its protocol
+                  too, e.g. one that is not in the snapshot; the exit
+                  status is 1 if a message is not decoded or the
+                  protocols are not registered in the order of a cold
+                  start
+
+  A first process enables the protocols, decodes the first frame of the
+  corpus (same format as for bench) and stores a snapshot with
+  ESPiLight::saveState() in a FileStateStore. Every wake is a new process
+  (a fork), which is ready after
+   - cold: the construction of ESPiLight and limitProtocols()
+   - warm: ESPiLight::restoreState() of the snapshot in memory (like the
+           RTC memory) and the construction of ESPiLight.
+  Time and heap allocations until ready are measured, afterwards the frame
+  is decoded again and the repeat status of the message is reported.
+*/
+
+#include <ESPiLight.h>
+#include <host.h>
+#include <tools/statestore.h>
+
+extern "C" {
+#include <pilight/libs/pilight/protocols/protocol.h>
+}
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+
+namespace {
+
+const char *const status_names[] = {"FIRST", "INVALID", "VALID", "KNOWN"};
+
+struct WakeResult {
+  unsigned long ns;
+  unsigned long allocations;
+  unsigned long bytes;
+  int status;  // of the decoded frame, -1 if not decoded
+  int enabled;  // message of -e decoded in order (1) or not (0), -1
+                // without -e
+};
+
+class NullPrint : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    (void)c;
+    return 1;
+  }
+  using Print::write;
+};
+
+NullPrint null_print;
+std::string protocols;
+std::string frame;  // first line of the corpus
+std::string enable;  // message of -e
+
+int decode_frame(ESPiLight &rf) {
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  int length;
+  if (frame.compare(0, 2, "c:") == 0) {
+    length = ESPiLight::stringToPulseTrain(frame.c_str(), frame.size(),
+                                           pulses, MAXPULSESTREAMLENGTH);
+  } else {
+    const size_t split = frame.find(' ');
+    if (split == std::string::npos) {
+      return -1;
+    }
+    length = ESPiLight::createPulseTrain(pulses, frame.substr(0, split).c_str(),
+                                         frame.substr(split + 1).c_str());
+  }
+  if (length <= 0) {
+    return -1;
+  }
+  int result = -1;
+  rf.setCallback([&result](const String &protocol, const String &message,
+                           int status, size_t repeats,
+                           const String &deviceID) {
+    (void)protocol;
+    (void)message;
+    (void)repeats;
+    (void)deviceID;
+    if (result < 0) {
+      result = status;
+    }
+  });
+  rf.parsePulseTrain(pulses, (uint8_t)length);
+  return result;
+}
+
+/**
+ * Returns: true if the protocols are registered in the order of a cold
+ * start, also the ones registered on demand after a warm start
+ */
+bool cold_start_order() {
+  for (protocols_t *pnode = pilight_protocols;
+       (pnode != nullptr) && (pnode->next != nullptr); pnode = pnode->next) {
+    if (pnode->listener->index <= pnode->next->listener->index) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Transmit the message of -e, which registers its protocol on demand after
+ * a warm start, enable the protocol besides the ones of -l and decode the
+ * message.
+ * Returns: WakeResult::enabled
+ */
+int enable_protocol(ESPiLight &rf) {
+  const size_t split = enable.find(' ');
+  if (enable.empty()) {
+    return -1;
+  }
+  if (split == std::string::npos) {
+    return 0;
+  }
+  const String protocol = enable.substr(0, split).c_str();
+  const String json = enable.substr(split + 1).c_str();
+  ESPiLight tx(0);  // the pins of the host do nothing
+  if (tx.send(protocol, json, 1) <= 0) {
+    return 0;
+  }
+  std::string list = protocols.empty() ? "[]" : protocols;
+  list.insert(list.size() - 1, std::string((list.size() > 2) ? "," : "") +
+                                   "\"" + protocol.c_str() + "\"");
+  ESPiLight::limitProtocols(list.c_str());
+
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  const int length = ESPiLight::createPulseTrain(pulses, protocol, json);
+  if (length <= 0) {
+    return 0;
+  }
+  bool decoded = false;
+  rf.setCallback([&decoded, &protocol](const String &id, const String &message,
+                                       int status, size_t repeats,
+                                       const String &deviceID) {
+    (void)message;
+    (void)status;
+    (void)repeats;
+    (void)deviceID;
+    decoded |= (id == protocol);
+  });
+  rf.parsePulseTrain(pulses, (uint8_t)length);
+  return (decoded && cold_start_order()) ? 1 : 0;
+}
+
+/**
+ * Run job in a new process, which writes its result into a pipe.
+ */
+template <typename Job>
+bool run_process(Job job, WakeResult &result) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    perror("pipe");
+    return false;
+  }
+  fflush(stdout);
+  const pid_t pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    return false;
+  }
+  if (pid == 0) {
+    close(fds[0]);
+    WakeResult child = job();
+    const bool written = (write(fds[1], &child, sizeof(child)) ==
+                          (ssize_t)sizeof(child));
+    _exit(written ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+  close(fds[1]);
+  const bool read_ok =
+      (read(fds[0], &result, sizeof(result)) == (ssize_t)sizeof(result));
+  close(fds[0]);
+  int status;
+  waitpid(pid, &status, 0);
+  return read_ok && WIFEXITED(status) &&
+         (WEXITSTATUS(status) == EXIT_SUCCESS);
+}
+
+template <typename Ready>
+WakeResult measure_wake(Ready ready) {
+  WakeResult result;
+  const HostHeapStats_t heap = host_heap_stats();
+  const auto start = std::chrono::steady_clock::now();
+  ESPiLight *rf = ready();
+  result.ns = (unsigned long)std::chrono::duration_cast<
+                  std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+  const HostHeapStats_t used = host_heap_stats();
+  result.allocations = used.allocations - heap.allocations;
+  result.bytes = used.allocated - heap.allocated;
+  ESPiLight::setErrorOutput(null_print);
+  result.status = decode_frame(*rf);
+  result.enabled = enable_protocol(*rf);
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned long runs = 100;
+  unsigned long sleep = 100000;
+  std::string path;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:l:s:f:e:")) != -1) {
+    if (opt == 'n') {
+      runs = strtoul(optarg, nullptr, 10);
+    } else if (opt == 'l') {
+      protocols = optarg;
+    } else if (opt == 's') {
+      sleep = strtoul(optarg, nullptr, 10);
+    } else if (opt == 'f') {
+      path = optarg;
+    } else if (opt == 'e') {
+      enable = optarg;
+    } else {
+      fprintf(stderr,
+              "usage: %s [-n runs] [-l protocols] [-s sleep] [-f file] "
+              "[-e \"protocol json\"] [corpus]\n",
+              argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (runs == 0) {
+    runs = 1;
+  }
+  if (optind < argc) {
+    FILE *corpus = fopen(argv[optind], "r");
+    if (corpus == nullptr) {
+      perror(argv[optind]);
+      return EXIT_FAILURE;
+    }
+    char line[4096];
+    while ((frame.empty()) && (fgets(line, sizeof(line), corpus) != nullptr)) {
+      line[strcspn(line, "\r\n")] = '\0';
+      if ((line[0] != '\0') && (line[0] != '#')) {
+        frame = line;
+      }
+    }
+    fclose(corpus);
+  }
+  char tmp[] = "/tmp/espilight-wake-XXXXXX";
+  if (path.empty()) {
+    const int fd = mkstemp(tmp);
+    if (fd < 0) {
+      perror("mkstemp");
+      return EXIT_FAILURE;
+    }
+    close(fd);
+    path = tmp;
+  }
+  FileStateStore store(path.c_str(), 4096);
+
+  // snapshot, the time of the save is reported in ns
+  WakeResult saved;
+  const bool prepared = run_process(
+      [&store]() {
+        WakeResult result = {0, 0, 0, -1, -1};
+        ESPiLight rf(-1);
+        ESPiLight::setErrorOutput(null_print);
+        if (!protocols.empty()) {
+          ESPiLight::limitProtocols(protocols.c_str());
+        }
+        result.status = decode_frame(rf);
+        result.bytes = rf.saveState(store) ? 1 : 0;
+        result.ns = micros();
+        return result;
+      },
+      saved);
+  if (!prepared || (saved.bytes == 0)) {
+    fprintf(stderr, "failed to save the snapshot to %s\n", path.c_str());
+    return EXIT_FAILURE;
+  }
+  uint8_t snapshot[4096];
+  const size_t length = store.read(snapshot, sizeof(snapshot));
+  // the protocols are not initialized by this process, see run_process()
+  printf("snapshot: %zu bytes\n", length);
+
+  const char *const modes[] = {"cold", "warm"};
+  int exitStatus = EXIT_SUCCESS;
+  for (int mode = 0; mode < 2; mode++) {
+    unsigned long min = (unsigned long)-1;
+    unsigned long long sum = 0;
+    unsigned long enabled = 0;
+    WakeResult result = {0, 0, 0, -1, -1};
+    for (unsigned long i = 0; i < runs; i++) {
+      const bool ok = run_process(
+          [mode, &snapshot, length, &saved, sleep]() {
+            return measure_wake([mode, &snapshot, length, &saved, sleep]() {
+              if (mode == 1) {
+                // micros() continues on the host, unlike after deep sleep
+                const int restored = ESPiLight::restoreState(
+                    snapshot, length, sleep + (micros() - saved.ns));
+                if (restored < 0) {
+                  fprintf(stderr, "restoreState: %d\n", restored);
+                }
+                return new ESPiLight(-1);
+              }
+              ESPiLight *rf = new ESPiLight(-1);
+              if (!protocols.empty()) {
+                ESPiLight::limitProtocols(protocols.c_str());
+              }
+              return rf;
+            });
+          },
+          result);
+      if (!ok) {
+        fprintf(stderr, "%s wake failed\n", modes[mode]);
+        return EXIT_FAILURE;
+      }
+      sum += result.ns;
+      if (result.ns < min) {
+        min = result.ns;
+      }
+      if (result.enabled > 0) {
+        enabled++;
+      }
+    }
+    printf("%s: %8lu ns min, %8llu ns mean, %4lu allocations, %6lu bytes, "
+           "first message: %s\n",
+           modes[mode], min, sum / runs, result.allocations, result.bytes,
+           (result.status >= 0) ? status_names[result.status] : "-");
+    if (!enable.empty()) {
+      printf("%s: %lu of %lu messages of -e decoded in order\n", modes[mode],
+             enabled, runs);
+      if (enabled != runs) {
+        exitStatus = EXIT_FAILURE;
+      }
+    }
+  }
+  if (path == tmp) {
+    unlink(tmp);
+  }
+  return exitStatus;
+}
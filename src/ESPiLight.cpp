@@ -18,11 +18,13 @@
 
 #include <ESPiLight.h>
 #include "tools/aprintf.h"
-
-// ESP32 doesn't define ICACHE_RAM_ATTR
-#ifndef ICACHE_RAM_ATTR
-#define ICACHE_RAM_ATTR IRAM_ATTR
-#endif
+#include "tools/calibration.h"
+#include "tools/edgecapture.h"
+#include "tools/eventring.h"
+#include "tools/fixedpoint.h"
+#include "tools/repeatvoter.h"
+#include "tools/statestore.h"
+#include "tools/streamdecoder.h"
 
 #ifdef DEBUG
 #define Debug(x) Serial.print(x)
@@ -37,39 +39,219 @@ extern "C" {
 }
 static protocols_t *used_protocols = nullptr;
 
-volatile PulseTrain_t ESPiLight::_pulseTrains[RECEIVER_BUFFER_SIZE];
-bool ESPiLight::_enabledReceiver;
-volatile uint8_t ESPiLight::_actualPulseTrain = 0;
-uint8_t ESPiLight::_avaiablePulseTrain = 0;
-volatile unsigned long ESPiLight::_lastChange =
-    0;  // Timestamp of previous edge
-volatile uint8_t ESPiLight::_nrpulses = 0;
-int16_t ESPiLight::_interrupt = NOT_AN_INTERRUPT;
-
-uint8_t ESPiLight::minrawlen = std::numeric_limits<uint8_t>::max();
-uint8_t ESPiLight::maxrawlen = std::numeric_limits<uint8_t>::min();
-uint16_t ESPiLight::mingaplen = std::numeric_limits<uint16_t>::max();
-uint16_t ESPiLight::maxgaplen = std::numeric_limits<uint16_t>::min();
-uint16_t ESPiLight::minpulselen = 80;
-uint16_t ESPiLight::maxpulselen = 16000;
-
-static void fire_callback(protocol_t *protocol, ESPiLightCallBack callback);
+volatile bool ESPiLightBase::_receiverMuted = false;
+EdgeCapture *volatile ESPiLightBase::_capture = nullptr;
+PulseCalibration *volatile ESPiLightBase::_calibration = nullptr;
+volatile bool ESPiLightBase::_inHandler = false;
+static bool calibration_apply = false;
+// the bounds of the enabled protocols changed (calc_lengths())
+static bool calibration_restart = false;
+// a protocol was decoded for the first time since the restart
+static bool calibration_seen = false;
+uint8_t ESPiLightBase::_receivedGapClass = 0;
+unsigned long (*ESPiLightBase::_clock)(void) = &micros;
+
+uint8_t ESPiLightBase::minrawlen = std::numeric_limits<uint8_t>::max();
+uint8_t ESPiLightBase::maxrawlen = std::numeric_limits<uint8_t>::min();
+uint16_t ESPiLightBase::mingaplen = std::numeric_limits<uint16_t>::max();
+uint16_t ESPiLightBase::maxgaplen = std::numeric_limits<uint16_t>::min();
+uint16_t ESPiLightBase::minpulselen = 80;
+uint16_t ESPiLightBase::maxpulselen = 16000;
+
+/* Gap classes of the enabled protocols, see calc_lengths() */
+static_assert((MAX_GAP_CLASSES >= 1) && (MAX_GAP_CLASSES <= 8),
+              "the truncated frames are a bit mask of 8 classes");
+GapClass_t ESPiLightBase::gapClasses[MAX_GAP_CLASSES];
+volatile uint8_t ESPiLightBase::gapClassCount = 1;
+volatile uint8_t ESPiLightBase::gapClassUpdates = 0;
+
+/* Repeat detection of a protocol, per ESPiLight instance */
+struct RepeatState_t {
+  uint8_t repeats;
+  uint32_t old_hash;  // of old_content before a warm start (restoreState())
+  unsigned long first;
+  unsigned long second;
+  char *old_content;  // last message, to compare repeated messages
+};
+
+// repeats are counted again after this time without a message
+#define REPEAT_RESET_TIME 500000  // us
+
+static size_t protocol_count = 0;
+static size_t repeat_bytes = 0;  // RepeatState_t of all instances
+static bool missing_protocols = false;  // warm start registered a subset
+static RepeatState_t *restored_repeats = nullptr;  // for the next instance
+
+static uint32_t content_hash(const char *content);
+static void set_old_content(RepeatState_t &state, char *content);
+static PilightRepeatStatus_t repeat_status(RepeatState_t &state,
+                                           JsonNode *message);
+static void fire_callback(const protocol_t *protocol,
+                          const RepeatState_t &state,
+                          PilightRepeatStatus_t status, JsonNode *message,
+                          const ESPiLightCallBack &callback);
+static void push_event(const protocol_t *protocol, const RepeatState_t &state,
+                       PilightRepeatStatus_t status, EventRing *events);
+
+#define MAX_FRAME_MATCHES 8
+
+static MatchStats_t match_stats;
+
+/**
+ * Report and delete message.
+ */
+static void report_message(protocol_t *protocol, RepeatState_t &state,
+                           JsonNode *message,
+                           const ESPiLightCallBack &callback,
+                           EventRing *events) {
+  state.repeats++;
+  const PilightRepeatStatus_t status = repeat_status(state, message);
+  if (events != nullptr) {
+    push_event(protocol, state, status, events);
+  }
+  if (callback != nullptr) {
+    fire_callback(protocol, state, status, message, callback);
+  }
+  json_delete(message);
+  protocol->score = (protocol->score > 65535 - 256) ? 65535
+                                                     : protocol->score + 256;
+}
+
 static void calc_lengths();
+static void calc_gap_classes();
+
+/* Transient heap, sampled at the allocation peaks of decode and encode */
+static uint32_t decode_heap_start = 0;
+static size_t decode_heap_peak = 0;
+static size_t encode_heap_peak = 0;
+
+static void sample_heap(uint32_t start, size_t &peak) {
+  const uint32_t freeHeap = ESP.getFreeHeap();
+  if ((freeHeap < start) && (start - freeHeap > peak)) {
+    peak = start - freeHeap;
+  }
+}
+
+static void register_missing_protocols() {
+  missing_protocols = false;
+  bool *registered = new bool[protocol_count]();
+  for (protocols_t *pnode = pilight_protocols; pnode != nullptr;
+       pnode = pnode->next) {
+    registered[pnode->listener->index] = true;
+  }
+  for (size_t i = 0; i < protocol_count; i++) {
+    if (!registered[i]) {
+      protocol_init_one((int)i);
+    }
+  }
+  delete[] registered;
+}
+
+static bool error_output_set = false;
+
+// Serial, unless ESPiLight::setErrorOutput() was called before
+static void default_error_output() {
+  if (!error_output_set) {
+    set_aprintf_output(&Serial);
+  }
+}
 
 static protocols_t *get_protocols() {
   if (pilight_protocols == nullptr) {
-    ESPiLight::setErrorOutput(Serial);
+    default_error_output();
     protocol_init();
+    protocol_count = (size_t)protocol_init_count();
     calc_lengths();
+  } else if (missing_protocols) {
+    register_missing_protocols();
   }
   return pilight_protocols;
 }
 
+/**
+ * Registered protocols, without registering the protocols that a warm
+ * start skipped.
+ */
+static protocols_t *get_registered_protocols() {
+  return (pilight_protocols != nullptr) ? pilight_protocols : get_protocols();
+}
+
+/**
+ * Protocols of limitProtocols() or all registered protocols. The head of
+ * the registered protocols is not cached, it changes with every protocol
+ * registered later.
+ */
 static protocols_t *get_used_protocols() {
-  if (used_protocols == nullptr) {
-    used_protocols = get_protocols();
+  return (used_protocols != nullptr) ? used_protocols : get_protocols();
+}
+
+// used_protocols is a copy of all protocols in adaptive order
+static bool adaptive_copy = false;
+
+/**
+ * Protocols in the order of setAdaptiveOrderEnabled(). Without a filter
+ * of limitProtocols(), the registered protocols are copied sorted by
+ * score, their own order stays untouched.
+ */
+static protocols_t *get_adaptive_protocols() {
+  protocols_t *used = get_used_protocols();
+  if (used != pilight_protocols) {
+    return used;
   }
-  return used_protocols;
+  protocols_t *list = nullptr;
+  for (protocols_t *pnode = used; pnode != nullptr; pnode = pnode->next) {
+    protocols_t **link = &list;
+    while ((*link != nullptr) &&
+           ((*link)->listener->score >= pnode->listener->score)) {
+      link = &(*link)->next;
+    }
+    protocols_t *node = new protocols_t;
+    node->listener = pnode->listener;
+    node->next = *link;
+    *link = node;
+  }
+  used_protocols = list;
+  adaptive_copy = true;
+  return list;
+}
+
+/**
+ * Delete the filter list of limitProtocols(), all protocols are enabled.
+ */
+static void free_used_protocols() {
+  if ((used_protocols != nullptr) && (used_protocols != pilight_protocols)) {
+    protocols_t *pnode = used_protocols;
+    while (pnode != nullptr) {
+      protocols_t *tmp = pnode;
+      pnode = pnode->next;
+      delete tmp;
+    }
+  }
+  used_protocols = nullptr;
+  adaptive_copy = false;
+}
+
+/**
+ * Move node of get_adaptive_protocols() in front of all protocols with a
+ * lower score. The list stays sorted, as the scores only increase by
+ * matches and decay uniformly.
+ */
+static void promote_protocol(protocols_t *node) {
+  protocols_t **link = &used_protocols;
+  while ((*link != node) &&
+         ((*link)->listener->score >= node->listener->score)) {
+    link = &(*link)->next;
+  }
+  if (*link == node) {
+    return;
+  }
+  protocols_t **prev = link;
+  while ((*prev)->next != node) {
+    prev = &(*prev)->next;
+  }
+  (*prev)->next = node->next;
+  node->next = *link;
+  *link = node;
 }
 
 static protocols_t *find_protocol_node(const char *name) {
@@ -98,7 +280,7 @@ static int create_pulse_train(uint16_t *pulses, protocol_t *protocol,
   if (!json_validate(content.c_str())) {
     Debug("invalid json: ");
     DebugLn(content);
-    return ESPiLight::ERROR_INVALID_JSON;
+    return ESPiLightBase::ERROR_INVALID_JSON;
   }
 
 #pragma GCC diagnostic push
@@ -109,34 +291,37 @@ static int create_pulse_train(uint16_t *pulses, protocol_t *protocol,
     Debug("protocol: ");
     Debug(protocol->id);
 
-    protocol->rawlen = 0;
-    protocol->raw = pulses;
+    const uint32_t heap = ESP.getFreeHeap();
+    protocol_ctx_t ctx;
+    ctx.raw = pulses;
+    ctx.rawlen = 0;
+    ctx.message = nullptr;
     JsonNode *message = json_decode(content.c_str());
-    int return_value = protocol->createCode(message);
+    int return_value = protocol_create(protocol, &ctx, message);
+    sample_heap(heap, encode_heap_peak);
     json_delete(message);
     // delete message created by createCode()
-    json_delete(protocol->message);
-    protocol->message = nullptr;
+    json_delete(ctx.message);
 
     if (return_value == EXIT_SUCCESS) {
       DebugLn(" create Code succeded.");
-      return protocol->rawlen;
+      return ctx.rawlen;
     } else {
       DebugLn(" create Code failed.");
-      return ESPiLight::ERROR_INVALID_PILIGHT_MSG;
+      return ESPiLightBase::ERROR_INVALID_PILIGHT_MSG;
     }
   }
-  return ESPiLight::ERROR_UNAVAILABLE_PROTOCOL;
+  return ESPiLightBase::ERROR_UNAVAILABLE_PROTOCOL;
 }
 
 static void calc_lengths() {
   protocols_t *pnode = get_used_protocols();
-  ESPiLight::minrawlen = std::numeric_limits<uint8_t>::max();
-  ESPiLight::maxrawlen = std::numeric_limits<uint8_t>::min();
-  ESPiLight::mingaplen = std::numeric_limits<uint16_t>::max();
-  ESPiLight::maxgaplen = std::numeric_limits<uint16_t>::min();
-  ESPiLight::minpulselen = 80;
-  ESPiLight::maxpulselen = 16000;
+  ESPiLightBase::minrawlen = std::numeric_limits<uint8_t>::max();
+  ESPiLightBase::maxrawlen = std::numeric_limits<uint8_t>::min();
+  ESPiLightBase::mingaplen = std::numeric_limits<uint16_t>::max();
+  ESPiLightBase::maxgaplen = std::numeric_limits<uint16_t>::min();
+  ESPiLightBase::minpulselen = 80;
+  ESPiLightBase::maxpulselen = 16000;
   while (pnode != nullptr) {
     if (pnode->listener->parseCode != nullptr) {
       const protocol_t *protocol = pnode->listener;
@@ -145,181 +330,704 @@ static void calc_lengths() {
       const uint16_t minGap = protocol->mingaplen;
       const uint16_t maxGap = protocol->maxgaplen;
 
-      if (minLen < ESPiLight::minrawlen) {
-        ESPiLight::minrawlen = minLen;
+      if (minLen < ESPiLightBase::minrawlen) {
+        ESPiLightBase::minrawlen = minLen;
       }
 
-      if (maxLen > ESPiLight::maxrawlen && maxLen <= MAXPULSESTREAMLENGTH) {
-        ESPiLight::maxrawlen = maxLen;
+      if (maxLen > ESPiLightBase::maxrawlen && maxLen <= MAXPULSESTREAMLENGTH) {
+        ESPiLightBase::maxrawlen = maxLen;
       }
 
-      if (minGap < ESPiLight::mingaplen) {
-        ESPiLight::mingaplen = minGap;
+      if (minGap < ESPiLightBase::mingaplen) {
+        ESPiLightBase::mingaplen = minGap;
       }
 
-      if (maxGap > ESPiLight::maxgaplen) {
-        ESPiLight::maxgaplen = maxGap;
+      if (maxGap > ESPiLightBase::maxgaplen) {
+        ESPiLightBase::maxgaplen = maxGap;
       }
 
-      if (minGap < ESPiLight::minpulselen) {
-        ESPiLight::minpulselen = minGap;
+      if (minGap < ESPiLightBase::minpulselen) {
+        ESPiLightBase::minpulselen = minGap;
       }
 
-      if (maxGap > ESPiLight::maxpulselen) {
-        ESPiLight::maxpulselen = maxGap;
+      if (maxGap > ESPiLightBase::maxpulselen) {
+        ESPiLightBase::maxpulselen = maxGap;
       }
     }
     pnode = pnode->next;
   }
+  calibration_restart = true;
   Debug("minrawlen: ");
-  DebugLn(ESPiLight::minrawlen);
+  DebugLn(ESPiLightBase::minrawlen);
   Debug("maxrawlen: ");
-  DebugLn(ESPiLight::maxrawlen);
+  DebugLn(ESPiLightBase::maxrawlen);
   Debug("mingaplen: ");
-  DebugLn(ESPiLight::mingaplen);
+  DebugLn(ESPiLightBase::mingaplen);
   Debug("maxgaplen: ");
-  DebugLn(ESPiLight::maxgaplen);
+  DebugLn(ESPiLightBase::maxgaplen);
   Debug("minpulselen: ");
-  DebugLn(ESPiLight::minpulselen);
+  DebugLn(ESPiLightBase::minpulselen);
   Debug("maxpulselen: ");
-  DebugLn(ESPiLight::maxpulselen);
+  DebugLn(ESPiLightBase::maxpulselen);
+  calc_gap_classes();
 }
 
-void ESPiLight::initReceiver(byte inputPin) {
-  int16_t interrupt = digitalPinToInterrupt(inputPin);
-  if (_interrupt == interrupt) {
-    return;
+static void calc_gap_classes() {
+  GapClass_t classes[MAX_GAP_CLASSES];
+  uint8_t count = 0;
+  uint16_t last = 0;
+  while (true) {
+    // next longer footer of the enabled protocols
+    uint32_t gap = std::numeric_limits<uint32_t>::max();
+    for (protocols_t *pnode = get_used_protocols(); pnode != nullptr;
+         pnode = pnode->next) {
+      const protocol_t *protocol = pnode->listener;
+      if ((protocol->parseCode != nullptr) && (protocol->mingaplen > last) &&
+          (protocol->mingaplen < gap)) {
+        gap = protocol->mingaplen;
+      }
+    }
+    if (gap == std::numeric_limits<uint32_t>::max()) {
+      break;
+    }
+    if ((count == 0) ||
+        ((count < MAX_GAP_CLASSES) &&
+         (gap >= (uint32_t)classes[count - 1].mingaplen * GAP_CLASS_RATIO))) {
+      classes[count].mingaplen = (uint16_t)gap;
+      classes[count].minrawlen = std::numeric_limits<uint8_t>::max();
+      classes[count].maxrawlen = std::numeric_limits<uint8_t>::min();
+      classes[count].protocols = 0;
+      count++;
+    }
+    last = (uint16_t)gap;
   }
-  if (_interrupt >= 0) {
-    detachInterrupt((uint8_t)_interrupt);
+  if (count == 0) {
+    classes[0].mingaplen = ESPiLightBase::mingaplen;
+    classes[0].minrawlen = ESPiLightBase::minrawlen;
+    classes[0].maxrawlen = ESPiLightBase::maxrawlen;
+    classes[0].protocols = 0;
+    count = 1;
+  }
+  for (protocols_t *pnode = get_registered_protocols(); pnode != nullptr;
+       pnode = pnode->next) {
+    protocol_t *protocol = pnode->listener;
+    uint8_t gapClass = 0;
+    while ((gapClass + 1 < count) &&
+           (classes[gapClass + 1].mingaplen <= protocol->mingaplen)) {
+      gapClass++;
+    }
+    protocol->gapclass = gapClass;
+  }
+  for (protocols_t *pnode = get_used_protocols(); pnode != nullptr;
+       pnode = pnode->next) {
+    const protocol_t *protocol = pnode->listener;
+    if (protocol->parseCode == nullptr) {
+      continue;
+    }
+    GapClass_t &gap_class = classes[protocol->gapclass];
+    gap_class.protocols++;
+    if (protocol->minrawlen < gap_class.minrawlen) {
+      gap_class.minrawlen = protocol->minrawlen;
+    }
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wtype-limits"
+    if ((protocol->maxrawlen > gap_class.maxrawlen) &&
+        (protocol->maxrawlen <= MAXPULSESTREAMLENGTH)) {
+#pragma GCC diagnostic pop
+      gap_class.maxrawlen = protocol->maxrawlen;
+    }
   }
-  _interrupt = interrupt;
 
-  resetReceiver();
-  enableReceiver();
+  noInterrupts();
+  for (uint8_t i = 0; i < count; i++) {
+    ESPiLightBase::gapClasses[i] = classes[i];
+  }
+  ESPiLightBase::gapClassCount = count;
+  ESPiLightBase::gapClassUpdates++;
+  interrupts();
+
+  for (uint8_t i = 0; i < count; i++) {
+    Debug("gap class ");
+    Debug(i);
+    Debug(": ");
+    Debug(classes[i].mingaplen);
+    Debug(", protocols: ");
+    DebugLn(classes[i].protocols);
+  }
+}
 
-  if (interrupt >= 0) {
-    attachInterrupt((uint8_t)interrupt, interruptHandler, CHANGE);
+void ESPiLightBase::waitForHandler() {
+  // the handler may run on the other core of an ESP32, a handler started
+  // after the barrier already reads the new pointers
+  __sync_synchronize();
+  while (_inHandler) {
   }
 }
 
-uint8_t ESPiLight::receivePulseTrain(uint16_t *pulses) {
-  uint8_t length = nextPulseTrainLength();
+void ICACHE_RAM_ATTR ESPiLightBase::captureEdge(unsigned long now) {
+  EdgeCapture *capture = _capture;
+  if (capture != nullptr) {
+    capture->record(now);
+  }
+}
 
-  if (length > 0) {
-    volatile PulseTrain_t &pulseTrain = _pulseTrains[_avaiablePulseTrain];
-    _avaiablePulseTrain = (_avaiablePulseTrain + 1) % RECEIVER_BUFFER_SIZE;
-    for (uint8_t i = 0; i < length; i++) {
-      pulses[i] = pulseTrain.pulses[i];
+void ICACHE_RAM_ATTR ESPiLightBase::calibrateEdge(unsigned long duration) {
+  PulseCalibration *calibration = _calibration;
+  if (calibration != nullptr) {
+    calibration->addEdge(duration);
+  }
+}
+
+bool ESPiLightBase::startCapture(Print &output, size_t size) {
+  stopCapture();
+  EdgeCapture *capture = new EdgeCapture(output, size);
+  if ((capture == nullptr) || !capture->valid()) {
+    delete capture;
+    return false;
+  }
+  _capture = capture;
+  return true;
+}
+
+void ESPiLightBase::stopCapture() {
+  EdgeCapture *capture = _capture;
+  if (capture != nullptr) {
+    _capture = nullptr;
+    waitForHandler();
+    capture->flush();
+    delete capture;
+  }
+}
+
+void ESPiLightBase::flushCapture() {
+  EdgeCapture *capture = _capture;
+  if (capture != nullptr) {
+    capture->flush();
+  }
+}
+
+bool ESPiLightBase::setCalibrationEnabled(bool enabled, bool apply) {
+  PulseCalibration *calibration = _calibration;
+  _calibration = nullptr;
+  waitForHandler();
+  delete calibration;
+  calibration_apply = apply;
+  calibration_restart = true;
+  if (enabled) {
+    get_used_protocols();
+    _calibration = new PulseCalibration();
+    return _calibration != nullptr;
+  }
+  return true;
+}
+
+const PulseCalibration *ESPiLightBase::getCalibration() { return _calibration; }
+
+void ESPiLightBase::setClock(unsigned long (*clock)(void)) { _clock = clock; }
+
+void ESPiLightBase::getMemoryUsage(MemoryUsage_t &usage, bool resetPeaks) {
+  usage = MemoryUsage_t();
+  usage.receiverBytes = sizeof(gapClasses);
+  usage.stackBytes = MAXPULSESTREAMLENGTH * sizeof(uint16_t);
+  usage.repeatBytes = repeat_bytes;
+
+  for (protocols_t *pnode = get_registered_protocols(); pnode != nullptr;
+       pnode = pnode->next) {
+    const protocol_t *protocol = pnode->listener;
+    usage.protocols++;
+    usage.protocolBytes += sizeof(protocol_t) + sizeof(protocols_t);
+    if (protocol->stats != nullptr) {
+      usage.statsBytes += sizeof(protocol_stats_t);
     }
-    pulseTrain.length = 0;
   }
-  return length;
+  if (get_used_protocols() != get_registered_protocols()) {
+    for (protocols_t *pnode = get_used_protocols(); pnode != nullptr;
+         pnode = pnode->next) {
+      usage.filterBytes += sizeof(protocols_t);
+    }
+  }
+  EdgeCapture *capture = _capture;
+  if (capture != nullptr) {
+    usage.captureBytes = capture->memoryUsage();
+  }
+  if (_calibration != nullptr) {
+    usage.calibrationBytes = sizeof(PulseCalibration);
+  }
+
+  usage.decodePeak = decode_heap_peak;
+  usage.encodePeak = encode_heap_peak;
+  if (resetPeaks) {
+    decode_heap_peak = 0;
+    encode_heap_peak = 0;
+  }
 }
 
-uint8_t ESPiLight::nextPulseTrainLength() {
-  return _pulseTrains[_avaiablePulseTrain].length;
+uint8_t ESPiLightBase::getGapClasses(GapClass_t *classes, uint8_t size) {
+  get_used_protocols();
+  const uint8_t count = gapClassCount;
+  for (uint8_t i = 0; (i < count) && (i < size); i++) {
+    classes[i] = gapClasses[i];
+  }
+  return count;
 }
 
-void ICACHE_RAM_ATTR ESPiLight::interruptHandler() {
-  if (!_enabledReceiver) {
-    return;
+#define STATE_ALL_PROTOCOLS 0x01  // flag: no limitProtocols() filter
+
+namespace {
+
+/**
+ * Little endian writer of a state snapshot, counts the bytes beyond the
+ * buffer.
+ */
+class StateWriter {
+ public:
+  StateWriter(uint8_t *buffer, size_t size)
+      : _buffer(buffer), _size(size), _length(0) {}
+
+  void u8(uint8_t value) {
+    if (_length < _size) {
+      _buffer[_length] = value;
+    }
+    _length++;
   }
 
-  volatile PulseTrain_t &pulseTrain = _pulseTrains[_actualPulseTrain];
-  volatile uint16_t *codes = pulseTrain.pulses;
-
-  if (pulseTrain.length == 0) {
-    const unsigned long now = micros();
-    const unsigned int duration = now - _lastChange;
-
-    /* We first do some filtering (same as pilight BPF) */
-    if (duration > minpulselen) {
-      if (duration < maxpulselen) {
-        /* All codes are buffered */
-        codes[_nrpulses] = (uint16_t)duration;
-        _nrpulses = (uint8_t)((_nrpulses + 1) % MAXPULSESTREAMLENGTH);
-        /* Let's match footers */
-        if (duration > mingaplen) {
-          // Debug('g');
-          /* Only match minimal length pulse streams */
-          if (_nrpulses >= minrawlen && _nrpulses <= maxrawlen) {
-            // Debug(_nrpulses);
-            // Debug('l');
-            pulseTrain.length = _nrpulses;
-            _actualPulseTrain = (_actualPulseTrain + 1) % RECEIVER_BUFFER_SIZE;
-          }
-          _nrpulses = 0;
-        }
-      }
-      _lastChange = now;
+  void u16(uint16_t value) {
+    u8((uint8_t)value);
+    u8((uint8_t)(value >> 8));
+  }
+
+  void u32(uint32_t value) {
+    u16((uint16_t)value);
+    u16((uint16_t)(value >> 16));
+  }
+
+  bool ok() const { return _length <= _size; }
+  size_t length() const { return _length; }
+
+ private:
+  uint8_t *_buffer;
+  size_t _size;
+  size_t _length;
+};
+
+/**
+ * Little endian reader of a state snapshot, reads zeros beyond the end.
+ */
+class StateReader {
+ public:
+  StateReader(const uint8_t *data, size_t size)
+      : _data(data), _size(size), _pos(0) {}
+
+  uint8_t u8() {
+    const uint8_t value = (_pos < _size) ? _data[_pos] : 0;
+    _pos++;
+    return value;
+  }
+
+  uint16_t u16() {
+    const uint16_t low = u8();
+    return (uint16_t)(low | (u8() << 8));
+  }
+
+  uint32_t u32() {
+    const uint32_t low = u16();
+    return low | ((uint32_t)u16() << 16);
+  }
+
+  bool ok() const { return _pos <= _size; }
+  size_t pos() const { return _pos; }
+
+ private:
+  const uint8_t *_data;
+  size_t _size;
+  size_t _pos;
+};
+
+uint32_t state_checksum(const uint8_t *data, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+}  // namespace
+
+size_t ESPiLightBase::saveState(uint8_t *buffer, size_t size) const {
+  protocols_t *used = get_used_protocols();
+  StateWriter writer(buffer, size);
+
+  writer.u8('E');
+  writer.u8('W');
+  writer.u8(STATE_SNAPSHOT_VERSION);
+  writer.u32(protocol_init_fingerprint());
+  writer.u8((uint8_t)protocol_count);
+  const bool all = (used == pilight_protocols) || adaptive_copy;
+  writer.u8(all ? STATE_ALL_PROTOCOLS : 0);
+
+  writer.u8(minrawlen);
+  writer.u8(maxrawlen);
+  writer.u16(mingaplen);
+  writer.u16(maxgaplen);
+  writer.u16(minpulselen);
+  writer.u16(maxpulselen);
+
+  const uint8_t classes = gapClassCount;
+  writer.u8(classes);
+  for (uint8_t i = 0; i < classes; i++) {
+    writer.u16(gapClasses[i].mingaplen);
+    writer.u8(gapClasses[i].minrawlen);
+    writer.u8(gapClasses[i].maxrawlen);
+    writer.u8(gapClasses[i].protocols);
+  }
+
+  uint8_t enabled = 0;
+  for (protocols_t *pnode = used; pnode != nullptr; pnode = pnode->next) {
+    enabled++;
+  }
+  writer.u8(enabled);
+  for (protocols_t *pnode = used; pnode != nullptr; pnode = pnode->next) {
+    const protocol_t *protocol = pnode->listener;
+    writer.u8(protocol->index);
+    writer.u8(protocol->gapclass);
+    writer.u8((uint8_t)protocol->priority);
+    writer.u16(protocol->score);
+  }
+
+  // repeat detection of the protocols that received a message recently,
+  // a restored one if this instance did not decode since the warm start
+  const RepeatState_t *states =
+      (_repeatStates != nullptr) ? _repeatStates : restored_repeats;
+  const unsigned long now = _clock();
+  uint8_t recent = 0;
+  for (size_t i = 0; (states != nullptr) && (i < protocol_count); i++) {
+    const RepeatState_t &state = states[i];
+    if ((state.second != 0) && (now - state.second <= REPEAT_RESET_TIME)) {
+      recent++;
+    }
+  }
+  writer.u8(recent);
+  for (size_t i = 0; (states != nullptr) && (i < protocol_count); i++) {
+    const RepeatState_t &state = states[i];
+    if ((state.second != 0) && (now - state.second <= REPEAT_RESET_TIME)) {
+      writer.u8((uint8_t)i);
+      writer.u8(state.repeats);
+      writer.u32((uint32_t)(now - state.second));
+      writer.u32((state.old_content != nullptr)
+                     ? content_hash(state.old_content)
+                     : state.old_hash);
     }
-  } else {
-    Debug("_!_");
   }
+
+  if (!writer.ok()) {
+    return 0;
+  }
+  writer.u32(state_checksum(buffer, writer.length()));
+  return writer.ok() ? writer.length() : 0;
 }
 
-void ESPiLight::resetReceiver() {
-  for (unsigned int i = 0; i < RECEIVER_BUFFER_SIZE; i++) {
-    _pulseTrains[i].length = 0;
+bool ESPiLightBase::saveState(StateStore &store) const {
+  const size_t capacity = store.capacity();
+  uint8_t *buffer = new uint8_t[capacity];
+  if (buffer == nullptr) {
+    return false;
   }
-  _avaiablePulseTrain = 0;
-  _actualPulseTrain = 0;
-  _nrpulses = 0;
+  const size_t length = saveState(buffer, capacity);
+  const bool stored = (length > 0) && store.write(buffer, length);
+  delete[] buffer;
+  return stored;
 }
 
-void ESPiLight::enableReceiver() { _enabledReceiver = true; }
+/**
+ * Returns: registered protocol index or nullptr if not found
+ */
+static protocol_t *find_protocol_index(uint8_t index) {
+  for (protocols_t *pnode = pilight_protocols; pnode != nullptr;
+       pnode = pnode->next) {
+    if (pnode->listener->index == index) {
+      return pnode->listener;
+    }
+  }
+  return nullptr;
+}
 
-void ESPiLight::disableReceiver() { _enabledReceiver = false; }
+int ESPiLightBase::restoreState(const uint8_t *data, size_t size,
+                                unsigned long slept) {
+  if ((size < 3) || (data[0] != 'E') || (data[1] != 'W') ||
+      (data[2] != STATE_SNAPSHOT_VERSION)) {
+    return ERROR_INVALID_STATE_VERSION;
+  }
+  if (size < 3 + 4) {
+    return ERROR_INVALID_STATE_TRUNCATED;
+  }
+  size -= 4;
+  StateReader checksum(data + size, 4);
+  if (checksum.u32() != state_checksum(data, size)) {
+    return ERROR_INVALID_STATE_CHECKSUM;
+  }
 
-void ESPiLight::loop() {
-  int length = 0;
-  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  // validate everything before the state is changed
+  StateReader reader(data + 3, size - 3);
+  if ((reader.u32() != protocol_init_fingerprint()) ||
+      (reader.u8() != protocol_init_count())) {
+    return ERROR_INVALID_STATE_FIRMWARE;
+  }
+  const uint8_t count = (uint8_t)protocol_init_count();
+  const bool all = (reader.u8() & STATE_ALL_PROTOCOLS) != 0;
+  const size_t tablesPos = reader.pos();
+  reader.u8();
+  reader.u8();
+  reader.u32();
+  reader.u32();
+  const uint8_t classCount = reader.u8();
+  if ((classCount == 0) || (classCount > MAX_GAP_CLASSES)) {
+    return ERROR_INVALID_STATE_TABLE;
+  }
+  for (uint8_t i = 0; i < classCount; i++) {
+    reader.u32();
+    reader.u8();
+  }
+  const size_t enabledPos = reader.pos();
+  const uint8_t enabled = reader.u8();
+  uint32_t seen[256 / 32] = {0};
+  for (uint8_t i = 0; i < enabled; i++) {
+    const uint8_t index = reader.u8();
+    const uint8_t gapClass = reader.u8();
+    reader.u8();
+    reader.u16();
+    if ((index >= count) || (gapClass >= classCount) ||
+        (seen[index / 32] & (1u << (index % 32)))) {
+      return ERROR_INVALID_STATE_TABLE;
+    }
+    seen[index / 32] |= 1u << (index % 32);
+  }
+  if ((enabled == 0) || (all && (enabled != count))) {
+    return ERROR_INVALID_STATE_TABLE;
+  }
+  const size_t repeatsPos = reader.pos();
+  const uint8_t recent = reader.u8();
+  for (uint8_t i = 0; i < recent; i++) {
+    if (reader.u8() >= count) {
+      return ERROR_INVALID_STATE_TABLE;
+    }
+    reader.u8();
+    reader.u32();
+    reader.u32();
+  }
+  if (!reader.ok() || (reader.pos() != size - 3)) {
+    return ERROR_INVALID_STATE_TRUNCATED;
+  }
 
-  length = receivePulseTrain(pulses);
+  // register only the enabled protocols, the others on demand
+  if (pilight_protocols == nullptr) {
+    default_error_output();
+    protocol_count = count;
+    if (all) {
+      protocol_init();
+    } else {
+      reader = StateReader(data + 3 + enabledPos, size - 3 - enabledPos);
+      reader.u8();
+      for (uint8_t i = 0; i < enabled; i++) {
+        protocol_init_one(reader.u8());
+        reader.u8();
+        reader.u8();
+        reader.u16();
+      }
+      missing_protocols = true;
+    }
+  } else if (missing_protocols) {
+    register_missing_protocols();
+  }
 
-  if (length > 0) {
-    /*
-    Debug("RAW (");
-    Debug(length);
-    Debug("): ");
-    for(int i=0;i<length;i++) {
-      Debug(pulses[i]);
-      Debug(' ');
+  // enabled protocols, a filter list like limitProtocols() in the order
+  // of the snapshot, the registered protocols keep their order
+  free_used_protocols();
+  protocols_t *list = nullptr;
+  protocols_t **tail = &list;
+  reader = StateReader(data + 3 + enabledPos, size - 3 - enabledPos);
+  reader.u8();
+  for (uint8_t i = 0; i < enabled; i++) {
+    protocol_t *protocol = find_protocol_index(reader.u8());
+    const uint8_t gapclass = reader.u8();
+    const int8_t priority = (int8_t)reader.u8();
+    const uint16_t score = reader.u16();
+    if (protocol == nullptr) {
+      continue;
+    }
+    protocol->gapclass = gapclass;
+    protocol->priority = priority;
+    protocol->score = score;
+    if (!all) {
+      protocols_t *node = new protocols_t;
+      node->listener = protocol;
+      node->next = nullptr;
+      *tail = node;
+      tail = &node->next;
+    }
+  }
+  used_protocols = list;
+
+  reader = StateReader(data + 3 + tablesPos, size - 3 - tablesPos);
+  ESPiLightBase::minrawlen = reader.u8();
+  ESPiLightBase::maxrawlen = reader.u8();
+  ESPiLightBase::mingaplen = reader.u16();
+  ESPiLightBase::maxgaplen = reader.u16();
+  ESPiLightBase::minpulselen = reader.u16();
+  ESPiLightBase::maxpulselen = reader.u16();
+  GapClass_t classes[MAX_GAP_CLASSES];
+  const uint8_t gapCount = reader.u8();
+  for (uint8_t i = 0; i < gapCount; i++) {
+    classes[i].mingaplen = reader.u16();
+    classes[i].minrawlen = reader.u8();
+    classes[i].maxrawlen = reader.u8();
+    classes[i].protocols = reader.u8();
+  }
+  noInterrupts();
+  for (uint8_t i = 0; i < gapCount; i++) {
+    gapClasses[i] = classes[i];
+  }
+  gapClassCount = gapCount;
+  gapClassUpdates++;
+  interrupts();
+
+  // repeat detection for the next instance, aged by the sleep
+  if (restored_repeats == nullptr) {
+    restored_repeats = new RepeatState_t[protocol_count]();
+    repeat_bytes += protocol_count * sizeof(RepeatState_t);
+  } else {
+    for (size_t i = 0; i < protocol_count; i++) {
+      restored_repeats[i] = RepeatState_t();
     }
-    DebugLn();
-    */
-    parsePulseTrain(pulses, (uint8_t)length);
   }
+  const unsigned long now = _clock();
+  reader = StateReader(data + 3 + repeatsPos, size - 3 - repeatsPos);
+  reader.u8();
+  for (uint8_t i = 0; i < recent; i++) {
+    RepeatState_t &state = restored_repeats[reader.u8()];
+    const uint8_t repeats = reader.u8();
+    const uint32_t age = reader.u32();
+    const uint32_t hash = reader.u32();
+    if ((age > REPEAT_RESET_TIME) || (slept > REPEAT_RESET_TIME - age)) {
+      continue;
+    }
+    state.repeats = repeats;
+    state.second = now - slept - age;
+    if (state.second == 0) {
+      state.second = 1;  // 0 is no message
+    }
+    state.first = state.second;
+    state.old_hash = hash;
+  }
+  return enabled;
 }
 
-ESPiLight::ESPiLight(int8_t outputPin) {
+int ESPiLightBase::restoreState(StateStore &store, unsigned long slept) {
+  const size_t capacity = store.capacity();
+  uint8_t *buffer = new uint8_t[capacity];
+  if (buffer == nullptr) {
+    return ERROR_INVALID_STATE_TRUNCATED;
+  }
+  const size_t length = store.read(buffer, capacity);
+  const int result = restoreState(buffer, length, slept);
+  delete[] buffer;
+  return result;
+}
+
+ESPiLightBase::ESPiLightBase(int8_t outputPin) {
   _outputPin = outputPin;
   _callback = nullptr;
   _rawCallback = nullptr;
+  _unknownCallback = nullptr;
+  _events = nullptr;
+  _repeatStates = nullptr;
+  _voter = nullptr;
   _echoEnabled = false;
+  _normalizeEnabled = false;
+  _streamDecoders = nullptr;
+  _streamedSlot = -1;
+  _streamedProtocol = nullptr;
+  _skipProtocol = nullptr;
+  _matchPolicy = MATCH_ALL;
+  _adaptiveOrder = false;
+  _streamLastTime = 0;
+  _streamRepeats = 0;
 
   if (_outputPin >= 0) {
     pinMode((uint8_t)_outputPin, OUTPUT);
     digitalWrite((uint8_t)_outputPin, LOW);
   }
 
-  get_protocols();
+  get_registered_protocols();
+}
+
+ESPiLightBase::~ESPiLightBase() {
+  if (_repeatStates != nullptr) {
+    for (size_t i = 0; i < protocol_count; i++) {
+      set_old_content(_repeatStates[i], nullptr);
+    }
+    delete[] _repeatStates;
+    repeat_bytes -= protocol_count * sizeof(RepeatState_t);
+  }
+  delete _voter;
 }
 
-void ESPiLight::setCallback(ESPiLightCallBack callback) {
+void ESPiLightBase::setCallback(ESPiLightCallBack callback) {
   _callback = callback;
 }
 
-void ESPiLight::setPulseTrainCallBack(PulseTrainCallBack rawCallback) {
+void ESPiLightBase::setEventRing(EventRing *events) { _events = events; }
+
+void ESPiLightBase::setPulseTrainCallBack(PulseTrainCallBack rawCallback) {
   _rawCallback = rawCallback;
 }
 
-void ESPiLight::sendPulseTrain(const uint16_t *pulses, size_t length,
-                               size_t repeats) {
+void ESPiLightBase::addStreamingDecoder(StreamingDecoder *decoder) {
+  decoder->_next = _streamDecoders;
+  _streamDecoders = decoder;
+  decoder->reset();
+}
+
+void ESPiLightBase::feedStreamingDecoders(uint16_t pulse, uint8_t slot) {
+  for (StreamingDecoder *decoder = _streamDecoders; decoder != nullptr;
+       decoder = decoder->_next) {
+    if (!decoder->feed(pulse) || (_callback == nullptr)) {
+      continue;
+    }
+    const unsigned long now = _clock();
+    const String &message = decoder->message();
+    PilightRepeatStatus_t status = FIRST;
+    if ((now - _streamLastTime > 500000) || (message != _streamLast)) {
+      _streamRepeats = 1;
+      _streamLast = message;
+    } else {
+      _streamRepeats++;
+      status = (_streamRepeats == 2) ? VALID : KNOWN;
+    }
+    _streamLastTime = now;
+    _streamedSlot = slot;
+    _streamedProtocol = decoder->protocol();
+    _callback(String(decoder->protocol()), message, status, _streamRepeats,
+              String());
+  }
+}
+
+void ESPiLightBase::resetStreamingDecoders() {
+  for (StreamingDecoder *decoder = _streamDecoders; decoder != nullptr;
+       decoder = decoder->_next) {
+    decoder->reset();
+  }
+}
+
+void ESPiLightBase::setUnknownPulseTrainCallBack(
+    PulseTrainCallBack unknownCallback) {
+  _unknownCallback = unknownCallback;
+}
+
+void ESPiLightBase::sendPulseTrain(const uint16_t *pulses, size_t length,
+                                   size_t repeats) {
   if (_outputPin >= 0) {
-    bool receiverState = _enabledReceiver;
-    _enabledReceiver = (_echoEnabled && receiverState);
+    const bool muted = _receiverMuted;
+    _receiverMuted = !_echoEnabled;
     for (unsigned int r = 0; r < repeats; r++) {
       for (unsigned int i = 0; i < length; i += 2) {
         digitalWrite((uint8_t)_outputPin, HIGH);
@@ -331,12 +1039,12 @@ void ESPiLight::sendPulseTrain(const uint16_t *pulses, size_t length,
       }
     }
     digitalWrite((uint8_t)_outputPin, LOW);
-    _enabledReceiver = receiverState;
+    _receiverMuted = muted;
   }
 }
 
-int ESPiLight::send(const String &protocol, const String &json,
-                    size_t repeats) {
+int ESPiLightBase::send(const String &protocol, const String &json,
+                        size_t repeats) {
   if (_outputPin < 0) {
     DebugLn("No output pin set, cannot send");
     return ERROR_NO_OUTPUT_PIN;
@@ -365,194 +1073,729 @@ int ESPiLight::send(const String &protocol, const String &json,
   return length;
 }
 
-int ESPiLight::createPulseTrain(uint16_t *pulses, const String &protocol_id,
-                                const String &content) {
+int ESPiLightBase::createPulseTrain(uint16_t *pulses, const String &protocol_id,
+                                    const String &content) {
   protocol_t *protocol = find_protocol(protocol_id.c_str());
   return create_pulse_train(pulses, protocol, content);
 }
 
-size_t ESPiLight::parsePulseTrain(uint16_t *pulses, uint8_t length) {
+/**
+ * Restart the calibration for the bounds of calc_lengths(), all enabled
+ * protocols are unseen again.
+ */
+static void restart_calibration(PulseCalibration *calibration) {
+  calibration->reset();
+  for (protocols_t *pnode = get_protocols(); pnode != nullptr;
+       pnode = pnode->next) {
+    pnode->listener->calibrated = 0;
+  }
+  calibration_restart = false;
+  calibration_seen = true;
+}
+
+/**
+ * Returns: shortest pulse expected from the enabled protocols that were not
+ * decoded since the calibration restarted, estimated from their footers
+ */
+static uint16_t unseen_pulse_min() {
+  uint16_t shortest = 0xFFFF;
+  for (protocols_t *pnode = get_used_protocols(); pnode != nullptr;
+       pnode = pnode->next) {
+    const protocol_t *protocol = pnode->listener;
+    if ((protocol->parseCode == nullptr) || protocol->calibrated) {
+      continue;
+    }
+    const uint16_t pulse =
+        protocol->mingaplen / PulseCalibration::CALIBRATION_FOOTER_RATIO;
+    if (pulse < shortest) {
+      shortest = pulse;
+    }
+  }
+  return shortest;
+}
+
+size_t ESPiLightBase::parsePulseTrain(uint16_t *pulses, uint8_t length) {
+  PulseCalibration *calibration = _calibration;
+  if ((calibration != nullptr) && calibration_restart) {
+    restart_calibration(calibration);
+  }
+  if (_normalizeEnabled) {
+    uint16_t types[MAX_PULSE_TYPES];
+    normalizePulseTrain(pulses, length, types, nullptr, true);
+  }
+
+  // frame already decoded by a streaming decoder
+  const char *skipProtocol = _skipProtocol;
+  _skipProtocol = nullptr;
+  // frame of a gap class, only for the protocols of the class
+  const uint8_t gapClass = _receivedGapClass;
+  _receivedGapClass = 0;
+
+  size_t matches = decodePulseTrain(pulses, length, skipProtocol, gapClass);
+  if (_voter != nullptr) {
+    _voter->add(pulses, length, _clock());
+    uint16_t *consensus = (matches == 0) ? _voter->vote() : nullptr;
+    if (consensus != nullptr) {
+      matches = decodePulseTrain(consensus, length, nullptr, gapClass);
+      if (matches > 0) {
+        match_stats.recovered++;
+        _voter->clear();
+      }
+    }
+  }
+  if (calibration != nullptr) {
+    calibration->addFrame(pulses, length, matches > 0);
+    if (calibration_seen) {
+      calibration->setUnseenMin(unseen_pulse_min());
+      calibration_seen = false;
+    }
+    if (calibration_apply) {
+      calibration->update(maxgaplen, minpulselen, maxpulselen);
+    }
+  }
+  if (_rawCallback != nullptr) {
+    (_rawCallback)(pulses, length);
+  }
+  if ((matches == 0) && (_unknownCallback != nullptr)) {
+    (_unknownCallback)(pulses, length);
+  }
+
+  // Debug("piLightParsePulseTrain end. matches: ");
+  // DebugLn(matches);
+  return matches;
+}
+
+size_t ESPiLightBase::decodePulseTrain(uint16_t *pulses, uint8_t length,
+                                       const char *skipProtocol,
+                                       uint8_t gapClass) {
   size_t matches = 0;
   protocol_t *protocol = nullptr;
-  protocols_t *pnode = get_used_protocols();
+  protocols_t *pnode =
+      _adaptiveOrder ? get_adaptive_protocols() : get_used_protocols();
+
+  decode_heap_start = ESP.getFreeHeap();
+  protocol_pulse_bits_reset();
+
+  if (_repeatStates == nullptr) {
+    // repeat detection of a warm start, already counted in repeat_bytes
+    _repeatStates = restored_repeats;
+    restored_repeats = nullptr;
+  }
+  if (_repeatStates == nullptr) {
+    _repeatStates = new RepeatState_t[protocol_count]();
+    repeat_bytes += protocol_count * sizeof(RepeatState_t);
+  }
+  protocol_ctx_t ctx;
+  ctx.raw = pulses;
+  ctx.rawlen = length;
+  ctx.message = nullptr;
+
+  protocols_t *matched[MAX_FRAME_MATCHES];
+  protocols_t *best = nullptr;      // MATCH_PRIORITY
+  JsonNode *bestMessage = nullptr;  // message of best
+  protocols_t *reported = nullptr;  // adaptive order
+  size_t found = 0;
 
   // DebugLn("piLightParsePulseTrain start");
-  while ((pnode != nullptr) && (_callback != nullptr)) {
+  while ((pnode != nullptr) &&
+         ((_callback != nullptr) || (_events != nullptr))) {
     protocol = pnode->listener;
 
-    if (protocol->parseCode != nullptr && protocol->validate != nullptr) {
-      protocol->raw = pulses;
-      protocol->rawlen = length;
+    if (protocol->parseCode != nullptr && protocol->validate != nullptr &&
+        (gapClass == 0 || protocol->gapclass == gapClass) &&
+        (skipProtocol == nullptr || strcmp(protocol->id, skipProtocol) != 0)) {
+      protocol_stats_t *stats = protocol->stats;
+      uint32_t cycles = (stats != nullptr) ? ESP.getCycleCount() : 0;
+      const int valid = protocol_validate(protocol, &ctx);
+      if (stats != nullptr) {
+        cycles = ESP.getCycleCount() - cycles;
+        stats->validateCalls++;
+        stats->validateCycles += cycles;
+        if (cycles > stats->validateMaxCycles) {
+          stats->validateMaxCycles = cycles;
+        }
+      }
 
-      if (protocol->validate() == 0) {
+      if (valid == 0) {
         Debug("pulses: ");
         Debug(length);
         Debug(" possible protocol: ");
         DebugLn(protocol->id);
 
-        if (protocol->first > 0) {
-          protocol->first = protocol->second;
+        RepeatState_t &state = _repeatStates[protocol->index];
+        if (state.first > 0) {
+          state.first = state.second;
         }
-        protocol->second = micros();
-        if (protocol->first == 0) {
-          protocol->first = protocol->second;
+        state.second = _clock();
+        if (state.first == 0) {
+          state.first = state.second;
         }
 
         /* Reset # of repeats after a certain delay */
-        if ((protocol->second - protocol->first) > 500000) {
-          protocol->repeats = 0;
+        if ((state.second - state.first) > REPEAT_RESET_TIME) {
+          state.repeats = 0;
         }
 
-        protocol->message = nullptr;
-        protocol->parseCode();
-        if (protocol->message != nullptr) {
-          matches++;
-          protocol->repeats++;
-
-          fire_callback(protocol, _callback);
-
-          json_delete(protocol->message);
-          protocol->message = nullptr;
+        uint32_t heap = 0;
+        if (stats != nullptr) {
+          stats->validatePasses++;
+          heap = ESP.getFreeHeap();
+          cycles = ESP.getCycleCount();
+        }
+        protocol_parse(protocol, &ctx);
+        sample_heap(decode_heap_start, decode_heap_peak);
+        if (stats != nullptr) {
+          cycles = ESP.getCycleCount() - cycles;
+          stats->parseCycles += cycles;
+          if (cycles > stats->parseMaxCycles) {
+            stats->parseMaxCycles = cycles;
+          }
+          const uint32_t freeHeap = ESP.getFreeHeap();
+          if (freeHeap < heap) {
+            stats->heapBytes += heap - freeHeap;
+          }
+          if (ctx.message != nullptr) {
+            stats->parseSuccesses++;
+          } else {
+            stats->falsePositives++;
+          }
+        }
+        if (ctx.message != nullptr) {
+          if (!protocol->calibrated) {
+            protocol->calibrated = 1;
+            calibration_seen = true;
+          }
+          if (found < MAX_FRAME_MATCHES) {
+            matched[found] = pnode;
+          }
+          found++;
+          if (_matchPolicy != MATCH_PRIORITY) {
+            report_message(protocol, state, ctx.message, _callback, _events);
+            reported = pnode;
+            matches++;
+          } else if ((best == nullptr) ||
+                     (protocol->priority > best->listener->priority)) {
+            json_delete(bestMessage);
+            best = pnode;
+            bestMessage = ctx.message;
+          } else {
+            json_delete(ctx.message);
+          }
         }
       }
     }
-    pnode = pnode->next;
+    protocols_t *next = pnode->next;
+    if (_adaptiveOrder && (reported != nullptr)) {
+      // moves the node only in front of already tried protocols
+      promote_protocol(reported);
+      reported = nullptr;
+    }
+    if ((_matchPolicy == MATCH_FIRST) && (matches > 0)) {
+      break;
+    }
+    pnode = next;
   }
-  if (_rawCallback != nullptr) {
-    (_rawCallback)(pulses, length);
+  if (best != nullptr) {
+    report_message(best->listener, _repeatStates[best->listener->index],
+                   bestMessage, _callback, _events);
+    matches++;
+    if (_adaptiveOrder) {
+      promote_protocol(best);
+    }
   }
 
-  // Debug("piLightParsePulseTrain end. matches: ");
-  // DebugLn(matches);
+  match_stats.frames++;
+  if (found > 0) {
+    match_stats.matched++;
+  }
+  if (found > 1) {
+    match_stats.conflicts++;
+    match_stats.suppressed += found - matches;
+    for (size_t i = 0; (i < found) && (i < MAX_FRAME_MATCHES); i++) {
+      if (matched[i]->listener->stats != nullptr) {
+        matched[i]->listener->stats->conflicts++;
+      }
+    }
+  }
+  if (_adaptiveOrder && ((match_stats.frames % 32) == 0)) {
+    for (protocols_t *node = get_used_protocols(); node != nullptr;
+         node = node->next) {
+      // rounded up, the scores reach 0
+      node->listener->score -= (node->listener->score + 7) >> 3;
+    }
+  }
   return matches;
 }
 
-static void fire_callback(protocol_t *protocol, ESPiLightCallBack callback) {
+static uint32_t content_hash(const char *content) {
+  uint32_t hash = 2166136261u;
+  for (const char *c = content; *c != '\0'; c++) {
+    hash = (hash ^ (uint8_t)*c) * 16777619u;
+  }
+  return (hash != 0) ? hash : 1;  // 0 is no content
+}
+
+static void set_old_content(RepeatState_t &state, char *content) {
+  if (state.old_content != nullptr) {
+    repeat_bytes -= strlen(state.old_content) + 1;
+  }
+  json_free(state.old_content);
+  state.old_content = content;
+  state.old_hash = 0;
+  if (content != nullptr) {
+    repeat_bytes += strlen(content) + 1;
+  }
+}
+
+static PilightRepeatStatus_t repeat_status(RepeatState_t &state,
+                                           JsonNode *message) {
   PilightRepeatStatus_t status = FIRST;
-  char *content = json_encode(protocol->message);
-  String deviceId = "";
-  double itmp;
-  char *stmp;
+  char *content = json_encode(message);
 
-  if ((protocol->repeats <= 1) || (protocol->old_content == nullptr)) {
+  if ((state.repeats <= 1) ||
+      ((state.old_content == nullptr) && (state.old_hash == 0))) {
     status = FIRST;
-    json_free(protocol->old_content);
-    protocol->old_content = content;
-  } else if (!(protocol->repeats & 0x80)) {
-    if (strcmp(content, protocol->old_content) == 0) {
-      protocol->repeats |= 0x80;
+    set_old_content(state, content);
+  } else if (!(state.repeats & 0x80)) {
+    const bool same = (state.old_content != nullptr)
+                          ? (strcmp(content, state.old_content) == 0)
+                          : (content_hash(content) == state.old_hash);
+    if (same) {
+      state.repeats |= 0x80;
       status = VALID;
     } else {
       status = INVALID;
     }
-    json_free(protocol->old_content);
-    protocol->old_content = content;
+    set_old_content(state, content);
+  } else if (state.old_content == nullptr) {
+    // warm start, the callback reports the content of the last message
+    status = KNOWN;
+    set_old_content(state, content);
   } else {
     status = KNOWN;
     json_free(content);
   }
-  if (json_find_number(protocol->message, "id", &itmp) == 0) {
-    deviceId = String((int)round(itmp));
-  } else if (json_find_string(protocol->message, "id", &stmp) == 0) {
+  return status;
+}
+
+static void fire_callback(const protocol_t *protocol,
+                          const RepeatState_t &state,
+                          PilightRepeatStatus_t status, JsonNode *message,
+                          const ESPiLightCallBack &callback) {
+  String deviceId = "";
+  FixedPoint_t id;
+  char *stmp;
+
+  // rounded id from the json text, avoids floating point
+  if (findFixedPoint(state.old_content, "id", id)) {
+    deviceId = String(roundFixedPoint(id));
+  } else if (json_find_string(message, "id", &stmp) == 0) {
     deviceId = String(stmp);
   };
-  (callback)(String(protocol->id), String(protocol->old_content), status,
-             protocol->repeats & 0x7F, deviceId);
+  const String protocolId(protocol->id);
+  const String content(state.old_content);
+  sample_heap(decode_heap_start, decode_heap_peak);
+  (callback)(protocolId, content, status, state.repeats & 0x7F, deviceId);
 }
 
-String ESPiLight::pulseTrainToString(const uint16_t *codes, size_t length) {
-  bool match = false;
-  int diff = 0;
+static void push_event(const protocol_t *protocol, const RepeatState_t &state,
+                       PilightRepeatStatus_t status, EventRing *events) {
+  ESPiLightEvent_t event;
+  FixedPoint_t id;
 
-  uint8_t nrpulses = 0;  // number of pulse types
-  uint16_t plstypes[MAX_PULSE_TYPES] = {};
+  event.time = state.second;
+  event.deviceId = EVENT_NO_DEVICE_ID;
+  if (findFixedPoint(state.old_content, "id", id)) {
+    event.deviceId = roundFixedPoint(id);
+  }
+  event.protocol = protocol->index;
+  event.status = (uint8_t)status;
+  event.repeats = state.repeats & 0x7F;
+  sample_heap(decode_heap_start, decode_heap_peak);
+  events->push(event, state.old_content);
+}
 
-  String data("");
-  data.reserve(6 + length);
-  data += "c:";
-  for (unsigned int i = 0; i < length; i++) {
-    match = false;
-    for (uint8_t j = 0; j < MAX_PULSE_TYPES; j++) {
-      // We device these numbers by 10 to normalize them a bit
-      diff = (plstypes[j] / 50) - (codes[i] / 50);
+namespace {
+
+/**
+ * Pulse type table of the pilight USB Nano format. A pulse belongs to the
+ * first known type that is within +-2 steps of 50 us.
+ */
+class PulseTypeTable {
+ public:
+  PulseTypeTable() : _count(0) {}
+
+  /**
+   * Returns: index of the pulse type or -1 if there are too many types
+   */
+  int classify(uint16_t pulse) {
+    const int bucket = pulse / 50;
+    for (uint8_t j = 0; j < _count; j++) {
+      const int diff = _buckets[j] - bucket;
       if ((diff >= -2) && (diff <= 2)) {
-        // Write numbers
-        data += (char)('0' + ((char)j));
-        match = true;
-        break;
+        return j;
       }
     }
-    if (!match) {
-      plstypes[nrpulses++] = codes[i];
-      data += (char)('0' + ((char)(nrpulses - 1)));
-      if (nrpulses >= MAX_PULSE_TYPES) {
-        DebugLn("too many pulse types");
-        return String("");
+    if (_count + 1 >= MAX_PULSE_TYPES) {
+      return -1;
+    }
+    _types[_count] = pulse;
+    _buckets[_count] = (uint16_t)bucket;
+    return _count++;
+  }
+
+  uint8_t count() const { return _count; }
+  uint16_t type(uint8_t index) const { return _types[index]; }
+
+ private:
+  uint16_t _types[MAX_PULSE_TYPES];
+  uint16_t _buckets[MAX_PULSE_TYPES];
+  uint8_t _count;
+};
+
+/**
+ * Incremental parser of the pilight USB Nano format. The pulse type
+ * indices are stored in the output array and resolved when the message is
+ * finished, because the pulse types follow after the pulses.
+ */
+class PulseTrainStringParser {
+ public:
+  PulseTrainStringParser(uint16_t *codes, size_t maxlength)
+      : _codes(codes),
+        _maxlength(maxlength),
+        _length(0),
+        _nrtypes(0),
+        _value(0),
+        _state(KEY),
+        _key(0),
+        _seenCodes(false),
+        _seenTypes(false),
+        _endTypes(false),
+        _error(0) {}
+
+  /**
+   * Parse next character.
+   * Returns: false if the message is complete or invalid
+   */
+  bool feed(char c) {
+    switch (_state) {
+      case KEY:
+        if (c == ':') {
+          return startValue();
+        } else if (c == '@') {
+          _state = DONE;
+        } else {
+          _key = c;
+        }
+        break;
+      case CODES:
+        if ((c == ';') || (c == '@')) {
+          return endValue(c);
+        }
+        if ((c < '0') || (c - '0' >= MAX_PULSE_TYPES)) {
+          DebugLn("Pulse type not defined");
+          return fail(ESPiLightBase::ERROR_INVALID_PULSETRAIN_MSG_TYPE);
+        }
+        if (_length < _maxlength) {
+          _codes[_length++] = (uint16_t)(c - '0');
+        }
+        break;
+      case TYPES:
+        if ((c >= '0') && (c <= '9')) {
+          _value = _value * 10 + (unsigned)(c - '0');
+        } else if ((c == ',') || (c == ';') || (c == '@')) {
+          if (_nrtypes >= MAX_PULSE_TYPES) {
+            DebugLn("too many pulse types");
+            return fail(ESPiLightBase::ERROR_INVALID_PULSETRAIN_MSG_P);
+          }
+          _types[_nrtypes++] = (uint16_t)_value;
+          _value = 0;
+          if (c != ',') {
+            _endTypes = true;
+            return endValue(c);
+          }
+        }
+        break;
+      case SKIP:
+        if ((c == ';') || (c == '@')) {
+          return endValue(c);
+        }
+        break;
+      case DONE:
+        break;
+    }
+    return _state != DONE;
+  }
+
+  /**
+   * Returns: length of pulse train or ERROR_INVALID_PULSETRAIN_MSG_*
+   */
+  int finish() {
+    if (_error != 0) {
+      return _error;
+    }
+    if (!_seenCodes) {
+      DebugLn("'c' not found in data string, or has no data");
+      return ESPiLightBase::ERROR_INVALID_PULSETRAIN_MSG_C;
+    }
+    if (!_seenTypes) {
+      DebugLn("'p' not found in data string, or has no data");
+      return ESPiLightBase::ERROR_INVALID_PULSETRAIN_MSG_P;
+    }
+    if (!_endTypes) {
+      DebugLn("';' or '@' not found in data string");
+      return ESPiLightBase::ERROR_INVALID_PULSETRAIN_MSG_END;
+    }
+    for (size_t i = 0; i < _length; i++) {
+      if (_codes[i] >= _nrtypes) {
+        DebugLn("Pulse type not defined");
+        return ESPiLightBase::ERROR_INVALID_PULSETRAIN_MSG_TYPE;
       }
+      _codes[i] = _types[_codes[i]];
     }
+    return (int)_length;
   }
-  data += ";p:";
-  for (uint8_t i = 0; i < nrpulses; i++) {
-    data += plstypes[i];
-    if (i + 1 < nrpulses) {
-      data += ',';
+
+ private:
+  enum State { KEY, CODES, TYPES, SKIP, DONE };
+
+  bool startValue() {
+    _state = SKIP;
+    if ((_key == 'c') && !_seenCodes) {
+      _seenCodes = true;
+      _state = CODES;
+    } else if ((_key == 'p') && !_seenTypes) {
+      _seenTypes = true;
+      _state = TYPES;
     }
+    return true;
+  }
+
+  bool endValue(char c) {
+    _key = 0;
+    _state = (c == '@') ? DONE : KEY;
+    return _state != DONE;
+  }
+
+  bool fail(int error) {
+    _error = error;
+    _state = DONE;
+    return false;
+  }
+
+  uint16_t *_codes;
+  size_t _maxlength;
+  size_t _length;
+  uint16_t _types[MAX_PULSE_TYPES];
+  uint8_t _nrtypes;
+  unsigned long _value;
+  State _state;
+  char _key;
+  bool _seenCodes;
+  bool _seenTypes;
+  bool _endTypes;
+  int _error;
+};
+
+size_t format_uint(char *buffer, uint16_t value) {
+  char digits[5];
+  size_t count = 0;
+  do {
+    digits[count++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+  for (size_t i = 0; i < count; i++) {
+    buffer[i] = digits[count - 1 - i];
+  }
+  return count;
+}
+
+bool put_varint(uint8_t *&pos, const uint8_t *end, unsigned long value) {
+  do {
+    if (pos >= end) {
+      return false;
+    }
+    uint8_t byte = value & 0x7F;
+    value >>= 7;
+    if (value > 0) {
+      byte |= 0x80;
+    }
+    *pos++ = byte;
+  } while (value > 0);
+  return true;
+}
+
+bool get_varint(const uint8_t *&pos, const uint8_t *end,
+                unsigned long &value) {
+  value = 0;
+  for (unsigned int shift = 0; shift < 32; shift += 7) {
+    if (pos >= end) {
+      return false;
+    }
+    const uint8_t byte = *pos++;
+    value |= (unsigned long)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Print appending to a String, which should be reserved before.
+ */
+class StringPrint : public Print {
+ public:
+  explicit StringPrint(String &data) : _data(data) {}
+
+  size_t write(uint8_t c) override {
+    _data += (char)c;
+    return 1;
+  }
+  using Print::write;
+
+ private:
+  String &_data;
+};
+
+}  // namespace
+
+String ESPiLightBase::pulseTrainToString(const uint16_t *codes, size_t length) {
+  String data("");
+  // "c:" + pulses + ";p:" + MAX_PULSE_TYPES * "65535," + "@", written into
+  // the string without a temporary buffer
+  data.reserve(6 + length + 6 * MAX_PULSE_TYPES);
+  StringPrint output(data);
+  if (pulseTrainToString(codes, length, output) == 0) {
+    data = "";
   }
-  data += '@';
   return data;
 }
 
-int ESPiLight::stringToPulseTrain(const String &data, uint16_t *codes,
-                                  size_t maxlength) {
-  unsigned int length = 0;    // length of pulse train
-  unsigned int nrpulses = 0;  // number of pulse types
-  uint16_t plstypes[MAX_PULSE_TYPES] = {};
-
-  // validate data string
-  int scode = data.indexOf('c') + 2;
-  if (scode < 2 || (unsigned)scode > data.length()) {
-    DebugLn("'c' not found in data string, or has no data");
-    return ERROR_INVALID_PULSETRAIN_MSG_C;
-  }
-  int spulse = data.indexOf('p') + 2;
-  if (spulse < 2 || (unsigned)spulse > data.length()) {
-    DebugLn("'p' not found in data string, or has no data");
-    return ERROR_INVALID_PULSETRAIN_MSG_P;
-  }
-  // parsing pulse types
-  unsigned int start = (unsigned)spulse;
-  int end = data.indexOf(',', start);
-  while (end > 0) {
-    plstypes[nrpulses++] =
-        (uint16_t)data.substring(start, (unsigned)end).toInt();
-    start = (unsigned)end + 1;
-    end = data.indexOf(',', start);
-  }
-  end = data.indexOf(';', start);
-  if (end < 0) {
-    end = data.indexOf('@', start);
+size_t ESPiLightBase::pulseTrainToString(const uint16_t *codes, size_t length,
+                                         char *buffer, size_t size) {
+  PulseTypeTable types;
+
+  // "c:" + pulses + ";p:" + "@\0"
+  if (size < length + 7) {
+    DebugLn("buffer too small");
+    if (size > 0) {
+      buffer[0] = '\0';
+    }
+    return 0;
   }
-  if (end < 0) {
-    DebugLn("';' or '@' not found in data string");
-    return ERROR_INVALID_PULSETRAIN_MSG_END;
+  char *pos = buffer;
+  *pos++ = 'c';
+  *pos++ = ':';
+  for (size_t i = 0; i < length; i++) {
+    const int type = types.classify(codes[i]);
+    if (type < 0) {
+      DebugLn("too many pulse types");
+      buffer[0] = '\0';
+      return 0;
+    }
+    *pos++ = (char)('0' + type);
   }
-  plstypes[nrpulses++] = (uint16_t)data.substring(start, (unsigned)end).toInt();
-  // parsing pulses
-  int pulse_index = 0;
-  for (unsigned int i = (unsigned)scode; i < data.length(); i++) {
-    if ((data[i] == ';') || (data[i] == '@')) break;
-    if (i >= maxlength) break;
-    pulse_index = data[i] - '0';
-    if ((pulse_index < 0) || ((unsigned)pulse_index >= nrpulses)) {
-      DebugLn("Pulse type not defined");
-      return ERROR_INVALID_PULSETRAIN_MSG_TYPE;
+  *pos++ = ';';
+  *pos++ = 'p';
+  *pos++ = ':';
+  const char *end = buffer + size - 2;  // reserve "@\0"
+  for (uint8_t i = 0; i < types.count(); i++) {
+    char digits[6];
+    size_t count = 0;
+    if (i > 0) {
+      digits[count++] = ',';
     }
-    codes[length++] = plstypes[pulse_index];
+    count += format_uint(&digits[count], types.type(i));
+    if (pos + count > end) {
+      DebugLn("buffer too small");
+      buffer[0] = '\0';
+      return 0;
+    }
+    memcpy(pos, digits, count);
+    pos += count;
   }
-  return length;
+  *pos++ = '@';
+  *pos = '\0';
+  return (size_t)(pos - buffer);
+}
+
+size_t ESPiLightBase::pulseTrainToString(const uint16_t *codes, size_t length,
+                                         Print &output) {
+  PulseTypeTable types;
+
+  // first pass: the type table has to be complete before writing, a pulse
+  // is classified to the same type in both passes
+  for (size_t i = 0; i < length; i++) {
+    if (types.classify(codes[i]) < 0) {
+      DebugLn("too many pulse types");
+      return 0;
+    }
+  }
+
+  char chunk[32];
+  size_t fill = 0;
+  size_t written = 0;
+  auto put = [&](char c) {
+    if (fill == sizeof(chunk)) {
+      written += output.write((const uint8_t *)chunk, fill);
+      fill = 0;
+    }
+    chunk[fill++] = c;
+  };
+
+  put('c');
+  put(':');
+  for (size_t i = 0; i < length; i++) {
+    put((char)('0' + types.classify(codes[i])));
+  }
+  put(';');
+  put('p');
+  put(':');
+  for (uint8_t i = 0; i < types.count(); i++) {
+    char digits[5];
+    if (i > 0) {
+      put(',');
+    }
+    const size_t count = format_uint(digits, types.type(i));
+    for (size_t j = 0; j < count; j++) {
+      put(digits[j]);
+    }
+  }
+  put('@');
+  written += output.write((const uint8_t *)chunk, fill);
+  return written;
+}
+
+int ESPiLightBase::stringToPulseTrain(const String &data, uint16_t *codes,
+                                      size_t maxlength) {
+  return stringToPulseTrain(data.c_str(), data.length(), codes, maxlength);
+}
+
+int ESPiLightBase::stringToPulseTrain(const char *data, size_t datalen,
+                                      uint16_t *codes, size_t maxlength) {
+  PulseTrainStringParser parser(codes, maxlength);
+  for (size_t i = 0; i < datalen; i++) {
+    if (!parser.feed(data[i])) {
+      break;
+    }
+  }
+  return parser.finish();
+}
+
+int ESPiLightBase::stringToPulseTrain(Stream &input, uint16_t *codes,
+                                      size_t maxlength) {
+  PulseTrainStringParser parser(codes, maxlength);
+  char c;
+  while (input.readBytes(&c, 1) == 1) {
+    if (!parser.feed(c)) {
+      break;
+    }
+  }
+  return parser.finish();
 }
 
-int ESPiLight::stringToRepeats(const String &data) {
+int ESPiLightBase::stringToRepeats(const String &data) {
   // parsing (optional) repeats
   int srepeat = data.indexOf('r') + 2;
   if (srepeat < 2 || (unsigned)srepeat > data.length()) {
@@ -571,7 +1814,251 @@ int ESPiLight::stringToRepeats(const String &data) {
   return data.substring(start, (unsigned)end).toInt();
 }
 
-void ESPiLight::limitProtocols(const String &protos) {
+size_t ESPiLightBase::pulseTrainToBinary(const uint16_t *codes, size_t length,
+                                         uint8_t *buffer, size_t size) {
+  PulseTypeTable types;
+  uint8_t nrtypes = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (types.classify(codes[i]) < 0) {
+      DebugLn("too many pulse types, use varint encoding");
+      break;
+    }
+    if (i + 1 == length) {
+      nrtypes = types.count();
+    }
+  }
+
+  uint8_t *pos = buffer;
+  const uint8_t *end = buffer + size;
+  if (size < 2) {
+    return 0;
+  }
+  *pos++ = PULSETRAIN_BINARY_VERSION;
+  *pos++ = nrtypes;
+  if (!put_varint(pos, end, length)) {
+    return 0;
+  }
+  if (nrtypes == 0) {
+    for (size_t i = 0; i < length; i++) {
+      if (!put_varint(pos, end, codes[i])) {
+        return 0;
+      }
+    }
+    return (size_t)(pos - buffer);
+  }
+  for (uint8_t i = 0; i < nrtypes; i++) {
+    if (!put_varint(pos, end, types.type(i))) {
+      return 0;
+    }
+  }
+  if ((size_t)(end - pos) < (length + 1) / 2) {
+    return 0;
+  }
+  for (size_t i = 0; i < length; i += 2) {
+    uint8_t byte = (uint8_t)types.classify(codes[i]);
+    if (i + 1 < length) {
+      byte |= (uint8_t)(types.classify(codes[i + 1]) << 4);
+    }
+    *pos++ = byte;
+  }
+  return (size_t)(pos - buffer);
+}
+
+int ESPiLightBase::binaryToPulseTrain(const uint8_t *data, size_t size,
+                                      uint16_t *codes, size_t maxlength) {
+  const uint8_t *pos = data;
+  const uint8_t *end = data + size;
+  unsigned long length;
+  unsigned long value;
+
+  if ((size < 2) || (data[0] != PULSETRAIN_BINARY_VERSION)) {
+    DebugLn("unknown binary pulse train version");
+    return ERROR_INVALID_PULSETRAIN_BIN_VERSION;
+  }
+  const uint8_t nrtypes = data[1];
+  pos += 2;
+  if (nrtypes > MAX_PULSE_TYPES) {
+    DebugLn("too many pulse types");
+    return ERROR_INVALID_PULSETRAIN_BIN_TYPE;
+  }
+  if (!get_varint(pos, end, length)) {
+    return ERROR_INVALID_PULSETRAIN_BIN_TRUNCATED;
+  }
+  if (length > maxlength) {
+    length = maxlength;
+  }
+  if (nrtypes == 0) {
+    for (size_t i = 0; i < length; i++) {
+      if (!get_varint(pos, end, value)) {
+        return ERROR_INVALID_PULSETRAIN_BIN_TRUNCATED;
+      }
+      codes[i] = (uint16_t)value;
+    }
+    return (int)length;
+  }
+  uint16_t plstypes[MAX_PULSE_TYPES];
+  for (uint8_t i = 0; i < nrtypes; i++) {
+    if (!get_varint(pos, end, value)) {
+      return ERROR_INVALID_PULSETRAIN_BIN_TRUNCATED;
+    }
+    plstypes[i] = (uint16_t)value;
+  }
+  if ((size_t)(end - pos) < (length + 1) / 2) {
+    return ERROR_INVALID_PULSETRAIN_BIN_TRUNCATED;
+  }
+  for (size_t i = 0; i < length; i++) {
+    const uint8_t type = (i & 1) ? (pos[i / 2] >> 4) : (pos[i / 2] & 0x0F);
+    if (type >= nrtypes) {
+      DebugLn("Pulse type not defined");
+      return ERROR_INVALID_PULSETRAIN_BIN_TYPE;
+    }
+    codes[i] = plstypes[type];
+  }
+  return (int)length;
+}
+
+// merge the two neighbouring clusters with the smallest ratio of widths
+static void merge_closest_clusters(unsigned long *sums, uint16_t *counts,
+                                   uint8_t &nrclusters) {
+  uint8_t best = 0;
+  unsigned long bestDist = std::numeric_limits<unsigned long>::max();
+  for (uint8_t j = 0; j + 1 < nrclusters; j++) {
+    const unsigned long dist =
+        sums[j + 1] / counts[j + 1] * 100 / (sums[j] / counts[j] + 1);
+    if (dist < bestDist) {
+      bestDist = dist;
+      best = j;
+    }
+  }
+  sums[best] += sums[best + 1];
+  counts[best] += counts[best + 1];
+  nrclusters--;
+  for (uint8_t j = best + 1; j < nrclusters; j++) {
+    sums[j] = sums[j + 1];
+    counts[j] = counts[j + 1];
+  }
+}
+
+/**
+ * normalizePulseTrain() with the sorted pulse widths in sorted (length
+ * pulses). If rewritten is not nullptr, the type of every pulse is written
+ * into rewritten, which may be pulses.
+ */
+static uint8_t normalize_pulses(const uint16_t *pulses, size_t length,
+                                uint16_t *types, uint8_t *indices,
+                                uint16_t *rewritten, uint16_t *sorted) {
+  const uint8_t maxtypes = MAX_PULSE_TYPES - 1;  // limit of string format
+  unsigned long sums[MAX_PULSE_TYPES];
+  uint16_t counts[MAX_PULSE_TYPES];
+  uint16_t centroids[MAX_PULSE_TYPES];
+  uint8_t nrclusters = 0;
+
+  if ((length == 0) || (length > MAXPULSESTREAMLENGTH)) {
+    return 0;
+  }
+
+  // seed: split sorted pulse widths at gaps larger than 25%, merge the
+  // closest neighbours whenever the limit of pulse types is exceeded
+  memcpy(sorted, pulses, length * sizeof(uint16_t));
+  std::sort(sorted, sorted + length);
+  size_t start = 0;
+  unsigned long sum = 0;
+  for (size_t i = 0; i < length; i++) {
+    if ((i > 0) && (sorted[i] - sorted[i - 1] > sorted[i - 1] / 4)) {
+      sums[nrclusters] = sum;
+      counts[nrclusters++] = (uint16_t)(i - start);
+      if (nrclusters > maxtypes) {
+        merge_closest_clusters(sums, counts, nrclusters);
+      }
+      start = i;
+      sum = 0;
+    }
+    sum += sorted[i];
+  }
+  sums[nrclusters] = sum;
+  counts[nrclusters++] = (uint16_t)(length - start);
+  if (nrclusters > maxtypes) {
+    merge_closest_clusters(sums, counts, nrclusters);
+  }
+  for (uint8_t j = 0; j < nrclusters; j++) {
+    centroids[j] = (uint16_t)((sums[j] + counts[j] / 2) / counts[j]);
+  }
+
+  // refine: k-means iterations on the sorted widths
+  for (uint8_t iteration = 0; iteration < 4; iteration++) {
+    bool changed = false;
+    uint8_t j = 0;
+    for (uint8_t k = 0; k < nrclusters; k++) {
+      sums[k] = 0;
+      counts[k] = 0;
+    }
+    for (size_t i = 0; i < length; i++) {
+      while ((j + 1 < nrclusters) &&
+             (sorted[i] - centroids[j] > centroids[j + 1] - sorted[i])) {
+        j++;
+      }
+      sums[j] += sorted[i];
+      counts[j]++;
+    }
+    uint8_t k = 0;
+    for (j = 0; j < nrclusters; j++) {
+      if (counts[j] == 0) {
+        continue;
+      }
+      const uint16_t centroid =
+          (uint16_t)((sums[j] + counts[j] / 2) / counts[j]);
+      changed |= (centroid != centroids[k]) || (j != k);
+      centroids[k++] = centroid;
+    }
+    nrclusters = k;
+    if (!changed) {
+      break;
+    }
+  }
+
+  // assign pulses, order types by first appearance
+  uint8_t order[MAX_PULSE_TYPES];
+  uint8_t nrtypes = 0;
+  memset(order, 0xFF, sizeof(order));
+  for (size_t i = 0; i < length; i++) {
+    uint8_t j = 0;
+    while ((j + 1 < nrclusters) &&
+           (pulses[i] - centroids[j] > centroids[j + 1] - pulses[i])) {
+      j++;
+    }
+    if (order[j] == 0xFF) {
+      order[j] = nrtypes;
+      types[nrtypes++] = centroids[j];
+    }
+    if (indices != nullptr) {
+      indices[i] = order[j];
+    }
+    if (rewritten != nullptr) {
+      rewritten[i] = centroids[j];
+    }
+  }
+  return nrtypes;
+}
+
+uint8_t ESPiLightBase::normalizePulseTrain(uint16_t *pulses, size_t length,
+                                           uint16_t *types, uint8_t *indices,
+                                           bool rewrite) {
+  uint16_t sorted[MAXPULSESTREAMLENGTH];
+  return normalize_pulses(pulses, length, types, indices,
+                          rewrite ? pulses : nullptr, sorted);
+}
+
+uint8_t ESPiLightBase::normalizePulseTrain(const uint16_t *pulses,
+                                           size_t length, uint16_t *types,
+                                           uint8_t *indices, uint16_t *sorted) {
+  if (sorted == nullptr) {
+    uint16_t buffer[MAXPULSESTREAMLENGTH];
+    return normalize_pulses(pulses, length, types, indices, nullptr, buffer);
+  }
+  return normalize_pulses(pulses, length, types, indices, nullptr, sorted);
+}
+
+void ESPiLightBase::limitProtocols(const String &protos) {
   if (!json_validate(protos.c_str())) {
     DebugLn("Protocol limit argument is not a valid json message!");
     return;
@@ -584,16 +2071,8 @@ void ESPiLight::limitProtocols(const String &protos) {
     return;
   }
 
-  if (get_used_protocols() != get_protocols()) {
-    protocols_t *pnode = get_used_protocols();
-    while (pnode != nullptr) {
-      protocols_t *tmp = pnode;
-      pnode = pnode->next;
-      delete tmp;
-    }
-  }
-
-  used_protocols = nullptr;
+  get_protocols();
+  free_used_protocols();
   JsonNode *curr = message->children.head;
   unsigned int proto_count = 0;
 
@@ -661,14 +2140,182 @@ static String protocols_to_array(protocols_t *pnode) {
   return ret;
 }
 
-String ESPiLight::availableProtocols() {
+const char *ESPiLightBase::protocolName(uint8_t index) {
+  for (protocols_t *pnode = get_registered_protocols(); pnode != nullptr;
+       pnode = pnode->next) {
+    if (pnode->listener->index == index) {
+      return pnode->listener->id;
+    }
+  }
+  if (missing_protocols && (index < protocol_count)) {
+    get_protocols();
+    return protocolName(index);
+  }
+  return nullptr;
+}
+
+String ESPiLightBase::availableProtocols() {
   return protocols_to_array(get_protocols());
 }
 
-String ESPiLight::enabledProtocols() {
+String ESPiLightBase::enabledProtocols() {
   return protocols_to_array(get_used_protocols());
 }
 
-void ESPiLight::setEchoEnabled(bool enabled) { _echoEnabled = enabled; }
+void ESPiLightBase::setEchoEnabled(bool enabled) { _echoEnabled = enabled; }
+
+void ESPiLightBase::setNormalizeEnabled(bool enabled) {
+  _normalizeEnabled = enabled;
+}
+
+void ESPiLightBase::setErrorOutput(Print &output) {
+  set_aprintf_output(&output);
+  error_output_set = true;
+}
+
+void ESPiLightBase::setLogLevel(uint8_t level) { set_alog_level(level); }
+
+bool ESPiLightBase::setDeferredLogging(size_t size) {
+  return set_alog_buffer(size);
+}
+
+size_t ESPiLightBase::flushLog() { return alog_flush(); }
+
+void ESPiLightBase::setMatchPolicy(MatchPolicy_t policy) {
+  _matchPolicy = policy;
+}
+
+bool ESPiLightBase::setRepeatVoting(uint8_t depth, unsigned long window) {
+  if ((depth > 0) && (depth < RepeatVoter::MIN_VOTES)) {
+    return false;
+  }
+  delete _voter;
+  _voter = nullptr;
+  if (depth == 0) {
+    return true;
+  }
+  _voter = new RepeatVoter(depth, window);
+  if ((_voter == nullptr) || !_voter->valid()) {
+    delete _voter;
+    _voter = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void ESPiLightBase::setAdaptiveOrderEnabled(bool enabled) {
+  _adaptiveOrder = enabled;
+}
+
+bool ESPiLightBase::setProtocolPriority(const String &protocol,
+                                        int8_t priority) {
+  protocol_t *listener = find_protocol(protocol.c_str());
+  if (listener == nullptr) {
+    return false;
+  }
+  listener->priority = priority;
+  return true;
+}
+
+void ESPiLightBase::getMatchStats(MatchStats_t &stats, bool reset) {
+  stats = match_stats;
+  if (reset) {
+    match_stats = MatchStats_t();
+  }
+}
+
+void ESPiLightBase::setProtocolStatsEnabled(bool enabled) {
+  protocols_t *pnode = get_protocols();
+  while (pnode != nullptr) {
+    protocol_t *protocol = pnode->listener;
+    if (enabled && (protocol->stats == nullptr)) {
+      protocol->stats = new protocol_stats_t();
+    } else if (!enabled) {
+      delete protocol->stats;
+      protocol->stats = nullptr;
+    }
+    pnode = pnode->next;
+  }
+}
+
+void ESPiLightBase::resetProtocolStats() {
+  protocols_t *pnode = get_protocols();
+  while (pnode != nullptr) {
+    if (pnode->listener->stats != nullptr) {
+      *pnode->listener->stats = protocol_stats_t();
+    }
+    pnode = pnode->next;
+  }
+}
+
+static const struct {
+  const char *name;
+  unsigned long protocol_stats_t::*counter;
+  bool total;
+} stats_fields[] = {
+    {"validate_calls", &protocol_stats_t::validateCalls, true},
+    {"validate_passes", &protocol_stats_t::validatePasses, true},
+    {"parse_successes", &protocol_stats_t::parseSuccesses, true},
+    {"false_positives", &protocol_stats_t::falsePositives, true},
+    {"validate_cycles", &protocol_stats_t::validateCycles, true},
+    {"validate_max_cycles", &protocol_stats_t::validateMaxCycles, false},
+    {"parse_cycles", &protocol_stats_t::parseCycles, true},
+    {"parse_max_cycles", &protocol_stats_t::parseMaxCycles, false},
+    {"heap_bytes", &protocol_stats_t::heapBytes, true},
+    {"conflicts", &protocol_stats_t::conflicts, true},
+};
+
+void ESPiLightBase::printProtocolStats(Print &output, StatsFormat_t format) {
+  if (format == STATS_PROMETHEUS) {
+    for (const auto &field : stats_fields) {
+      output.print(F("# TYPE espilight_"));
+      output.print(field.name);
+      output.println(field.total ? F("_total counter") : F(" gauge"));
+      for (protocols_t *pnode = get_protocols(); pnode != nullptr;
+           pnode = pnode->next) {
+        const protocol_stats_t *stats = pnode->listener->stats;
+        if ((stats == nullptr) || (stats->validateCalls == 0)) {
+          continue;
+        }
+        output.print(F("espilight_"));
+        output.print(field.name);
+        if (field.total) {
+          output.print(F("_total"));
+        }
+        output.print(F("{protocol=\""));
+        output.print(pnode->listener->id);
+        output.print(F("\"} "));
+        output.println(stats->*field.counter);
+      }
+    }
+    return;
+  }
 
-void ESPiLight::setErrorOutput(Print &output) { set_aprintf_output(&output); }
+  bool first = true;
+  output.print('{');
+  for (protocols_t *pnode = get_protocols(); pnode != nullptr;
+       pnode = pnode->next) {
+    const protocol_stats_t *stats = pnode->listener->stats;
+    if ((stats == nullptr) || (stats->validateCalls == 0)) {
+      continue;
+    }
+    if (!first) {
+      output.print(',');
+    }
+    first = false;
+    output.print('"');
+    output.print(pnode->listener->id);
+    output.print(F("\":{"));
+    for (const auto &field : stats_fields) {
+      if (&field != stats_fields) {
+        output.print(',');
+      }
+      output.print('"');
+      output.print(field.name);
+      output.print(F("\":"));
+      output.print(stats->*field.counter);
+    }
+    output.print('}');
+  }
+  output.println('}');
+}
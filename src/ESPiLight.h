@@ -21,6 +21,7 @@
 
 #include <Arduino.h>
 #include <functional>
+#include "tools/pulsetrainqueue.h"
 
 #ifndef RECEIVER_BUFFER_SIZE
 #define RECEIVER_BUFFER_SIZE 10
@@ -32,12 +33,122 @@
 
 #define MAX_PULSE_TYPES 16
 
+#define RECEIVER_TELEMETRY_BINS 16
+
+#ifndef MAX_GAP_CLASSES
+#define MAX_GAP_CLASSES 4
+#endif
+
+// footer of a gap class is at least GAP_CLASS_RATIO times the previous one
+#define GAP_CLASS_RATIO 2
+
+class EdgeCapture;
+class EventRing;
+class PulseCalibration;
+class RepeatVoter;
+class StateStore;
+struct RepeatState_t;
+class StreamingDecoder;
+
+enum StatsFormat_t { STATS_JSON, STATS_PROMETHEUS };
+
 enum PilightRepeatStatus_t { FIRST, INVALID, VALID, KNOWN };
 
-typedef struct PulseTrain_t {
-  uint16_t pulses[MAXPULSESTREAMLENGTH];
-  uint8_t length;
-} PulseTrain_t;
+/**
+ * Which messages of a pulse train are reported, see
+ * ESPiLight::setMatchPolicy()
+ */
+enum MatchPolicy_t {
+  MATCH_ALL,      // messages of all protocols (default)
+  MATCH_FIRST,    // message of the first protocol, the others are not tried
+  MATCH_PRIORITY  // message of the protocol with the highest priority
+};
+
+typedef struct MatchStats_t {
+  uint32_t frames;      // decoded pulse trains, including consensus
+  uint32_t matched;     // pulse trains decoded by at least one protocol
+  uint32_t conflicts;   // pulse trains decoded by more than one protocol
+  uint32_t suppressed;  // messages not reported because of MATCH_PRIORITY
+  uint32_t recovered;   // pulse trains decoded by setRepeatVoting()
+} MatchStats_t;
+
+/**
+ * Result of ESPiLight::handleEdge()
+ */
+enum EdgeStatus_t {
+  EDGE_IGNORED,   // receiver disabled
+  EDGE_FILTERED,  // pulse shorter than minpulselen or longer than maxpulselen
+  EDGE_PULSE,     // pulse buffered
+  EDGE_FRAME,     // footer, frame added to the receiver queue
+  EDGE_REJECTED,  // footer, frame length outside minrawlen/maxrawlen
+  EDGE_BUSY,      // pulse lost, the receiver queue is full
+  EDGE_DROPPED    // footer, frame lost, the receiver queue is full
+};
+
+/**
+ * Receiver counters, only collected if the library is compiled with
+ * RECEIVER_TELEMETRY defined (see ESPiLight::getReceiverTelemetry())
+ */
+typedef struct ReceiverTelemetry_t {
+  uint32_t edges;          // calls of handleEdge() with enabled receiver
+  uint32_t edgeMinCycles;  // cycles (ESP.getCycleCount()) of handleEdge()
+  uint32_t edgeMaxCycles;
+  uint64_t edgeCycles;  // sum, average is edgeCycles / edges
+  // durations between edges, bin i counts [2^i, 2^(i+1)) us, the last bin
+  // counts all longer durations
+  uint32_t durations[RECEIVER_TELEMETRY_BINS];
+  uint32_t tooShort;  // durations <= minpulselen
+  uint32_t tooLong;   // durations >= maxpulselen
+  uint32_t busy;      // pulses lost, the receiver queue is full
+  uint32_t frames;    // EDGE_FRAME
+  uint32_t rejected;  // EDGE_REJECTED
+  uint32_t dropped;   // EDGE_DROPPED
+  uint8_t queueHighWater;  // maximal number of queued pulse trains
+  uint32_t dequeued;       // pulse trains taken by receivePulseTrain()
+  uint32_t latencyMin;     // us from the footer to receivePulseTrain()
+  uint32_t latencyMax;
+  uint64_t latency;  // sum, average is latency / dequeued
+} ReceiverTelemetry_t;
+
+/**
+ * Protocols with similar footers (gaps), see ESPiLight::getGapClasses()
+ */
+typedef struct GapClass_t {
+  uint16_t mingaplen;  // shortest footer of the protocols
+  uint8_t minrawlen;
+  uint8_t maxrawlen;
+  uint8_t protocols;  // number of enabled protocols
+} GapClass_t;
+
+/**
+ * RAM used by the library in bytes, see ESPiLight::getMemoryUsage().
+ * Heap sizes do not include the overhead of the allocator.
+ */
+typedef struct MemoryUsage_t {
+  // static
+  size_t receiverBytes;  // receiver queue (telemetry and gap classes)
+  size_t stackBytes;     // pulse buffer on the stack of loop() and send()
+  // heap resident
+  size_t protocols;         // number of registered protocols
+  size_t protocolBytes;     // protocol_t and protocols_t of all protocols
+  size_t filterBytes;       // protocol list of limitProtocols()
+  size_t repeatBytes;       // last message of every protocol (repeats)
+  size_t statsBytes;        // setProtocolStatsEnabled()
+  size_t captureBytes;      // startCapture()
+  size_t calibrationBytes;  // setCalibrationEnabled()
+  // transient peaks, sampled at the allocation peaks of every message
+  size_t decodePeak;  // parsePulseTrain(), up to the callback
+  size_t encodePeak;  // createPulseTrain() and send()
+} MemoryUsage_t;
+
+/**
+ * Receiver queue of ESPiLight, sized by RECEIVER_BUFFER_SIZE and
+ * MAXPULSESTREAMLENGTH (at most 255, the pulse train length is an
+ * uint8_t). See ESPiLightT for other sizes.
+ */
+typedef PulseTrainQueue<RECEIVER_BUFFER_SIZE, MAXPULSESTREAMLENGTH>
+    ReceiverQueue_t;
+typedef ReceiverQueue_t::PulseTrain PulseTrain_t;
 
 typedef std::function<void(const String &protocol, const String &message,
                            int status, size_t repeats, const String &deviceID)>
@@ -45,13 +156,12 @@ typedef std::function<void(const String &protocol, const String &message,
 typedef std::function<void(const uint16_t *pulses, size_t length)>
     PulseTrainCallBack;
 
-class ESPiLight {
+/**
+ * Protocols, decoding and transmitting of ESPiLight, independent of the
+ * size of the receiver queue (see ESPiLightT).
+ */
+class ESPiLightBase {
  public:
-  /**
-   * Constructor.
-   */
-  ESPiLight(int8_t outputPin);
-
   /**
    * Transmit pulse train
    */
@@ -69,13 +179,30 @@ class ESPiLight {
    */
   size_t parsePulseTrain(uint16_t *pulses, uint8_t length);
 
+  void setCallback(ESPiLightCallBack callback);
+  void setPulseTrainCallBack(PulseTrainCallBack rawCallback);
+
   /**
-   * Process receiver queue and fire callback
+   * Callback for pulse trains that were not decoded by any protocol (see
+   * RawCodeIndex).
    */
-  void loop();
+  void setUnknownPulseTrainCallBack(PulseTrainCallBack unknownCallback);
 
-  void setCallback(ESPiLightCallBack callback);
-  void setPulseTrainCallBack(PulseTrainCallBack rawCallback);
+  /**
+   * Queue the decoded messages into a fixed size ring, which is polled by
+   * the application (see EventRing). The callback is still fired if set,
+   * messages of streaming decoders are only reported by the callback.
+   * The ring is not owned by ESPiLight, nullptr disables the queueing.
+   */
+  void setEventRing(EventRing *events);
+
+  /**
+   * Add an incremental decoder (see StreamingDecoder), which is fed with
+   * the pulses of the frame in reception by loop(). A completed message is
+   * reported by the callback without waiting for the footer. The decoder
+   * is not owned by ESPiLight.
+   */
+  void addStreamingDecoder(StreamingDecoder *decoder);
 
   /**
    * If set to true, the receiver will temporarely be disabled when sending.
@@ -83,39 +210,99 @@ class ESPiLight {
   void setEchoEnabled(bool enabled);
 
   /**
-   * Initialise receiver
+   * If set to true, received pulse trains are normalized (see
+   * normalizePulseTrain()) before they are parsed. The callbacks receive
+   * the normalized pulse train.
    */
-  static void initReceiver(byte inputPin);
+  void setNormalizeEnabled(bool enabled);
 
   /**
-   * Get last received PulseTrain.
-   * Returns: length of PulseTrain or 0 if not avaiable
+   * Set which messages of a pulse train are reported (default MATCH_ALL).
    */
-  static uint8_t receivePulseTrain(uint16_t *pulses);
+  void setMatchPolicy(MatchPolicy_t policy);
 
   /**
-   * Check if new PulseTrain avaiable.
-   * Returns: 0 if no new PulseTrain avaiable
+   * Recover messages from corrupted repeats: the last depth (3 up to 9)
+   * pulse trains of the same length and signature (see RepeatVoter::add())
+   * within window us are buffered. If a pulse train is not decoded, the
+   * median of every pulse of the buffered pulse trains (at least 3) is
+   * decoded. The recovered messages are counted by getMatchStats(). A
+   * depth of 0 disables the voting.
+   * Returns: false if depth is 1 or 2, which can never vote (the voting
+   * is not changed), or if the buffer could not be allocated
    */
-  static uint8_t nextPulseTrainLength();
+  bool setRepeatVoting(uint8_t depth, unsigned long window = 500000);
 
   /**
-   * Enable Receiver. No need to call enableReceiver() after initReceiver().
+   * If set to true, protocols are tried in the order of their recent
+   * matches: a reporting protocol moves in front of all protocols with a
+   * lower score, the scores decay every 32 pulse trains. Useful with
+   * MATCH_FIRST. Without limitProtocols(), the order is kept in a copy of
+   * the protocol list, availableProtocols() is unchanged.
    */
-  static void enableReceiver();
+  void setAdaptiveOrderEnabled(bool enabled);
 
   /**
-   * Disable decoding. You can re-enable decoding by calling enableReceiver();
+   * Priority of protocol for MATCH_PRIORITY (default 0), on equal
+   * priorities the protocol tried first wins.
+   * Returns: false if the protocol is unknown
    */
-  static void disableReceiver();
+  static bool setProtocolPriority(const String &protocol, int8_t priority);
 
   /**
-   * interruptHandler is called on every change in the input
-   * signal. If RcPilight::initReceiver is called with interrupt <0,
-   * you have to call interruptHandler() yourself. (Or use
-   * InterruptChain)
+   * Copy the match counters into stats and reset them if reset is true.
    */
-  static void interruptHandler();
+  static void getMatchStats(MatchStats_t &stats, bool reset = false);
+
+  /**
+   * Account the RAM of the library without the receiver (see
+   * ESPiLightT::getMemoryUsage()). If resetPeaks is true, the transient
+   * peaks are reset.
+   */
+  static void getMemoryUsage(MemoryUsage_t &usage, bool resetPeaks = false);
+
+  /**
+   * Record all edges seen by interruptHandler() into a ring buffer of size
+   * edges. The edges are written to output (see EdgeCapture) by loop() or
+   * flushCapture(). size has to be at least 4.
+   * Returns: false if the ring buffer could not be allocated or size is
+   * too small
+   */
+  static bool startCapture(Print &output, size_t size = 256);
+
+  /**
+   * Write remaining edges and stop recording.
+   */
+  static void stopCapture();
+
+  /**
+   * Write recorded edges to the output of startCapture().
+   */
+  static void flushCapture();
+
+  /**
+   * Count the durations of all edges and the pulses of the decoded pulse
+   * trains in histograms (see PulseCalibration). With apply, minpulselen
+   * and maxpulselen are narrowed to the decoded pulses as soon as enough
+   * pulse trains were decoded, the noise is then filtered by the
+   * interrupt handler. The enabled protocols that were not decoded yet
+   * keep room below the bounds (estimated from their footers).
+   * limitProtocols() resets the bounds and restarts the calibration with
+   * the next pulse train, disabling frees the histograms and keeps the
+   * bounds.
+   * Returns: false if the histograms could not be allocated
+   */
+  static bool setCalibrationEnabled(bool enabled, bool apply = false);
+
+  /**
+   * Returns: histograms and derived bounds or nullptr if disabled
+   */
+  static const PulseCalibration *getCalibration();
+
+  /**
+   * Set the clock used for repeat detection, default is micros().
+   */
+  static void setClock(unsigned long (*clock)(void));
 
   /**
    * Limit the available protocols.
@@ -125,6 +312,12 @@ class ESPiLight {
    */
   static void limitProtocols(const String &protos);
 
+  /**
+   * Returns: id of the protocol with index (see ESPiLightEvent_t) or
+   * nullptr
+   */
+  static const char *protocolName(uint8_t index);
+
   /**
    * Return a json array containing all the available protocols.
    */
@@ -136,25 +329,218 @@ class ESPiLight {
   static String enabledProtocols();
 
   /**
-   * Set pilight error output Print class (default is Serial)
+   * Set pilight error output Print class (default is Serial), also if
+   * called before the protocols are initialized
    */
   static void setErrorOutput(Print &output);
 
+  /**
+   * Discard pilight messages with a priority above level (LOG_ERR = 3 ...
+   * LOG_DEBUG = 7). Messages above ESPILIGHT_LOG_LEVEL are already removed
+   * at compile time.
+   */
+  static void setLogLevel(uint8_t level);
+
+  /**
+   * Record pilight messages into a ring buffer of size bytes instead of
+   * formatting and writing them while decoding and encoding. The messages
+   * are written by flushLog(), which is called by loop(). A size of 0
+   * restores the synchronous output.
+   * Returns: false if the buffer could not be allocated
+   */
+  static bool setDeferredLogging(size_t size);
+
+  /**
+   * Write the recorded pilight messages to the error output.
+   * Returns: number of written messages
+   */
+  static size_t flushLog();
+
+  /**
+   * Count validate() and parseCode() calls, their cycles (see
+   * ESP.getCycleCount()) and the heap of the created messages for every
+   * protocol. Disabling frees the counters.
+   */
+  static void setProtocolStatsEnabled(bool enabled);
+
+  /**
+   * Reset the counters of setProtocolStatsEnabled().
+   */
+  static void resetProtocolStats();
+
+  /**
+   * Print the counters of all protocols that validated a pulse train as
+   * json object or Prometheus text format.
+   */
+  static void printProtocolStats(Print &output,
+                                 StatsFormat_t format = STATS_JSON);
+
+  /**
+   * The receiver ends a frame at every pulse longer than mingaplen. If the
+   * enabled protocols have footers of different magnitude (see
+   * GAP_CLASS_RATIO), the long pulses inside the frames of the protocols
+   * with long footers would split them. Therefore, the protocols are
+   * grouped into up to MAX_GAP_CLASSES gap classes, class 0 is segmented
+   * by mingaplen and decoded by all protocols. For the other classes, the
+   * receiver keeps a candidate frame in parallel, which ends only at a
+   * pulse longer than the mingaplen of the class. It is queued if it
+   * differs from the frame of class 0 and decoded only by the protocols of
+   * the class.
+   * Returns: number of gap classes, up to size are copied to classes
+   */
+  static uint8_t getGapClasses(GapClass_t *classes, uint8_t size);
+
   static uint8_t minrawlen;
   static uint8_t maxrawlen;
   static uint16_t mingaplen;
   static uint16_t maxgaplen;
   static uint16_t minpulselen;
   static uint16_t maxpulselen;
+  // gap classes of getGapClasses(), gapClassUpdates counts their changes
+  static GapClass_t gapClasses[MAX_GAP_CLASSES];
+  static volatile uint8_t gapClassCount;
+  static volatile uint8_t gapClassUpdates;
 
+  /**
+   * Format pulse train (format of pilight USB Nano) into a String, which
+   * is allocated once for the longest string of length pulses.
+   * Returns: the string or an empty string if the pulse train has too many
+   * pulse types
+   */
   static String pulseTrainToString(const uint16_t *pulses, size_t length);
+
+  /**
+   * Format pulse train (format of pilight USB Nano) into a caller
+   * provided buffer, including the terminating '\0'. No heap allocation.
+   * Returns: length of the string or 0 if the buffer is too small or the
+   * pulse train has too many pulse types.
+   */
+  static size_t pulseTrainToString(const uint16_t *pulses, size_t length,
+                                   char *buffer, size_t size);
+
+  /**
+   * Write pulse train (format of pilight USB Nano) to output. No heap
+   * allocation.
+   * Returns: number of written characters or 0 if the pulse train has too
+   * many pulse types (nothing is written in this case).
+   */
+  static size_t pulseTrainToString(const uint16_t *pulses, size_t length,
+                                   Print &output);
+
   static int stringToPulseTrain(const String &data, uint16_t *pulses,
                                 size_t maxlength);
+
+  /**
+   * Parse pulse train string of datalen characters. No heap allocation.
+   * Returns: length of pulse train or ERROR_INVALID_PULSETRAIN_MSG_*
+   */
+  static int stringToPulseTrain(const char *data, size_t datalen,
+                                uint16_t *pulses, size_t maxlength);
+
+  /**
+   * Read pulse train string from input until '@' or timeout. No heap
+   * allocation.
+   * Returns: length of pulse train or ERROR_INVALID_PULSETRAIN_MSG_*
+   */
+  static int stringToPulseTrain(Stream &input, uint16_t *pulses,
+                                size_t maxlength);
+
   static int stringToRepeats(const String &data);
 
+  /**
+   * Serialize pulse train into the compact binary format:
+   *  - version byte (PULSETRAIN_BINARY_VERSION)
+   *  - number of pulse types n, 0 if the pulses are not packed
+   *  - varint: number of pulses
+   *  - n > 0: n varints of pulse types (same types as pulseTrainToString())
+   *           followed by pulse type indices, two per byte (low nibble
+   *           first)
+   *  - n = 0: varint of every pulse, used for too many pulse types
+   * Returns: number of written bytes or 0 if the buffer is too small
+   */
+  static size_t pulseTrainToBinary(const uint16_t *pulses, size_t length,
+                                   uint8_t *buffer, size_t size);
+
+  /**
+   * Parse pulse train of the compact binary format.
+   * Returns: length of pulse train or ERROR_INVALID_PULSETRAIN_BIN_*
+   */
+  static int binaryToPulseTrain(const uint8_t *data, size_t size,
+                                uint16_t *pulses, size_t maxlength);
+
+  static const uint8_t PULSETRAIN_BINARY_VERSION = 1;
+
+  /**
+   * Cluster the pulse widths of a pulse train with 1-D k-means, seeded by
+   * splitting the sorted widths at gaps larger than 25% (the closest
+   * neighbours are merged beyond the limit of types). Jitter of the
+   * same pulse therefore ends in the same type. The types (cluster
+   * centroids) are stored in order of their first appearance and, if
+   * indices is not nullptr, the type of every pulse is stored in indices.
+   * If rewrite is true, every pulse is replaced by its type.
+   * Returns: number of pulse types (at most MAX_PULSE_TYPES - 1) or 0 if
+   * length is 0 or larger than MAXPULSESTREAMLENGTH
+   */
+  static uint8_t normalizePulseTrain(uint16_t *pulses, size_t length,
+                                     uint16_t *types, uint8_t *indices,
+                                     bool rewrite = false);
+
+  /**
+   * normalizePulseTrain() without rewrite for a constant pulse train.
+   * sorted: scratch buffer of length pulses for the sorted pulse widths,
+   * or nullptr to use the stack
+   */
+  static uint8_t normalizePulseTrain(const uint16_t *pulses, size_t length,
+                                     uint16_t *types, uint8_t *indices,
+                                     uint16_t *sorted = nullptr);
+
   static int createPulseTrain(uint16_t *pulses, const String &protocol_id,
                               const String &json);
 
+  /**
+   * Snapshot of the receiver tables (lengths, bounds and gap classes), the
+   * enabled protocols and the repeat detection of this instance for a warm
+   * start (e.g. in RTC memory during deep sleep, see StateStore):
+   *  - "EW", version byte (STATE_SNAPSHOT_VERSION)
+   *  - uint32: fingerprint of the protocols of the firmware
+   *  - number of protocols, flags (1: limitProtocols() not used)
+   *  - minrawlen, maxrawlen, uint16: mingaplen, maxgaplen, minpulselen,
+   *    maxpulselen
+   *  - number of gap classes, every class: uint16 mingaplen, minrawlen,
+   *    maxrawlen, protocols
+   *  - number of enabled protocols in decode order, every protocol: index,
+   *    gap class, priority, uint16 score
+   *  - number of protocols with a message in the last 500 ms, every
+   *    protocol: index, repeats, uint32 age in us, uint32 hash of the
+   *    message
+   *  - uint32: FNV-1a checksum of all previous bytes
+   * Integers are little endian, the snapshot has 26 bytes plus 5 per gap
+   * class and enabled protocol and 10 per recent message.
+   * Returns: number of written bytes or 0 if the buffer is too small
+   */
+  size_t saveState(uint8_t *buffer, size_t size) const;
+  bool saveState(StateStore &store) const;
+
+  /**
+   * Warm start from a snapshot of saveState() of the same firmware. The
+   * protocols are not initialized again: if it is called before the first
+   * instance is constructed, only the enabled protocols are registered
+   * (the others on demand, e.g. by send() or limitProtocols()) and the
+   * tables are not derived from them. The repeat detection is taken over
+   * by the next instance that decodes a message, aged by slept (us since
+   * saveState(), micros() restarts after deep sleep). Messages continuing
+   * a transmission of before the sleep are therefore no FIRST messages.
+   * Without limitProtocols(), the adaptive order (see
+   * setAdaptiveOrderEnabled()) follows the restored scores.
+   * Returns: number of enabled protocols or ERROR_INVALID_STATE_*, the
+   * state is unchanged on errors
+   */
+  static int restoreState(const uint8_t *data, size_t size,
+                          unsigned long slept = 0);
+  static int restoreState(StateStore &store, unsigned long slept = 0);
+
+  static const uint8_t STATE_SNAPSHOT_VERSION = 1;
+
   /**
    * Error return codes for send() and createPulseTrain()
    */
@@ -172,11 +558,213 @@ class ESPiLight {
   static const int ERROR_INVALID_PULSETRAIN_MSG_TYPE = -4;
   static const int ERROR_INVALID_PULSETRAIN_MSG_R = -5;
 
+  /**
+   * Error return codes for binaryToPulseTrain()
+   */
+  static const int ERROR_INVALID_PULSETRAIN_BIN_VERSION = -1;
+  static const int ERROR_INVALID_PULSETRAIN_BIN_TRUNCATED = -2;
+  static const int ERROR_INVALID_PULSETRAIN_BIN_TYPE = -3;
+
+  /**
+   * Error return codes for restoreState()
+   */
+  static const int ERROR_INVALID_STATE_VERSION = -1;
+  static const int ERROR_INVALID_STATE_TRUNCATED = -2;
+  static const int ERROR_INVALID_STATE_CHECKSUM = -3;
+  static const int ERROR_INVALID_STATE_FIRMWARE = -4;
+  static const int ERROR_INVALID_STATE_TABLE = -5;
+
+ protected:
+  /**
+   * Constructor of ESPiLightT.
+   */
+  ESPiLightBase(int8_t outputPin);
+  ~ESPiLightBase();
+
+  /**
+   * Feed pulse of the frame in slot to the streaming decoders and report
+   * their messages.
+   */
+  void feedStreamingDecoders(uint16_t pulse, uint8_t slot);
+
+  /**
+   * Start of a new frame for all streaming decoders.
+   */
+  void resetStreamingDecoders();
+
+  /**
+   * Wait until a running interruptHandler() returned, before a pointer it
+   * reads is freed.
+   */
+  static void waitForHandler();
+
+  /**
+   * Record edge at time now into the capture, called by
+   * interruptHandler() if _capture is set.
+   */
+  static void captureEdge(unsigned long now);
+
+  /**
+   * Count edge of duration in the histograms, called by receiveEdge() if
+   * _calibration is set.
+   */
+  static void calibrateEdge(unsigned long duration);
+
+  StreamingDecoder *_streamDecoders;
+  int16_t _streamedSlot;  // slot decoded by a streaming decoder
+  const char *_streamedProtocol;
+  const char *_skipProtocol;  // for the next parsePulseTrain()
+
+  static volatile bool _receiverMuted;  // sendPulseTrain() without echo
+  static EdgeCapture *volatile _capture;
+  static PulseCalibration *volatile _calibration;
+  static volatile bool _inHandler;   // an interruptHandler() is running
+  static uint8_t _receivedGapClass;  // for the next parsePulseTrain()
+  static unsigned long (*_clock)(void);
+
  private:
   ESPiLightCallBack _callback;
   PulseTrainCallBack _rawCallback;
+  PulseTrainCallBack _unknownCallback;
+  EventRing *_events;
+  RepeatState_t *_repeatStates;  // indexed by protocol_t::index
+  RepeatVoter *_voter;
   int8_t _outputPin;
   bool _echoEnabled;
+  bool _normalizeEnabled;
+  MatchPolicy_t _matchPolicy;
+  bool _adaptiveOrder;
+  String _streamLast;  // last streamed message, for repeat detection
+  unsigned long _streamLastTime;
+  uint8_t _streamRepeats;
+
+  /**
+   * Decode pulse train with all protocols except skipProtocol and report
+   * the messages. A gapClass > 0 limits the protocols to this class.
+   */
+  size_t decodePulseTrain(uint16_t *pulses, uint8_t length,
+                          const char *skipProtocol, uint8_t gapClass);
+};
+
+/**
+ * ESPiLight with a receiver queue of Slots pulse trains of up to MaxPulses
+ * pulses (at most MAXPULSESTREAMLENGTH, see PulseTrainQueue). Every
+ * instantiation has its own interrupt handler, queue and telemetry, e.g.
+ * for a second receiver on another pin, which are shared by its
+ * instances. ESPiLight is sized by RECEIVER_BUFFER_SIZE and
+ * MAXPULSESTREAMLENGTH.
+ *
+ * Usage:
+ *   ESPiLightT<4, 100> rf(TRANSMITTER_PIN);  // 4 slots of 100 pulses
+ *   rf.initReceiver(RECEIVER_PIN);
+ */
+template <uint8_t Slots, uint8_t MaxPulses>
+class ESPiLightT : public ESPiLightBase {
+  static_assert(MaxPulses <= MAXPULSESTREAMLENGTH,
+                "the decoder buffers hold MAXPULSESTREAMLENGTH pulses");
+
+ public:
+  typedef PulseTrainQueue<Slots, MaxPulses> Queue;
+
+  /**
+   * Constructor.
+   * Every instance has its own repeat detection. The protocols and the
+   * statistics are shared by all instances, the receiver by all instances
+   * of the same instantiation, without synchronization: decode and encode
+   * of all instances have to run in a single thread (e.g. loop()). The
+   * protocols are initialized by the first instance, or by restoreState().
+   */
+  ESPiLightT(int8_t outputPin)
+      : ESPiLightBase(outputPin), _streamSlot(0), _streamPos(0) {
+    _instances++;
+  }
+
+  /**
+   * Destructor. The last instance frees the pulse buffer of the gap
+   * classes.
+   */
+  ~ESPiLightT();
+
+  /**
+   * Process receiver queue and fire callback
+   */
+  void loop();
+
+  /**
+   * Feed the pulses received since the last call to the streaming
+   * decoders, called by loop().
+   */
+  void pollStreamingDecoders();
+
+  /**
+   * Poll the streaming decoders and parse the next pulse train of the
+   * receiver queue, called by loop(). A pulse train already decoded by a
+   * streaming decoder is not decoded again by the protocol of the same
+   * name.
+   * Returns: number of matches, or -1 if no pulse train was received
+   */
+  int parseReceivedPulseTrain();
+
+  /**
+   * Initialise receiver
+   */
+  static void initReceiver(byte inputPin);
+
+  /**
+   * Get last received PulseTrain.
+   * Returns: length of PulseTrain or 0 if not avaiable
+   */
+  static uint8_t receivePulseTrain(uint16_t *pulses);
+
+  /**
+   * Check if new PulseTrain avaiable.
+   * Returns: 0 if no new PulseTrain avaiable
+   */
+  static uint8_t nextPulseTrainLength();
+
+  /**
+   * Enable Receiver. No need to call enableReceiver() after initReceiver().
+   */
+  static void enableReceiver();
+
+  /**
+   * Disable decoding. You can re-enable decoding by calling enableReceiver();
+   */
+  static void disableReceiver();
+
+  /**
+   * interruptHandler is called on every change in the input
+   * signal. If RcPilight::initReceiver is called with interrupt <0,
+   * you have to call interruptHandler() yourself. (Or use
+   * InterruptChain)
+   */
+  static void interruptHandler();
+
+  /**
+   * Receiver logic of interruptHandler() for an edge at time now (in us).
+   * Can be used to feed recorded edges into the receiver.
+   */
+  static EdgeStatus_t handleEdge(unsigned long now);
+
+  /**
+   * Copy the receiver counters into snapshot and reset them if reset is
+   * true.
+   * Returns: false if the library is compiled without RECEIVER_TELEMETRY
+   */
+  static bool getReceiverTelemetry(ReceiverTelemetry_t &snapshot,
+                                   bool reset = true);
+
+  /**
+   * Account the RAM of the library and of this receiver. If resetPeaks is
+   * true, the transient peaks are reset.
+   */
+  static void getMemoryUsage(MemoryUsage_t &usage, bool resetPeaks = false);
+
+ private:
+  typedef typename Queue::PulseTrain PulseTrain;
+
+  uint8_t _streamSlot;  // pulse train slot fed to the streaming decoders
+  uint8_t _streamPos;   // next pulse of the slot
 
   /**
    * Quasi-reset. Called when the current edge is too long or short.
@@ -185,18 +773,72 @@ class ESPiLight {
    */
   static void resetReceiver();
 
+  /**
+   * Receiver logic of handleEdge() without telemetry.
+   */
+  static EdgeStatus_t receiveEdge(unsigned long now);
+
+  /**
+   * Segmentation of the gap classes > 0, called by receiveEdge() for every
+   * buffered pulse. primaryLength is the length of the frame of class 0
+   * ended by the pulse.
+   */
+  static EdgeStatus_t segmentGapClasses(uint16_t duration,
+                                        uint8_t primaryLength,
+                                        EdgeStatus_t status);
+
+  /**
+   * Drop the open frames of the gap classes > 0.
+   */
+  static void resetGapClasses();
+
+  /**
+   * Allocate the pulse buffer of the gap classes > 0, if they are used.
+   */
+  static void allocGapPulses();
+
+  /**
+   * Free the pulse buffer of the gap classes > 0.
+   */
+  static void freeGapPulses();
+
   /**
    * Internal functions
    */
   static bool _enabledReceiver;  // If true, monitoring and decoding is
                                  // enabled. If false, interruptHandler will
                                  // return immediately.
-  static volatile PulseTrain_t _pulseTrains[];
+  static volatile Queue _receiver;
   static volatile uint8_t _actualPulseTrain;
   static uint8_t _avaiablePulseTrain;
   static volatile unsigned long _lastChange;  // Timestamp of previous edge
   static volatile uint8_t _nrpulses;
   static int16_t _interrupt;
+  // gap class of the queued frames
+  static volatile uint8_t _frameGapClass[Slots];
+  // pulses since the oldest open frame of the gap classes > 0
+  static volatile uint16_t *volatile _gapPulses;
+  static uint8_t _instances;  // to free _gapPulses with the last one
+  static volatile uint8_t _gapLength;
+  static volatile uint8_t _gapStart[MAX_GAP_CLASSES];
+  static volatile uint8_t _gapCut;  // classes with a truncated frame
+  static uint8_t _gapUpdates;       // gapClassUpdates of the open frames
+#ifdef RECEIVER_TELEMETRY
+  static ReceiverTelemetry_t _telemetry;
+  static unsigned long _enqueued[Slots];
+#endif
 };
 
+/**
+ * ESPiLight with the receiver queue of RECEIVER_BUFFER_SIZE pulse trains of
+ * up to MAXPULSESTREAMLENGTH pulses.
+ */
+class ESPiLight
+    : public ESPiLightT<RECEIVER_BUFFER_SIZE, MAXPULSESTREAMLENGTH> {
+ public:
+  ESPiLight(int8_t outputPin) : ESPiLightT(outputPin) {}
+};
+
+#include "ESPiLightT.h"
+
 #endif
@@ -0,0 +1,497 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef ESPILIGHTT_H
+#define ESPILIGHTT_H
+
+/*
+ * Receiver of ESPiLightT, included by ESPiLight.h. Every instantiation
+ * has its own copy of the static members below.
+ */
+
+// ESP32 doesn't define ICACHE_RAM_ATTR
+#ifndef ICACHE_RAM_ATTR
+#define ICACHE_RAM_ATTR IRAM_ATTR
+#endif
+
+template <uint8_t Slots, uint8_t MaxPulses>
+bool ESPiLightT<Slots, MaxPulses>::_enabledReceiver = false;
+template <uint8_t Slots, uint8_t MaxPulses>
+volatile typename ESPiLightT<Slots, MaxPulses>::Queue
+    ESPiLightT<Slots, MaxPulses>::_receiver;
+template <uint8_t Slots, uint8_t MaxPulses>
+volatile uint8_t ESPiLightT<Slots, MaxPulses>::_actualPulseTrain = 0;
+template <uint8_t Slots, uint8_t MaxPulses>
+uint8_t ESPiLightT<Slots, MaxPulses>::_avaiablePulseTrain = 0;
+template <uint8_t Slots, uint8_t MaxPulses>
+volatile unsigned long ESPiLightT<Slots, MaxPulses>::_lastChange = 0;
+template <uint8_t Slots, uint8_t MaxPulses>
+volatile uint8_t ESPiLightT<Slots, MaxPulses>::_nrpulses = 0;
+template <uint8_t Slots, uint8_t MaxPulses>
+int16_t ESPiLightT<Slots, MaxPulses>::_interrupt = NOT_AN_INTERRUPT;
+template <uint8_t Slots, uint8_t MaxPulses>
+volatile uint8_t ESPiLightT<Slots, MaxPulses>::_frameGapClass[Slots];
+template <uint8_t Slots, uint8_t MaxPulses>
+volatile uint16_t *volatile ESPiLightT<Slots, MaxPulses>::_gapPulses = nullptr;
+template <uint8_t Slots, uint8_t MaxPulses>
+uint8_t ESPiLightT<Slots, MaxPulses>::_instances = 0;
+template <uint8_t Slots, uint8_t MaxPulses>
+volatile uint8_t ESPiLightT<Slots, MaxPulses>::_gapLength = 0;
+template <uint8_t Slots, uint8_t MaxPulses>
+volatile uint8_t ESPiLightT<Slots, MaxPulses>::_gapStart[MAX_GAP_CLASSES];
+template <uint8_t Slots, uint8_t MaxPulses>
+volatile uint8_t ESPiLightT<Slots, MaxPulses>::_gapCut = 0;
+template <uint8_t Slots, uint8_t MaxPulses>
+uint8_t ESPiLightT<Slots, MaxPulses>::_gapUpdates = 0;
+#ifdef RECEIVER_TELEMETRY
+template <uint8_t Slots, uint8_t MaxPulses>
+ReceiverTelemetry_t ESPiLightT<Slots, MaxPulses>::_telemetry;
+template <uint8_t Slots, uint8_t MaxPulses>
+unsigned long ESPiLightT<Slots, MaxPulses>::_enqueued[Slots];
+#endif
+
+template <uint8_t Slots, uint8_t MaxPulses>
+ESPiLightT<Slots, MaxPulses>::~ESPiLightT() {
+  _instances--;
+  if (_instances == 0) {
+    freeGapPulses();
+  }
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+void ESPiLightT<Slots, MaxPulses>::initReceiver(byte inputPin) {
+  int16_t interrupt = digitalPinToInterrupt(inputPin);
+  if (_interrupt == interrupt) {
+    return;
+  }
+  if (_interrupt >= 0) {
+    detachInterrupt((uint8_t)_interrupt);
+  }
+  _interrupt = interrupt;
+
+  resetReceiver();
+  enableReceiver();
+
+  if (interrupt >= 0) {
+    attachInterrupt((uint8_t)interrupt, interruptHandler, CHANGE);
+  }
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+uint8_t ESPiLightT<Slots, MaxPulses>::receivePulseTrain(uint16_t *pulses) {
+  allocGapPulses();
+  const uint8_t length = nextPulseTrainLength();
+
+  if (length > 0) {
+    _receivedGapClass = _frameGapClass[_avaiablePulseTrain];
+#ifdef RECEIVER_TELEMETRY
+    const uint32_t latency = _clock() - _enqueued[_avaiablePulseTrain];
+    noInterrupts();
+    _telemetry.dequeued++;
+    _telemetry.latency += latency;
+    if ((_telemetry.dequeued == 1) || (latency < _telemetry.latencyMin)) {
+      _telemetry.latencyMin = latency;
+    }
+    if (latency > _telemetry.latencyMax) {
+      _telemetry.latencyMax = latency;
+    }
+    interrupts();
+#endif
+    volatile PulseTrain &pulseTrain = _receiver.trains[_avaiablePulseTrain];
+    _avaiablePulseTrain = Queue::nextSlot(_avaiablePulseTrain);
+    for (uint8_t i = 0; i < length; i++) {
+      pulses[i] = pulseTrain.pulses[i];
+    }
+    noInterrupts();
+    pulseTrain.length = 0;
+    _receiver.count--;
+    interrupts();
+  }
+  return length;
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+uint8_t ESPiLightT<Slots, MaxPulses>::nextPulseTrainLength() {
+  return _receiver.trains[_avaiablePulseTrain].length;
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+void ESPiLightT<Slots, MaxPulses>::enableReceiver() {
+  allocGapPulses();
+  _enabledReceiver = true;
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+void ESPiLightT<Slots, MaxPulses>::disableReceiver() {
+  _enabledReceiver = false;
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+void ICACHE_RAM_ATTR ESPiLightT<Slots, MaxPulses>::interruptHandler() {
+  _inHandler = true;
+  __sync_synchronize();
+  const unsigned long now = micros();
+  if (_capture != nullptr) {
+    captureEdge(now);
+  }
+  handleEdge(now);
+  __sync_synchronize();
+  _inHandler = false;
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+EdgeStatus_t ICACHE_RAM_ATTR
+ESPiLightT<Slots, MaxPulses>::handleEdge(unsigned long now) {
+#ifdef RECEIVER_TELEMETRY
+  const uint32_t start = ESP.getCycleCount();
+  const unsigned long duration = now - _lastChange;
+  const uint8_t slot = _actualPulseTrain;
+  const EdgeStatus_t status = receiveEdge(now);
+  if (status == EDGE_IGNORED) {
+    return status;
+  }
+  const uint32_t cycles = ESP.getCycleCount() - start;
+
+  _telemetry.edges++;
+  _telemetry.edgeCycles += cycles;
+  if ((_telemetry.edges == 1) || (cycles < _telemetry.edgeMinCycles)) {
+    _telemetry.edgeMinCycles = cycles;
+  }
+  if (cycles > _telemetry.edgeMaxCycles) {
+    _telemetry.edgeMaxCycles = cycles;
+  }
+  uint8_t bin = 0;
+  for (unsigned long d = duration >> 1;
+       (d != 0) && (bin < RECEIVER_TELEMETRY_BINS - 1); d >>= 1) {
+    bin++;
+  }
+  _telemetry.durations[bin]++;
+
+  switch (status) {
+    case EDGE_FILTERED:
+      if (duration <= minpulselen) {
+        _telemetry.tooShort++;
+      } else {
+        _telemetry.tooLong++;
+      }
+      break;
+    case EDGE_BUSY:
+      _telemetry.busy++;
+      break;
+    case EDGE_FRAME: {
+      _telemetry.frames++;
+      // several frames for gap classes
+      for (uint8_t i = slot; i != _actualPulseTrain; i = Queue::nextSlot(i)) {
+        _enqueued[i] = now;
+      }
+      if (_receiver.count > _telemetry.queueHighWater) {
+        _telemetry.queueHighWater = _receiver.count;
+      }
+      break;
+    }
+    case EDGE_REJECTED:
+      _telemetry.rejected++;
+      break;
+    case EDGE_DROPPED:
+      _telemetry.dropped++;
+      break;
+    default:
+      break;
+  }
+  return status;
+#else
+  return receiveEdge(now);
+#endif
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+EdgeStatus_t ICACHE_RAM_ATTR
+ESPiLightT<Slots, MaxPulses>::receiveEdge(unsigned long now) {
+  if (!_enabledReceiver || _receiverMuted) {
+    return EDGE_IGNORED;
+  }
+
+  volatile PulseTrain &pulseTrain = _receiver.trains[_actualPulseTrain];
+  volatile uint16_t *codes = pulseTrain.pulses;
+  const unsigned int duration = now - _lastChange;
+  if (_calibration != nullptr) {
+    calibrateEdge(duration);
+  }
+
+  /* We first do some filtering (same as pilight BPF) */
+  if (duration <= minpulselen) {
+    return EDGE_FILTERED;
+  }
+  _lastChange = now;
+  if (duration >= maxpulselen) {
+    /* Longer than every footer, the next pulse starts a new frame */
+    _nrpulses = 0;
+    resetGapClasses();
+    return EDGE_FILTERED;
+  }
+  EdgeStatus_t status = EDGE_PULSE;
+  uint8_t primaryLength = 0;
+  if (pulseTrain.length != 0) {
+    status = EDGE_BUSY;
+    if (duration > mingaplen) {
+      /* Start the next frame after the footer of the lost one */
+      _nrpulses = 0;
+      status = EDGE_DROPPED;
+    }
+  } else {
+    /* All codes are buffered */
+    codes[_nrpulses] = (uint16_t)duration;
+    _nrpulses = Queue::nextPulse(_nrpulses);
+    /* Let's match footers */
+    if (duration > mingaplen) {
+      status = EDGE_REJECTED;
+      primaryLength = _nrpulses;
+      /* Only match minimal length pulse streams */
+      if (_nrpulses >= minrawlen && _nrpulses <= maxrawlen) {
+        pulseTrain.length = _nrpulses;
+        _receiver.count++;
+        _frameGapClass[_actualPulseTrain] = 0;
+        _actualPulseTrain = Queue::nextSlot(_actualPulseTrain);
+        status = EDGE_FRAME;
+      }
+      _nrpulses = 0;
+    }
+  }
+  if (gapClassCount > 1) {
+    status = segmentGapClasses((uint16_t)duration, primaryLength, status);
+  }
+  return status;
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+EdgeStatus_t ICACHE_RAM_ATTR
+ESPiLightT<Slots, MaxPulses>::segmentGapClasses(
+    uint16_t duration, uint8_t primaryLength, EdgeStatus_t status) {
+  /* freeGapPulses() waits for the handler */
+  volatile uint16_t *const gapPulses = _gapPulses;
+  if (gapPulses == nullptr) {
+    return status;
+  }
+  if (_gapUpdates != gapClassUpdates) {
+    /* The open frames were segmented by other classes */
+    resetGapClasses();
+    _gapUpdates = gapClassUpdates;
+  }
+  const uint8_t count = gapClassCount;
+  if (_gapLength == MaxPulses) {
+    /* Buffer full: drop the pulses before the oldest frame that can still
+       fit, cut frames are rejected at their footer */
+    uint8_t base = _gapLength;
+    for (uint8_t i = 1; i < count; i++) {
+      if ((_gapStart[i] > 0) && (_gapStart[i] < base)) {
+        base = _gapStart[i];
+      }
+    }
+    for (uint8_t i = base; i < _gapLength; i++) {
+      gapPulses[i - base] = gapPulses[i];
+    }
+    _gapLength -= base;
+    for (uint8_t i = 1; i < count; i++) {
+      if (_gapStart[i] < base) {
+        _gapStart[i] = 0;
+        _gapCut |= (uint8_t)(1 << i);
+      } else {
+        _gapStart[i] -= base;
+      }
+    }
+  }
+  gapPulses[_gapLength] = duration;
+  _gapLength++;
+
+  /* The classes are sorted by their footer */
+  for (uint8_t i = 1; (i < count) && (duration > gapClasses[i].mingaplen);
+       i++) {
+    const uint8_t start = _gapStart[i];
+    const uint8_t length = _gapLength - start;
+    const uint8_t cut = _gapCut & (uint8_t)(1 << i);
+    _gapStart[i] = _gapLength;
+    _gapCut &= (uint8_t) ~(1 << i);
+    /* Equal length: same frame as class 0 */
+    if ((cut != 0) || (length == primaryLength) ||
+        (length < gapClasses[i].minrawlen) ||
+        (length > gapClasses[i].maxrawlen)) {
+      continue;
+    }
+    volatile PulseTrain &pulseTrain = _receiver.trains[_actualPulseTrain];
+    if (pulseTrain.length != 0) {
+      if (status != EDGE_FRAME) {
+        status = EDGE_DROPPED;
+      }
+      continue;
+    }
+    for (uint8_t j = 0; j < length; j++) {
+      pulseTrain.pulses[j] = gapPulses[start + j];
+    }
+    pulseTrain.length = length;
+    _receiver.count++;
+    _frameGapClass[_actualPulseTrain] = i;
+    _actualPulseTrain = Queue::nextSlot(_actualPulseTrain);
+    status = EDGE_FRAME;
+  }
+  if (duration > gapClasses[count - 1].mingaplen) {
+    /* Every class ended a frame */
+    _gapLength = 0;
+    for (uint8_t i = 1; i < count; i++) {
+      _gapStart[i] = 0;
+    }
+  }
+  return status;
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+void ICACHE_RAM_ATTR ESPiLightT<Slots, MaxPulses>::resetGapClasses() {
+  _gapLength = 0;
+  for (uint8_t i = 0; i < MAX_GAP_CLASSES; i++) {
+    _gapStart[i] = 0;
+  }
+  _gapCut = 0;
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+void ESPiLightT<Slots, MaxPulses>::allocGapPulses() {
+  if ((_gapPulses == nullptr) && (gapClassCount > 1)) {
+    _gapPulses = new uint16_t[MaxPulses];
+  }
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+void ESPiLightT<Slots, MaxPulses>::freeGapPulses() {
+  volatile uint16_t *pulses = _gapPulses;
+  if (pulses == nullptr) {
+    return;
+  }
+  _gapPulses = nullptr;
+  waitForHandler();
+  resetGapClasses();
+  delete[] pulses;
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+void ESPiLightT<Slots, MaxPulses>::resetReceiver() {
+  for (uint8_t i = 0; i < Slots; i++) {
+    _receiver.trains[i].length = 0;
+  }
+  _receiver.count = 0;
+  _avaiablePulseTrain = 0;
+  _actualPulseTrain = 0;
+  _nrpulses = 0;
+  resetGapClasses();
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+bool ESPiLightT<Slots, MaxPulses>::getReceiverTelemetry(
+    ReceiverTelemetry_t &snapshot, bool reset) {
+#ifdef RECEIVER_TELEMETRY
+  noInterrupts();
+  snapshot = _telemetry;
+  if (reset) {
+    _telemetry = ReceiverTelemetry_t();
+  }
+  interrupts();
+  return true;
+#else
+  (void)reset;
+  snapshot = ReceiverTelemetry_t();
+  return false;
+#endif
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+void ESPiLightT<Slots, MaxPulses>::getMemoryUsage(
+    MemoryUsage_t &usage, bool resetPeaks) {
+  ESPiLightBase::getMemoryUsage(usage, resetPeaks);
+  usage.receiverBytes += sizeof(_receiver) + sizeof(_frameGapClass) +
+                         sizeof(_gapStart);
+#ifdef RECEIVER_TELEMETRY
+  usage.receiverBytes += sizeof(_telemetry) + sizeof(_enqueued);
+#endif
+  if (_gapPulses != nullptr) {
+    usage.receiverBytes += MaxPulses * sizeof(uint16_t);
+  }
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+void ESPiLightT<Slots, MaxPulses>::loop() {
+  flushCapture();
+  flushLog();
+  parseReceivedPulseTrain();
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+int ESPiLightT<Slots, MaxPulses>::parseReceivedPulseTrain() {
+  uint16_t pulses[MaxPulses];
+
+  pollStreamingDecoders();
+  const uint8_t slot = _avaiablePulseTrain;
+  const uint8_t length = receivePulseTrain(pulses);
+  if (length == 0) {
+    return -1;
+  }
+  if (slot == _streamedSlot) {
+    // already decoded by a streaming decoder of this instance
+    _skipProtocol = _streamedProtocol;
+    _streamedSlot = -1;
+  }
+  return (int)parsePulseTrain(pulses, (uint8_t)length);
+}
+
+template <uint8_t Slots, uint8_t MaxPulses>
+void ESPiLightT<Slots, MaxPulses>::pollStreamingDecoders() {
+  if (_streamDecoders == nullptr) {
+    return;
+  }
+  noInterrupts();
+  const uint8_t slot = _actualPulseTrain;
+  const uint8_t nrpulses = _nrpulses;
+  interrupts();
+
+  while (true) {
+    uint8_t end;
+    if (slot != _streamSlot) {
+      // rest of a completed frame, if it was not dequeued yet
+      end = _receiver.trains[_streamSlot].length;
+    } else if (nrpulses < _streamPos) {
+      // frame restarted
+      end = 0;
+    } else {
+      end = nrpulses;
+    }
+    for (; _streamPos < end; _streamPos++) {
+      feedStreamingDecoders(_receiver.trains[_streamSlot].pulses[_streamPos],
+                            _streamSlot);
+    }
+    if ((slot == _streamSlot) && (nrpulses >= _streamPos)) {
+      break;
+    }
+    if ((slot == _streamSlot) && (_streamedSlot == _streamSlot)) {
+      // the streamed frame was rejected by the receiver
+      _streamedSlot = -1;
+    }
+    resetStreamingDecoders();
+    _streamSlot = slot;
+    _streamPos = 0;
+  }
+}
+
+#endif  // ESPILIGHTT_H
@@ -30,8 +30,18 @@
 
 #define LOG_STACK               255
 
-#include <stdio.h>
+#ifndef ESPILIGHT_LOG_LEVEL
+#define ESPILIGHT_LOG_LEVEL     LOG_DEBUG
+#endif
 
-#define logprintf(prio, args...) {printf("pilight(%d): ", prio);printf(args);printf("\n");}
+#include <stdio.h>
+#include "../../../../tools/aprintf.h"
+
+/* Messages above ESPILIGHT_LOG_LEVEL are removed at compile time */
+#define logprintf(prio, fmt, ...) do {\
+    if((prio) <= ESPILIGHT_LOG_LEVEL) {\
+      alog_P((prio), PSTR(fmt), ##__VA_ARGS__);\
+    }\
+  } while(0)
 
 #endif
@@ -28,8 +28,85 @@
 
 struct protocols_t *pilight_protocols = NULL;
 
-void protocol_init(void) {
+static void (*const protocol_inits[])(void) = {
   #include "protocol_init.h"
+};
+
+#define PROTOCOL_INIT_COUNT \
+  ((int)(sizeof(protocol_inits) / sizeof(protocol_inits[0])))
+
+/* ids of the protocols in the order of protocol_init() */
+static const char *const protocol_names[] = {
+  #include "protocol_names.h"
+};
+
+#define PROTOCOL_NAME_COUNT \
+  ((int)(sizeof(protocol_names) / sizeof(protocol_names[0])))
+
+void protocol_init(void) {
+  int i = 0;
+  for(i = 0; i < PROTOCOL_INIT_COUNT; i++) {
+    protocol_init_one(i);
+  }
+}
+
+int protocol_init_count(void) {
+  return PROTOCOL_INIT_COUNT;
+}
+
+void protocol_init_one(int index) {
+  struct protocols_t *head = pilight_protocols;
+  struct protocols_t *first = NULL;
+  struct protocols_t *last = NULL;
+  struct protocols_t **pos = NULL;
+  protocol_inits[index]();
+  if(pilight_protocols == head) {
+    return;
+  }
+  first = pilight_protocols;
+  for(last = first; ; last = last->next) {
+    last->listener->index = (uint8_t)index;
+    if(last->next == head) {
+      break;
+    }
+  }
+
+  /* same order as protocol_init(), which prepends every protocol: in
+     descending index, also if registered later on demand */
+  pilight_protocols = head;
+  pos = &pilight_protocols;
+  while((*pos != NULL) && ((*pos)->listener->index > index)) {
+    pos = &(*pos)->next;
+  }
+  last->next = *pos;
+  *pos = first;
+}
+
+static uint32_t fnv1a(uint32_t hash, uint8_t byte) {
+  return (hash ^ byte) * 16777619u;
+}
+
+uint32_t protocol_init_fingerprint(void) {
+  uint32_t hash = 2166136261u;
+  int i = 0, b = 0;
+  const char *name = NULL;
+  /* offsets to the first function, independent of the load address */
+  for(i = 0; i < PROTOCOL_INIT_COUNT; i++) {
+    const uintptr_t offset =
+      (uintptr_t)protocol_inits[i] - (uintptr_t)protocol_inits[0];
+    for(b = 0; b < 4; b++) {
+      hash = fnv1a(hash, (uint8_t)(offset >> (8 * b)));
+    }
+  }
+  /* the ids of the protocols, including the terminator */
+  for(i = 0; i < PROTOCOL_NAME_COUNT; i++) {
+    name = protocol_names[i];
+    do {
+      hash = fnv1a(hash, (uint8_t)*name);
+    } while(*name++ != '\0');
+  }
+  hash = fnv1a(hash, (uint8_t)PROTOCOL_NAME_COUNT);
+  return fnv1a(hash, (uint8_t)PROTOCOL_INIT_COUNT);
 }
 
 void protocol_register(protocol_t **proto) {
@@ -67,8 +144,14 @@ void protocol_register(protocol_t **proto) {
 
   (*proto)->raw = NULL;
 
-  /* Arduino special, compare repeated messages*/
-  (*proto)->old_content = NULL;
+  /* Arduino special */
+  (*proto)->busy = 0;
+  (*proto)->stats = NULL;
+  (*proto)->priority = 0;
+  (*proto)->score = 0;
+  (*proto)->index = 0;
+  (*proto)->gapclass = 0;
+  (*proto)->calibrated = 0;
 
   struct protocols_t *pnode = MALLOC(sizeof(struct protocols_t));
   if(pnode == NULL) {
@@ -83,3 +166,162 @@ void protocol_register(protocol_t **proto) {
 void protocol_set_id(protocol_t *proto, char *id) {
   proto->id = id;
 }
+
+#ifdef ESP8266
+/* single core, the protocols are only used by loop() */
+#define protocol_lock(proto)
+#define protocol_unlock(proto)
+#else
+static void protocol_lock(protocol_t *proto) {
+  while(__atomic_test_and_set(&proto->busy, __ATOMIC_ACQUIRE)) {
+  }
+}
+
+static void protocol_unlock(protocol_t *proto) {
+  __atomic_clear(&proto->busy, __ATOMIC_RELEASE);
+}
+#endif
+
+int protocol_validate(protocol_t *proto, protocol_ctx_t *ctx) {
+  protocol_lock(proto);
+  proto->raw = ctx->raw;
+  proto->rawlen = ctx->rawlen;
+  const int ret = proto->validate();
+  protocol_unlock(proto);
+  return ret;
+}
+
+void protocol_parse(protocol_t *proto, protocol_ctx_t *ctx) {
+  protocol_lock(proto);
+  proto->raw = ctx->raw;
+  proto->rawlen = ctx->rawlen;
+  proto->message = NULL;
+  proto->parseCode();
+  ctx->message = proto->message;
+  proto->message = NULL;
+  protocol_unlock(proto);
+}
+
+int protocol_create(protocol_t *proto, protocol_ctx_t *ctx,
+                    struct JsonNode *code) {
+  protocol_lock(proto);
+  proto->raw = ctx->raw;
+  proto->rawlen = 0;
+  proto->message = NULL;
+  const int ret = proto->createCode(code);
+  ctx->rawlen = proto->rawlen;
+  ctx->message = proto->message;
+  proto->message = NULL;
+  protocol_unlock(proto);
+  return ret;
+}
+
+static pulse_bits_t pulse_bits;
+static const uint16_t *pulse_bits_raw = NULL;
+static int pulse_bits_rawlen = 0;
+static uint16_t pulse_bits_sorted[PULSE_BITS_WORDS * 32];
+
+void protocol_pulse_bits_reset(void) {
+  pulse_bits_raw = NULL;
+}
+
+static uint16_t pulse_bits_threshold(const uint16_t *raw, int length) {
+  uint16_t *sorted = pulse_bits_sorted;
+  int i = 0, j = 0;
+  for(i=0;i<length;i++) {
+    const uint16_t pulse = raw[i];
+    for(j=i;(j > 0) && (sorted[j - 1] > pulse);j--) {
+      sorted[j] = sorted[j - 1];
+    }
+    sorted[j] = pulse;
+  }
+
+  /* the widest ratio b / a with at least side pulses below and above */
+  const int side = (length >= 16) ? length / 8 : 1;
+  uint32_t a = 2, b = 3; /* the ratio of 1.5 to beat */
+  int found = 0;
+  for(i=side;i<=length-side;i++) {
+    if((uint32_t)sorted[i] * a > b * (uint32_t)sorted[i - 1]) {
+      a = sorted[i - 1];
+      b = sorted[i];
+      found = 1;
+    }
+  }
+  if(!found) {
+    return (length > 0) ? sorted[length - 1] : 0;
+  }
+  return (uint16_t)((a + b) / 2);
+}
+
+const pulse_bits_t *protocol_pulse_bits(const uint16_t *raw, int rawlen) {
+  if(rawlen > PULSE_BITS_WORDS * 32) {
+    rawlen = PULSE_BITS_WORDS * 32;
+  }
+  if(rawlen < 0) {
+    rawlen = 0;
+  }
+  if((raw == pulse_bits_raw) && (rawlen == pulse_bits_rawlen)) {
+    return &pulse_bits;
+  }
+  memset(&pulse_bits, 0, sizeof(pulse_bits));
+  pulse_bits.length = (uint8_t)rawlen;
+  pulse_bits.pairs = (uint8_t)(rawlen / 2);
+  pulse_bits.threshold =
+    pulse_bits_threshold(raw, (rawlen > 1) ? rawlen - 1 : rawlen);
+
+  int i = 0;
+  for(i=0;i<rawlen;i++) {
+    if(raw[i] > pulse_bits.threshold) {
+      pulse_bits.pulses[i / 32] |= (uint32_t)1 << (i % 32);
+    }
+  }
+  for(i=0;i<pulse_bits.pairs;i++) {
+    /* a pair never crosses a word boundary */
+    const uint32_t word = pulse_bits.pulses[(2 * i) / 32] >> ((2 * i) % 32);
+    const uint32_t first = word & 1;
+    const uint32_t second = (word >> 1) & 1;
+    pulse_bits.pairBits[i / 32] |= first << (i % 32);
+    if(first == second) {
+      pulse_bits.pairErrors++;
+    }
+  }
+  pulse_bits_raw = raw;
+  pulse_bits_rawlen = rawlen;
+  return &pulse_bits;
+}
+
+/* up to 32 bits starting at s, bit s is bit 0 of the result */
+static uint32_t pulse_bits_extract(const uint32_t *bits, int s, int count) {
+  const int word = s / 32, shift = s % 32;
+  uint64_t value = bits[word] >> shift;
+  if(shift + count > 32) {
+    value |= (uint64_t)bits[word + 1] << (32 - shift);
+  }
+  if(count < 32) {
+    value &= ((uint64_t)1 << count) - 1;
+  }
+  return (uint32_t)value;
+}
+
+unsigned long pulse_bits_to_dec(const uint32_t *bits, int s, int e) {
+  const int count = e - s + 1;
+  if((count <= 0) || (s < 0) || (e >= PULSE_BITS_WORDS * 32)) {
+    return 0;
+  }
+  return pulse_bits_extract(bits, s, count > 32 ? 32 : count);
+}
+
+unsigned long pulse_bits_to_dec_rev(const uint32_t *bits, int s, int e) {
+  const int count = e - s + 1;
+  if((count <= 0) || (s < 0) || (e >= PULSE_BITS_WORDS * 32)) {
+    return 0;
+  }
+  uint32_t value = pulse_bits_extract(bits, s, count > 32 ? 32 : count);
+  /* reverse 32 bits, then drop the unused low bits */
+  value = ((value >> 1) & 0x55555555) | ((value & 0x55555555) << 1);
+  value = ((value >> 2) & 0x33333333) | ((value & 0x33333333) << 2);
+  value = ((value >> 4) & 0x0F0F0F0F) | ((value & 0x0F0F0F0F) << 4);
+  value = ((value >> 8) & 0x00FF00FF) | ((value & 0x00FF00FF) << 8);
+  value = (value >> 16) | (value << 16);
+  return value >> (32 - (count > 32 ? 32 : count));
+}
@@ -98,10 +98,54 @@ typedef struct protocol_t {
   void (*gc)(void);
   //void (*threadGC)(void);
 
-  /* ESPiLight special, used to compare repeated messages*/
-  char *old_content;
+  /* ESPiLight special, set while raw, rawlen and message are bound to a
+     protocol_ctx_t */
+  volatile char busy;
+  /* ESPiLight special, decode profiling counters */
+  struct protocol_stats_t *stats;
+  /* ESPiLight special, match arbitration and adaptive order */
+  int8_t priority;
+  uint16_t score;
+  /* ESPiLight special, registration index for ESPiLightEvent_t, see
+     protocol_init_one() */
+  uint8_t index;
+  /* ESPiLight special, frame segmentation (see GapClass_t) */
+  uint8_t gapclass;
+  /* ESPiLight special, decoded since the calibration (re)started, see
+     PulseCalibration::setUnseenMin() */
+  uint8_t calibrated;
 } protocol_t;
 
+/* ESPiLight special, decode profiling counters */
+typedef struct protocol_stats_t {
+  unsigned long validateCalls;
+  unsigned long validatePasses;
+  unsigned long parseSuccesses;
+  unsigned long falsePositives; /* parseCode() created no message */
+  unsigned long validateCycles;
+  unsigned long validateMaxCycles;
+  unsigned long parseCycles;
+  unsigned long parseMaxCycles;
+  unsigned long heapBytes; /* heap used by created messages */
+  unsigned long conflicts; /* messages of frames matched by others too */
+} protocol_stats_t;
+
+/* ESPiLight special, bit vector of a pulse train, see
+   protocol_pulse_bits() */
+#define PULSE_BITS_WORDS 8 /* up to 256 pulses */
+
+typedef struct pulse_bits_t {
+  uint16_t threshold; /* pulses longer than threshold are long */
+  uint8_t length;     /* number of pulses */
+  uint8_t pairs;      /* number of pulse pairs */
+  uint8_t pairErrors; /* pairs of two short or two long pulses */
+  /* bit i (word i / 32, bit i % 32): pulse i is long */
+  uint32_t pulses[PULSE_BITS_WORDS];
+  /* bit i: first pulse of pair i is long, i.e. PWM long-short or the
+     Manchester half bits of pulse 2i */
+  uint32_t pairBits[PULSE_BITS_WORDS];
+} pulse_bits_t;
+
 typedef struct protocols_t {
   struct protocol_t *listener;
   char *name;
@@ -111,8 +155,55 @@ typedef struct protocols_t {
 extern struct protocols_t *pilight_protocols;
 
 void protocol_init(void);
+/* ESPiLight special, registration of single protocols for a warm start.
+   The registration functions are numbered in the order of
+   protocol_init(), protocol_init_one() registers the protocol of number
+   index, which is its protocol_t::index, at the position it has after
+   protocol_init(). protocol_init_fingerprint() is a hash of the offsets
+   of the registration functions, the number of protocols and their ids,
+   it changes with the firmware. */
+int protocol_init_count(void);
+void protocol_init_one(int index);
+uint32_t protocol_init_fingerprint(void);
 void protocol_set_id(protocol_t *proto, char *id);
 void protocol_register(protocol_t **proto);
 #define protocol_device_add(proto, id, desc)
 
+/* ESPiLight special, state of a single decode or encode operation. The
+   vendored protocols use raw, rawlen and message of protocol_t, the
+   functions below bind the context to the protocol for the duration of
+   the call. Concurrent calls for the same protocol are serialized, calls
+   for different protocols or with different contexts are independent.
+   The rest of the library is not thread safe, see ESPiLight(). */
+typedef struct protocol_ctx_t {
+  uint16_t *raw;
+  uint8_t rawlen;
+  struct JsonNode *message;
+} protocol_ctx_t;
+
+int protocol_validate(protocol_t *proto, protocol_ctx_t *ctx);
+/* ctx->message is the decoded message or NULL */
+void protocol_parse(protocol_t *proto, protocol_ctx_t *ctx);
+/* the pulse train is written to ctx->raw, ctx->rawlen is its length */
+int protocol_create(protocol_t *proto, protocol_ctx_t *ctx,
+                    struct JsonNode *code);
+
+/* ESPiLight special, shared pre-pass of the protocols: instead of
+   comparing every pulse of raw with its own threshold, a protocol may
+   call protocol_pulse_bits(proto->raw, proto->rawlen) in validate() or
+   parseCode(). The pulses are split into short and long at the widest
+   ratio of neighbouring pulse widths with at least an eighth of the
+   pulses on both sides, so rare sync pulses count as long without moving
+   the threshold, the footer (last pulse) is not considered. Without a
+   ratio of 1.5, all pulses are short. The result is cached for raw and
+   rawlen until protocol_pulse_bits_reset(), which decodePulseTrain()
+   calls for every frame. Like the rest of the library, the cache is not
+   thread safe. */
+void protocol_pulse_bits_reset(void);
+const pulse_bits_t *protocol_pulse_bits(const uint16_t *raw, int rawlen);
+/* bits s..e as number, bit s is the least significant bit (binToDec()) */
+unsigned long pulse_bits_to_dec(const uint32_t *bits, int s, int e);
+/* bits s..e as number, bit s is the most significant bit (binToDecRev()) */
+unsigned long pulse_bits_to_dec_rev(const uint32_t *bits, int s, int e);
+
 #endif
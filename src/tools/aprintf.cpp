@@ -19,29 +19,361 @@
 #include "aprintf.h"
 #include <Esp.h>
 
+#define ALOG_MAX_ENTRY 128
+#define ALOG_TAGGED 0x80  // alog_P(), written as "pilight(<prio>): ...\n"
+#define ALOG_UNTAGGED 3   // priority of aprintf_P(), like LOG_ERR
+
+enum alog_arg_t : uint8_t {
+  ARG_NONE,  // unknown conversion, written as is
+  ARG_INT,
+  ARG_LONG,
+  ARG_LLONG,
+  ARG_SIZE,
+  ARG_DOUBLE,
+  ARG_POINTER,
+  ARG_STRING,
+  ARG_PERCENT
+};
+
 static Print *aprintf_print = nullptr;
+static uint8_t alog_level = 7;  // LOG_DEBUG
+// single producer (decoder), single consumer (alog_flush()) ring
+static uint8_t *alog_ring = nullptr;
+static size_t alog_size = 0;
+static volatile size_t alog_head = 0;
+static volatile size_t alog_tail = 0;
+static volatile unsigned long alog_dropped = 0;
 
 void set_aprintf_output(Print *output) { aprintf_print = output; }
 
-int aprintf_P(PGM_P formatP, ...) {
-  if (aprintf_print == nullptr) {
-    return 0;
+void set_alog_level(uint8_t level) { alog_level = level; }
+
+bool set_alog_buffer(size_t size) {
+  alog_flush();
+  delete[] alog_ring;
+  alog_ring = nullptr;
+  alog_size = 0;
+  alog_head = 0;
+  alog_tail = 0;
+  if (size == 0) {
+    return true;
   }
-  va_list arg;
-  va_start(arg, formatP);
+  alog_ring = new uint8_t[size];
+  if (alog_ring == nullptr) {
+    return false;
+  }
+  alog_size = size;
+  return true;
+}
+
+/**
+ * Parse the conversion specification behind a '%' and copy it with the
+ * '%' into spec.
+ * Returns: pointer behind the specification
+ */
+static PGM_P parse_spec(PGM_P formatP, char *spec, size_t size,
+                        alog_arg_t &type, uint8_t &stars) {
+  alog_arg_t integer = ARG_INT;
+  size_t len = 0;
+  spec[len++] = '%';
+  type = ARG_NONE;
+  stars = 0;
+  while (true) {
+    const char c = (char)pgm_read_byte(formatP);
+    if (c == '\0') {
+      break;
+    }
+    formatP++;
+    if (len < size - 1) {
+      spec[len++] = c;
+    }
+    if (c == '*') {
+      stars++;
+    } else if (c == 'l') {
+      integer = (integer == ARG_LONG) ? ARG_LLONG : ARG_LONG;
+    } else if (c == 'j') {
+      integer = ARG_LLONG;
+    } else if ((c == 'z') || (c == 't')) {
+      integer = ARG_SIZE;
+    } else if (strchr("diouxXc", c) != nullptr) {
+      type = integer;
+      break;
+    } else if (strchr("fFeEgGaA", c) != nullptr) {
+      type = ARG_DOUBLE;
+      break;
+    } else if (c == 's') {
+      type = ARG_STRING;
+      break;
+    } else if ((c == 'p') || (c == 'n')) {
+      type = ARG_POINTER;
+      break;
+    } else if (c == '%') {
+      type = ARG_PERCENT;
+      break;
+    } else if (strchr("-+ #0123456789.h", c) == nullptr) {
+      break;
+    }
+  }
+  spec[len] = '\0';
+  return formatP;
+}
+
+template <typename T>
+static bool put_arg(uint8_t *entry, size_t &len, T value) {
+  if (len + sizeof(T) > ALOG_MAX_ENTRY) {
+    return false;
+  }
+  memcpy(entry + len, &value, sizeof(T));
+  len += sizeof(T);
+  return true;
+}
+
+template <typename T>
+static T get_arg(const uint8_t *entry, size_t &pos) {
+  T value;
+  memcpy(&value, entry + pos, sizeof(T));
+  pos += sizeof(T);
+  return value;
+}
+
+/**
+ * Record an entry: length (uint16_t), priority, format string pointer and
+ * the arguments.
+ * Returns: length of the entry or 0 if the arguments do not fit
+ */
+static size_t alog_record(uint8_t *entry, uint8_t prio, PGM_P formatP,
+                          va_list arg) {
+  size_t len = 3;
+  put_arg(entry, len, formatP);
+  PGM_P p = formatP;
+  char c;
+  while ((c = (char)pgm_read_byte(p++)) != '\0') {
+    if (c != '%') {
+      continue;
+    }
+    char spec[16];
+    alog_arg_t type;
+    uint8_t stars;
+    p = parse_spec(p, spec, sizeof(spec), type, stars);
+    bool fits = true;
+    for (uint8_t i = 0; i < stars; i++) {
+      fits &= put_arg(entry, len, va_arg(arg, int));
+    }
+    switch (type) {
+      case ARG_INT:
+        fits &= put_arg(entry, len, va_arg(arg, int));
+        break;
+      case ARG_LONG:
+        fits &= put_arg(entry, len, va_arg(arg, long));
+        break;
+      case ARG_LLONG:
+        fits &= put_arg(entry, len, va_arg(arg, long long));
+        break;
+      case ARG_SIZE:
+        fits &= put_arg(entry, len, va_arg(arg, size_t));
+        break;
+      case ARG_DOUBLE:
+        fits &= put_arg(entry, len, va_arg(arg, double));
+        break;
+      case ARG_POINTER:
+        fits &= put_arg(entry, len, va_arg(arg, void *));
+        break;
+      case ARG_STRING: {
+        const char *str = va_arg(arg, const char *);
+        if (str == nullptr) {
+          str = "(null)";
+        }
+        const size_t n = strnlen(str, ALOG_MAX_STRING);
+        fits &= (len + n + 1 <= ALOG_MAX_ENTRY);
+        if (fits) {
+          memcpy(entry + len, str, n);
+          entry[len + n] = '\0';
+          len += n + 1;
+        }
+        break;
+      }
+      default:
+        break;
+    }
+    if (!fits) {
+      return 0;
+    }
+  }
+  entry[0] = (uint8_t)(len & 0xFF);
+  entry[1] = (uint8_t)(len >> 8);
+  entry[2] = prio;
+  return len;
+}
+
+template <typename T>
+static int format_arg(char *buffer, size_t size, const char *spec,
+                      const int *stars, uint8_t nrstars, T value) {
+  switch (nrstars) {
+    case 0:
+      return snprintf(buffer, size, spec, value);
+    case 1:
+      return snprintf(buffer, size, spec, stars[0], value);
+    default:
+      return snprintf(buffer, size, spec, stars[0], stars[1], value);
+  }
+}
+
+/**
+ * Format a recorded entry piecewise and write it to the output.
+ * Returns: number of written bytes
+ */
+static size_t alog_write(const uint8_t *entry) {
+  const uint8_t prio = entry[2];
+  size_t pos = 3;
+  PGM_P p = get_arg<PGM_P>(entry, pos);
+  size_t written = 0;
+
+  if (prio & ALOG_TAGGED) {
+    written += aprintf_print->print(F("pilight("));
+    written += aprintf_print->print(prio & ~ALOG_TAGGED);
+    written += aprintf_print->print(F("): "));
+  }
+  char buffer[64];
+  size_t len = 0;
+  char c;
+  while ((c = (char)pgm_read_byte(p++)) != '\0') {
+    if (c != '%') {
+      buffer[len++] = c;
+      if (len == sizeof(buffer)) {
+        written += aprintf_print->write((const uint8_t *)buffer, len);
+        len = 0;
+      }
+      continue;
+    }
+    written += aprintf_print->write((const uint8_t *)buffer, len);
+    len = 0;
+
+    char spec[16];
+    alog_arg_t type;
+    uint8_t nrstars;
+    p = parse_spec(p, spec, sizeof(spec), type, nrstars);
+    int stars[2] = {0, 0};
+    for (uint8_t i = 0; i < nrstars; i++) {
+      const int star = get_arg<int>(entry, pos);
+      if (i < 2) {
+        stars[i] = star;
+      }
+    }
+    int n = 0;
+    switch (type) {
+      case ARG_INT:
+        n = format_arg(buffer, sizeof(buffer), spec, stars, nrstars,
+                       get_arg<int>(entry, pos));
+        break;
+      case ARG_LONG:
+        n = format_arg(buffer, sizeof(buffer), spec, stars, nrstars,
+                       get_arg<long>(entry, pos));
+        break;
+      case ARG_LLONG:
+        n = format_arg(buffer, sizeof(buffer), spec, stars, nrstars,
+                       get_arg<long long>(entry, pos));
+        break;
+      case ARG_SIZE:
+        n = format_arg(buffer, sizeof(buffer), spec, stars, nrstars,
+                       get_arg<size_t>(entry, pos));
+        break;
+      case ARG_DOUBLE:
+        n = format_arg(buffer, sizeof(buffer), spec, stars, nrstars,
+                       get_arg<double>(entry, pos));
+        break;
+      case ARG_POINTER: {
+        void *pointer = get_arg<void *>(entry, pos);
+        if (spec[strlen(spec) - 1] == 'p') {
+          n = format_arg(buffer, sizeof(buffer), spec, stars, nrstars,
+                         pointer);
+        }
+        break;
+      }
+      case ARG_STRING: {
+        const char *str = (const char *)entry + pos;
+        pos += strlen(str) + 1;
+        if (strcmp(spec, "%s") == 0) {
+          written += aprintf_print->write((const uint8_t *)str, strlen(str));
+        } else {
+          n = format_arg(buffer, sizeof(buffer), spec, stars, nrstars, str);
+        }
+        break;
+      }
+      case ARG_PERCENT:
+        buffer[0] = '%';
+        n = 1;
+        break;
+      default:
+        n = snprintf(buffer, sizeof(buffer), "%s", spec);
+        break;
+    }
+    if (n > 0) {
+      len = ((size_t)n < sizeof(buffer)) ? (size_t)n : sizeof(buffer) - 1;
+      written += aprintf_print->write((const uint8_t *)buffer, len);
+    }
+    len = 0;
+  }
+  written += aprintf_print->write((const uint8_t *)buffer, len);
+  if (prio & ALOG_TAGGED) {
+    written += aprintf_print->println();
+  }
+  return written;
+}
+
+static bool alog_push(const uint8_t *entry, size_t len) {
+  const size_t head = alog_head;
+  const size_t used = (head + alog_size - alog_tail) % alog_size;
+  if (used + len >= alog_size) {
+    return false;
+  }
+  for (size_t i = 0; i < len; i++) {
+    alog_ring[(head + i) % alog_size] = entry[i];
+  }
+  alog_head = (head + len) % alog_size;
+  return true;
+}
+
+size_t alog_flush() {
+  size_t count = 0;
+  uint8_t entry[ALOG_MAX_ENTRY];
+  while (alog_tail != alog_head) {
+    const size_t tail = alog_tail;
+    const size_t len =
+        alog_ring[tail] | (alog_ring[(tail + 1) % alog_size] << 8);
+    for (size_t i = 0; i < len; i++) {
+      entry[i] = alog_ring[(tail + i) % alog_size];
+    }
+    alog_tail = (tail + len) % alog_size;
+    if (aprintf_print != nullptr) {
+      alog_write(entry);
+    }
+    count++;
+  }
+  if ((alog_dropped > 0) && (aprintf_print != nullptr)) {
+    const unsigned long dropped = alog_dropped;
+    alog_dropped -= dropped;
+    aprintf_print->print(F("pilight: "));
+    aprintf_print->print(dropped);
+    aprintf_print->println(F(" log messages dropped"));
+  }
+  return count;
+}
+
+static int vaprintf_P(PGM_P formatP, va_list arg) {
+  va_list copy;
+  va_copy(copy, arg);
   char temp[64];
   char *buffer = temp;
   size_t len = vsnprintf_P(temp, sizeof(temp), formatP, arg);
-  va_end(arg);
   if (len > sizeof(temp) - 1) {
     buffer = new char[len + 1];
     if (!buffer) {
+      va_end(copy);
       return 0;
     }
-    va_start(arg, formatP);
-    vsnprintf_P(buffer, len + 1, formatP, arg);
-    va_end(arg);
+    vsnprintf_P(buffer, len + 1, formatP, copy);
   }
+  va_end(copy);
   len = aprintf_print->write((const uint8_t *)buffer, len);
   if (buffer != temp) {
     delete[] buffer;
@@ -49,6 +381,48 @@ int aprintf_P(PGM_P formatP, ...) {
   return len;
 }
 
+static int valog_P(uint8_t prio, PGM_P formatP, va_list arg) {
+  if ((aprintf_print == nullptr) || ((prio & ~ALOG_TAGGED) > alog_level)) {
+    return 0;
+  }
+  if (alog_ring == nullptr) {
+    int len = 0;
+    if (prio & ALOG_TAGGED) {
+      len += aprintf_print->print(F("pilight("));
+      len += aprintf_print->print(prio & ~ALOG_TAGGED);
+      len += aprintf_print->print(F("): "));
+    }
+    len += vaprintf_P(formatP, arg);
+    if (prio & ALOG_TAGGED) {
+      len += aprintf_print->println();
+    }
+    return len;
+  }
+  uint8_t entry[ALOG_MAX_ENTRY];
+  const size_t len = alog_record(entry, prio, formatP, arg);
+  if ((len == 0) || !alog_push(entry, len)) {
+    alog_dropped++;
+    return 0;
+  }
+  return len;
+}
+
+int aprintf_P(PGM_P formatP, ...) {
+  va_list arg;
+  va_start(arg, formatP);
+  const int len = valog_P(ALOG_UNTAGGED, formatP, arg);
+  va_end(arg);
+  return len;
+}
+
+int alog_P(uint8_t prio, PGM_P formatP, ...) {
+  va_list arg;
+  va_start(arg, formatP);
+  const int len = valog_P(prio | ALOG_TAGGED, formatP, arg);
+  va_end(arg);
+  return len;
+}
+
 void exit(int n) {
   if (aprintf_print != nullptr) {
     aprintf_print->print(F("EXIT: "));
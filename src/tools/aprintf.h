@@ -20,6 +20,8 @@
 #define _APRINTF_H_
 
 #include <pgmspace.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #ifndef __cplusplus
 #include <stdio.h>
@@ -30,13 +32,37 @@
 #ifdef __cplusplus
 #include <Print.h>
 void set_aprintf_output(Print *output);
+
+/**
+ * Messages of alog_P() with a priority above level are discarded.
+ */
+void set_alog_level(uint8_t level);
+
+/**
+ * Record the messages into a ring buffer of size bytes instead of writing
+ * them, alog_flush() formats and writes them. Only the format string
+ * pointer and the arguments are recorded, strings are truncated to
+ * ALOG_MAX_STRING characters. A size of 0 restores synchronous output.
+ * Returns: false if the buffer could not be allocated
+ */
+bool set_alog_buffer(size_t size);
+
+/**
+ * Write the recorded messages and the number of dropped messages.
+ * Returns: number of written messages
+ */
+size_t alog_flush();
 #endif
 
+#define ALOG_MAX_STRING 48
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 void exit(int n);
 int aprintf_P(PGM_P formatP, ...) __attribute__((format(printf, 1, 2)));
+int alog_P(uint8_t prio, PGM_P formatP, ...)
+    __attribute__((format(printf, 2, 3)));
 #ifdef __cplusplus
 }
 #endif
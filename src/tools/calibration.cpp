@@ -0,0 +1,212 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include "calibration.h"
+
+// ESP32 doesn't define ICACHE_RAM_ATTR
+#ifndef ICACHE_RAM_ATTR
+#define ICACHE_RAM_ATTR IRAM_ATTR
+#endif
+
+uint8_t ICACHE_RAM_ATTR PulseHistogram::bin(unsigned long duration) {
+  if (duration < 16) {
+    return 0;
+  }
+  if (duration > 0xFFFF) {
+    return PULSE_HISTOGRAM_BINS - 1;
+  }
+  // highest bit by shifting, __builtin_clz() may call libgcc in flash
+  uint8_t octave = 4;
+  for (unsigned long rest = duration >> 5; rest != 0; rest >>= 1) {
+    octave++;
+  }
+  return (uint8_t)((octave - 4) * 4 + ((duration >> (octave - 2)) & 3));
+}
+
+void ICACHE_RAM_ATTR PulseHistogram::add(unsigned long duration) {
+  _counts[bin(duration)]++;
+  _total++;
+}
+
+void PulseHistogram::clear() {
+  for (uint8_t i = 0; i < PULSE_HISTOGRAM_BINS; i++) {
+    _counts[i] = 0;
+  }
+  _total = 0;
+}
+
+uint32_t PulseHistogram::countBelow(uint32_t duration) const {
+  uint32_t count = 0;
+  for (uint8_t i = 0;
+       (i < PULSE_HISTOGRAM_BINS) && (binFloor(i + 1) <= duration + 1); i++) {
+    count += _counts[i];
+  }
+  return count;
+}
+
+PulseCalibration::PulseCalibration()
+    : _frames(0),
+      _decoded(0),
+      _windowFrames(0),
+      _windowDecoded(0),
+      _rate(0),
+      _signalMin(0xFFFF),
+      _signalMax(0),
+      _previousMin(0),
+      _previousMax(0),
+      _unseenMin(0xFFFF),
+      _applied(false),
+      _reverted(false) {}
+
+void ICACHE_RAM_ATTR PulseCalibration::addEdge(unsigned long duration) {
+  _edges.add(duration);
+}
+
+void PulseCalibration::addFrame(const uint16_t *pulses, size_t length,
+                                bool decoded) {
+  _frames++;
+  _windowFrames++;
+  if (!decoded) {
+    return;
+  }
+  _decoded++;
+  _windowDecoded++;
+  for (size_t i = 0; i < length; i++) {
+    const uint16_t pulse = pulses[i];
+    _signal.add(pulse);
+    if (pulse < _signalMin) {
+      _signalMin = pulse;
+    }
+    if (pulse > _signalMax) {
+      _signalMax = pulse;
+    }
+  }
+}
+
+void PulseCalibration::reset() {
+  _edges.clear();
+  _signal.clear();
+  _frames = 0;
+  _decoded = 0;
+  _windowFrames = 0;
+  _windowDecoded = 0;
+  _rate = 0;
+  _signalMin = 0xFFFF;
+  _signalMax = 0;
+  _previousMin = 0;
+  _previousMax = 0;
+  _unseenMin = 0xFFFF;
+  _applied = false;
+  _reverted = false;
+}
+
+bool PulseCalibration::derive(uint16_t maxgaplen, uint16_t &minpulselen,
+                              uint16_t &maxpulselen) const {
+  if (_decoded < CALIBRATION_MIN_FRAMES) {
+    return false;
+  }
+  // skip the shortest 1% of the decoded pulses, e.g. glitches tolerated by
+  // the protocols
+  const uint32_t skip = _signal.total() / 100;
+  uint32_t count = 0;
+  uint8_t bin = 0;
+  while ((bin < PULSE_HISTOGRAM_BINS - 1) &&
+         ((count += _signal.count(bin)) <= skip)) {
+    bin++;
+  }
+  uint32_t shortest = PulseHistogram::binFloor(bin);
+  if (shortest < _signalMin) {
+    shortest = _signalMin;
+  }
+  const uint32_t lower = shortest - shortest / 4;
+  const uint32_t longest = (_signalMax > maxgaplen) ? _signalMax : maxgaplen;
+  const uint32_t upper = longest + longest / 4;
+  // room for the protocols that were not decoded yet
+  minpulselen = (uint16_t)((lower > _unseenMin) ? _unseenMin : lower);
+  maxpulselen = (uint16_t)((upper > 0xFFFF) ? 0xFFFF : upper);
+  return true;
+}
+
+bool PulseCalibration::update(uint16_t maxgaplen, uint16_t &minpulselen,
+                              uint16_t &maxpulselen) {
+  if (_reverted) {
+    return false;
+  }
+  // window with CALIBRATION_MIN_FRAMES expected decodes at the old rate
+  const bool window = _windowFrames * _rate >= CALIBRATION_MIN_FRAMES * 1000;
+  if (_applied && window &&
+      (_windowDecoded * 1000 < _windowFrames * (_rate / 2))) {
+    minpulselen = _previousMin;
+    maxpulselen = _previousMax;
+    _reverted = true;
+    return true;
+  }
+  uint16_t minLength;
+  uint16_t maxLength;
+  if ((_applied && !window) || !derive(maxgaplen, minLength, maxLength)) {
+    return false;
+  }
+  if (!_applied) {
+    _previousMin = minpulselen;
+    _previousMax = maxpulselen;
+    _rate = _decoded * 1000 / _frames;
+    _applied = true;
+  }
+  // only narrow the filter
+  if (minLength < _previousMin) {
+    minLength = _previousMin;
+  }
+  if (maxLength > _previousMax) {
+    maxLength = _previousMax;
+  }
+  _windowFrames = 0;
+  _windowDecoded = 0;
+  if ((minLength == minpulselen) && (maxLength == maxpulselen)) {
+    return false;
+  }
+  minpulselen = minLength;
+  maxpulselen = maxLength;
+  return true;
+}
+
+void PulseCalibration::print(Print &output, uint16_t maxgaplen) const {
+  uint16_t minLength = 0;
+  uint16_t maxLength = 0;
+  derive(maxgaplen, minLength, maxLength);
+  output.print(F("frames: "));
+  output.print(_frames);
+  output.print(F(", decoded: "));
+  output.print(_decoded);
+  output.print(F(", minpulselen: "));
+  output.print(minLength);
+  output.print(F(", maxpulselen: "));
+  output.print(maxLength);
+  output.print(F(", noise edges: "));
+  output.println(_edges.countBelow(minLength));
+  for (uint8_t i = 0; i < PULSE_HISTOGRAM_BINS; i++) {
+    if ((_edges.count(i) == 0) && (_signal.count(i) == 0)) {
+      continue;
+    }
+    output.print(PulseHistogram::binFloor(i));
+    output.print(' ');
+    output.print(_edges.count(i));
+    output.print(' ');
+    output.println(_signal.count(i));
+  }
+}
@@ -0,0 +1,160 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef _CALIBRATION_H_
+#define _CALIBRATION_H_
+
+#include <Arduino.h>
+
+// four bins per octave from 16 us to 65535 us
+#define PULSE_HISTOGRAM_BINS 48
+
+/**
+ * Histogram of pulse widths with four logarithmic bins per octave, bin 0
+ * also counts pulses shorter than 16 us. add() is O(1) and may be called
+ * from the interrupt handler (bin() and add() are in IRAM).
+ */
+class PulseHistogram {
+ public:
+  PulseHistogram() { clear(); }
+
+  /**
+   * Returns: bin of duration
+   */
+  static uint8_t bin(unsigned long duration);
+
+  /**
+   * Returns: shortest pulse of a bin, PULSE_HISTOGRAM_BINS returns the end
+   * of the last bin
+   */
+  static uint32_t binFloor(uint8_t bin) {
+    return (uint32_t)(4 + (bin & 3)) << (bin / 4 + 2);
+  }
+
+  void add(unsigned long duration);
+
+  void clear();
+
+  uint32_t count(uint8_t bin) const { return _counts[bin]; }
+  uint32_t total() const { return _total; }
+
+  /**
+   * Returns: number of pulses in the bins that end at or below duration
+   */
+  uint32_t countBelow(uint32_t duration) const;
+
+ private:
+  volatile uint32_t _counts[PULSE_HISTOGRAM_BINS];
+  volatile uint32_t _total;
+};
+
+/**
+ * Derives the receiver filter (ESPiLight::minpulselen and maxpulselen)
+ * from the received pulses (see ESPiLight::setCalibrationEnabled()). All
+ * edges are counted in edges(), the pulses of the decoded pulse trains
+ * in signal(). The bounds keep a margin of 25% to the shortest (ignoring
+ * the shortest 1%) and the longest decoded pulse, so the noise band below
+ * the pulses of the enabled protocols is filtered in the interrupt
+ * handler. The lower bound also keeps room for the enabled protocols that
+ * were not decoded yet (see setUnseenMin()).
+ */
+class PulseCalibration {
+ public:
+  PulseCalibration();
+
+  /**
+   * Count an edge, called from the interrupt handler.
+   */
+  void addEdge(unsigned long duration);
+
+  /**
+   * Count a parsed pulse train.
+   */
+  void addFrame(const uint16_t *pulses, size_t length, bool decoded);
+
+  /**
+   * Forget the counted pulses and the applied bounds, e.g. after the
+   * enabled protocols changed. Edges counted by the interrupt handler
+   * meanwhile may be lost.
+   */
+  void reset();
+
+  /**
+   * Set the shortest pulse expected from the enabled protocols that were
+   * not decoded yet, the lower bound stays at or below it (default: 0xFFFF,
+   * no limit).
+   */
+  void setUnseenMin(uint16_t duration) { _unseenMin = duration; }
+
+  /**
+   * Derive the bounds. The upper bound covers at least maxgaplen.
+   * Returns: false if less than CALIBRATION_MIN_FRAMES pulse trains were
+   * decoded
+   */
+  bool derive(uint16_t maxgaplen, uint16_t &minpulselen,
+              uint16_t &maxpulselen) const;
+
+  /**
+   * Apply the derived bounds, as far as they narrow the filter, and
+   * supervise them: if the decode rate of the following pulse trains
+   * (enough for CALIBRATION_MIN_FRAMES decodes at the rate before) drops
+   * below half of the rate before, the previous bounds are restored and
+   * the calibration stops changing them. Called after addFrame().
+   * Returns: true if the bounds were changed
+   */
+  bool update(uint16_t maxgaplen, uint16_t &minpulselen,
+              uint16_t &maxpulselen);
+
+  const PulseHistogram &edges() const { return _edges; }
+  const PulseHistogram &signal() const { return _signal; }
+  uint32_t frames() const { return _frames; }
+  uint32_t decoded() const { return _decoded; }
+  uint16_t signalMin() const { return _signalMin; }
+  uint16_t signalMax() const { return _signalMax; }
+  bool reverted() const { return _reverted; }
+
+  /**
+   * Print the derived bounds and the non-empty bins of both histograms:
+   * shortest pulse of the bin, edges, decoded pulses.
+   */
+  void print(Print &output, uint16_t maxgaplen) const;
+
+  static const uint32_t CALIBRATION_MIN_FRAMES = 16;
+  // footer per shortest pulse, that is assumed for the protocols that
+  // were not decoded yet (pilight footers are about 34 pulses)
+  static const uint16_t CALIBRATION_FOOTER_RATIO = 64;
+
+ private:
+  PulseHistogram _edges;
+  PulseHistogram _signal;
+  uint32_t _frames;
+  uint32_t _decoded;
+  uint32_t _windowFrames;  // since the bounds were applied
+  uint32_t _windowDecoded;
+  uint32_t _rate;  // decoded per 1000 frames before the bounds were applied
+  uint16_t _signalMin;
+  uint16_t _signalMax;
+  uint16_t _previousMin;  // bounds before the calibration
+  uint16_t _previousMax;
+  uint16_t _unseenMin;
+  bool _applied;
+  bool _reverted;
+};
+
+#endif  // _CALIBRATION_H_
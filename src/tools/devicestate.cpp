@@ -0,0 +1,196 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include "devicestate.h"
+
+extern "C" {
+#include "../pilight/libs/pilight/core/json.h"
+}
+
+static const char *const identity_fields[] = {
+    "id", "systemcode", "unitcode", "unit", "channel", "programcode",
+};
+
+static uint32_t hash_key(const char *protocol, const char *device) {
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for (const char *c = protocol; *c != '\0'; c++) {
+    hash = (hash ^ (uint8_t)*c) * 16777619u;
+  }
+  hash *= 16777619u;  // '\0' separator
+  for (const char *c = device; *c != '\0'; c++) {
+    hash = (hash ^ (uint8_t)*c) * 16777619u;
+  }
+  return hash;
+}
+
+DeviceStateTable::DeviceStateTable(size_t capacity)
+    : _entries(new Entry[capacity]()),
+      _capacity(capacity),
+      _size(0),
+      _heartbeat(0),
+      _callback(nullptr) {}
+
+DeviceStateTable::~DeviceStateTable() {
+  clear();
+  delete[] _entries;
+}
+
+void DeviceStateTable::setCallback(DeviceStateCallBack callback) {
+  _callback = callback;
+}
+
+void DeviceStateTable::setHeartbeat(unsigned long interval) {
+  _heartbeat = interval;
+}
+
+ESPiLightCallBack DeviceStateTable::callback() {
+  return [this](const String &protocol, const String &message, int status,
+                size_t repeats, const String &deviceID) {
+    (void)status;
+    (void)repeats;
+    (void)deviceID;
+    update(protocol, message);
+  };
+}
+
+String DeviceStateTable::deviceOf(const char *message) {
+  if (!json_validate(message)) {
+    return String();
+  }
+  JsonNode *json = json_decode(message);
+  String device('{');
+  for (const char *field : identity_fields) {
+    JsonNode *node = json_find_member(json, field);
+    if (node == nullptr) {
+      continue;
+    }
+    char *value = json_encode(node);
+    if (device.length() > 1) {
+      device += ',';
+    }
+    device += '"';
+    device += field;
+    device += "\":";
+    device += value;
+    json_free(value);
+  }
+  device += '}';
+  json_delete(json);
+  return device;
+}
+
+DeviceStateTable::Entry *DeviceStateTable::lookup(uint32_t hash,
+                                                  const char *protocol,
+                                                  const char *device) const {
+  for (size_t i = 0; i < _size; i++) {
+    Entry &entry = _entries[i];
+    if ((entry.hash == hash) && (strcmp(entry.data, protocol) == 0)) {
+      const char *stored = entry.data + strlen(entry.data) + 1;
+      if (strcmp(stored, device) == 0) {
+        return &entry;
+      }
+    }
+  }
+  return nullptr;
+}
+
+bool DeviceStateTable::update(const String &protocol, const String &message) {
+  if (_capacity == 0) {
+    return false;
+  }
+  const String device = deviceOf(message.c_str());
+  if (device.length() == 0) {
+    return false;
+  }
+  const uint32_t hash = hash_key(protocol.c_str(), device.c_str());
+  const unsigned long now = millis();
+  DeviceStateReason_t reason = DEVICE_CHANGED;
+
+  Entry *entry = lookup(hash, protocol.c_str(), device.c_str());
+  if (entry != nullptr) {
+    const char *stored = entry->data + protocol.length() + device.length() + 2;
+    entry->lastSeen = now;
+    if (strcmp(stored, message.c_str()) == 0) {
+      if ((_heartbeat == 0) || (now - entry->lastPublish < _heartbeat)) {
+        return false;
+      }
+      reason = DEVICE_HEARTBEAT;
+    }
+  } else {
+    reason = DEVICE_NEW;
+    if (_size < _capacity) {
+      entry = &_entries[_size++];
+    } else {
+      entry = &_entries[0];
+      for (size_t i = 1; i < _size; i++) {
+        if (now - _entries[i].lastSeen > now - entry->lastSeen) {
+          entry = &_entries[i];
+        }
+      }
+    }
+    entry->hash = hash;
+    entry->lastSeen = now;
+  }
+
+  if (reason != DEVICE_HEARTBEAT) {
+    const size_t size =
+        protocol.length() + device.length() + message.length() + 3;
+    char *data = new char[size];
+    memcpy(data, protocol.c_str(), protocol.length() + 1);
+    memcpy(data + protocol.length() + 1, device.c_str(), device.length() + 1);
+    memcpy(data + protocol.length() + device.length() + 2, message.c_str(),
+           message.length() + 1);
+    delete[] entry->data;
+    entry->data = data;
+  }
+  entry->lastPublish = now;
+  if (_callback != nullptr) {
+    _callback(protocol, device, message, reason);
+  }
+  return true;
+}
+
+const char *DeviceStateTable::find(const char *protocol,
+                                   const char *device) const {
+  const String key = deviceOf(device);
+  const Entry *entry =
+      lookup(hash_key(protocol, key.c_str()), protocol, key.c_str());
+  if (entry == nullptr) {
+    return nullptr;
+  }
+  return entry->data + strlen(protocol) + key.length() + 2;
+}
+
+void DeviceStateTable::forEach(DeviceStateVisitor visitor) const {
+  for (size_t i = 0; i < _size; i++) {
+    const char *protocol = _entries[i].data;
+    const char *device = protocol + strlen(protocol) + 1;
+    const char *message = device + strlen(device) + 1;
+    visitor(protocol, device, message, _entries[i].lastSeen);
+  }
+}
+
+void DeviceStateTable::clear() {
+  for (size_t i = 0; i < _size; i++) {
+    delete[] _entries[i].data;
+    _entries[i].data = nullptr;
+  }
+  _size = 0;
+}
@@ -0,0 +1,119 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef _DEVICESTATE_H_
+#define _DEVICESTATE_H_
+
+#include <ESPiLight.h>
+
+enum DeviceStateReason_t {
+  DEVICE_NEW,       // first message of the device
+  DEVICE_CHANGED,   // message differs from the last one
+  DEVICE_HEARTBEAT  // same message, but heartbeat interval expired
+};
+
+typedef std::function<void(const String &protocol, const String &device,
+                           const String &message, DeviceStateReason_t reason)>
+    DeviceStateCallBack;
+
+typedef std::function<void(const char *protocol, const char *device,
+                           const char *message, unsigned long lastSeen)>
+    DeviceStateVisitor;
+
+/**
+ * Cache of the last message of every device, keyed by protocol and device.
+ * The device is identified by the fields "id", "systemcode", "unitcode",
+ * "unit", "channel" and "programcode" of the message, written as json
+ * object in this order, e.g. {"id":100,"unit":1}. Repeated messages are
+ * suppressed, the callback is only fired for new devices, changed
+ * messages or after the heartbeat interval.
+ *
+ * Usage:
+ *   DeviceStateTable states(16);
+ *   states.setCallback(publish);
+ *   rf.setCallback(states.callback());
+ */
+class DeviceStateTable {
+ public:
+  /**
+   * capacity: maximal number of devices, the device seen least recently
+   * is replaced if the table is full.
+   */
+  explicit DeviceStateTable(size_t capacity = 16);
+  ~DeviceStateTable();
+
+  void setCallback(DeviceStateCallBack callback);
+
+  /**
+   * Fire the callback for unchanged messages if the last callback of the
+   * device is older than interval ms. 0 (default) disables heartbeats.
+   */
+  void setHeartbeat(unsigned long interval);
+
+  /**
+   * Store message of protocol and fire the callback if needed.
+   * Returns: true if the callback was fired
+   */
+  bool update(const String &protocol, const String &message);
+
+  /**
+   * Returns: callback for ESPiLight::setCallback() that calls update()
+   */
+  ESPiLightCallBack callback();
+
+  /**
+   * Last message of a device, device is a json object containing the
+   * identifying fields (other fields are ignored).
+   * Returns: message or nullptr if the device is unknown
+   */
+  const char *find(const char *protocol, const char *device) const;
+
+  /**
+   * Call visitor for every known device.
+   */
+  void forEach(DeviceStateVisitor visitor) const;
+
+  size_t size() const { return _size; }
+
+  void clear();
+
+  /**
+   * Returns: device of a json message (see DeviceStateTable) or empty
+   * String if the message is not valid json.
+   */
+  static String deviceOf(const char *message);
+
+ private:
+  struct Entry {
+    uint32_t hash;  // of protocol and device
+    char *data;     // protocol, device and message, '\0' terminated
+    unsigned long lastSeen;
+    unsigned long lastPublish;
+  };
+
+  Entry *lookup(uint32_t hash, const char *protocol, const char *device) const;
+
+  Entry *_entries;
+  size_t _capacity;
+  size_t _size;
+  unsigned long _heartbeat;
+  DeviceStateCallBack _callback;
+};
+
+#endif  // _DEVICESTATE_H_
@@ -0,0 +1,228 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include "edgecapture.h"
+
+#include <ESPiLight.h>
+
+// ESP32 doesn't define ICACHE_RAM_ATTR
+#ifndef ICACHE_RAM_ATTR
+#define ICACHE_RAM_ATTR IRAM_ATTR
+#endif
+
+// entry before the number of lost edges, an edge of this time stamp is
+// recorded 1 us earlier
+#define LOST_MARKER ((unsigned long)-1)
+
+EdgeCapture::EdgeCapture(Print &output, size_t size)
+    : _output(output),
+      _edges((size >= EDGE_CAPTURE_MIN_SIZE) ? new unsigned long[size]
+                                             : nullptr),
+      _size(size),
+      _head(0),
+      _tail(0),
+      _lost(0),
+      _last(0),
+      _hasLast(false),
+      _started(false) {}
+
+EdgeCapture::~EdgeCapture() { delete[] _edges; }
+
+void ICACHE_RAM_ATTR EdgeCapture::record(unsigned long now) {
+  const size_t tail = _tail;
+  const size_t free = (tail + _size - _head - 1) % _size;
+  size_t head = _head;
+  if ((free == 0) || ((_lost > 0) && (free < 3))) {
+    _lost++;
+    return;
+  }
+  if (_lost > 0) {
+    // the loss is written at its position, before this edge
+    _edges[head] = LOST_MARKER;
+    head = (head + 1) % _size;
+    _edges[head] = _lost;
+    head = (head + 1) % _size;
+    _lost = 0;
+  }
+  _edges[head] = (now != LOST_MARKER) ? now : now - 1;
+  _head = (head + 1) % _size;
+}
+
+size_t EdgeCapture::flush() {
+  size_t count = 0;
+  if (!_started) {
+    _output.println(F("#espilight-capture 1"));
+    _started = true;
+  }
+  while (_tail != _head) {
+    const unsigned long now = _edges[_tail];
+    _tail = (_tail + 1) % _size;
+    if (now == LOST_MARKER) {
+      _output.print('x');
+      _output.print(_edges[_tail]);
+      _output.print(' ');
+      _tail = (_tail + 1) % _size;
+      continue;
+    }
+    if (_hasLast) {
+      _output.print(now - _last);
+      _output.print((++count % 16 == 0) ? '\n' : ' ');
+    }
+    _hasLast = true;
+    _last = now;
+  }
+  // a loss without a following edge is not in the ring buffer yet
+  noInterrupts();
+  const unsigned long lost = (_tail == _head) ? _lost : 0;
+  if (lost > 0) {
+    _lost = 0;
+  }
+  interrupts();
+  if (lost > 0) {
+    _output.print('x');
+    _output.print(lost);
+    _output.print(' ');
+  }
+  if (count % 16 != 0) {
+    _output.println();
+  }
+  return count;
+}
+
+unsigned long EdgeReplay::_now = 0;
+
+EdgeReplay::EdgeReplay(ESPiLight &rf)
+    : _rf(rf), _stats(), _speed(0), _loopInterval(10000), _lastLoop(0) {
+  _now = 0;
+  ESPiLight::setClock(&EdgeReplay::now);
+  ESPiLight::enableReceiver();
+}
+
+EdgeReplay::~EdgeReplay() { ESPiLight::setClock(&micros); }
+
+void EdgeReplay::setSpeed(unsigned int speed) { _speed = speed; }
+
+void EdgeReplay::setLoopInterval(unsigned long interval) {
+  _loopInterval = interval;
+}
+
+unsigned long EdgeReplay::now() { return _now; }
+
+bool EdgeReplay::replay(Stream &input) {
+  unsigned long value = 0;
+  bool digits = false;
+  bool lost = false;
+  bool comment = false;
+  char c;
+
+  while (true) {
+    const bool end = (input.readBytes(&c, 1) != 1);
+    if (comment) {
+      comment = !end && (c != '\n');
+      continue;
+    }
+    if (!end && (c >= '0') && (c <= '9')) {
+      value = value * 10 + (unsigned long)(c - '0');
+      digits = true;
+      continue;
+    }
+    if (digits) {
+      if (lost) {
+        _stats.lost += value;
+      } else {
+        feed(value);
+      }
+      value = 0;
+      digits = false;
+      lost = false;
+    }
+    if (end) {
+      break;
+    }
+    if (c == '#') {
+      comment = true;
+    } else if (c == 'x') {
+      lost = true;
+    } else if ((c != ' ') && (c != '\n') && (c != '\r') && (c != '\t')) {
+      return false;
+    }
+  }
+  finish();
+  return true;
+}
+
+void EdgeReplay::feed(unsigned long duration) {
+  if ((_speed > 0) && (duration / _speed > 0)) {
+    unsigned long wait = duration / _speed;
+    if (wait >= 1000) {
+      delay(wait / 1000);
+      wait %= 1000;
+    }
+    delayMicroseconds((unsigned int)wait);
+  }
+  _now += duration;
+  _stats.edges++;
+  switch (ESPiLight::handleEdge(_now)) {
+    case EDGE_FRAME:
+      _stats.frames++;
+      break;
+    case EDGE_REJECTED:
+      _stats.rejected++;
+      break;
+    case EDGE_DROPPED:
+      _stats.dropped++;
+      break;
+    default:
+      break;
+  }
+  if (_now - _lastLoop >= _loopInterval) {
+    processQueue();
+    _lastLoop = _now;
+  }
+}
+
+void EdgeReplay::finish() { processQueue(); }
+
+void EdgeReplay::processQueue() {
+  int matches;
+  // like loop(), frames of the streaming decoders are not reported twice
+  while ((matches = _rf.parseReceivedPulseTrain()) >= 0) {
+    if (matches > 0) {
+      _stats.decoded++;
+      _stats.matches += matches;
+    }
+  }
+}
+
+void EdgeReplay::printStats(Print &output) const {
+  output.print(F("edges: "));
+  output.print(_stats.edges);
+  output.print(F(", lost: "));
+  output.print(_stats.lost);
+  output.print(F(", frames: "));
+  output.print(_stats.frames);
+  output.print(F(", rejected: "));
+  output.print(_stats.rejected);
+  output.print(F(", dropped: "));
+  output.print(_stats.dropped);
+  output.print(F(", decoded: "));
+  output.print(_stats.decoded);
+  output.print(F(", matches: "));
+  output.println(_stats.matches);
+}
@@ -0,0 +1,154 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef _EDGECAPTURE_H_
+#define _EDGECAPTURE_H_
+
+#include <ESPiLight.h>
+
+// a loss is recorded as marker and count before the next edge
+#define EDGE_CAPTURE_MIN_SIZE 4
+
+/**
+ * Records the time stamps of the receiver interrupt into a ring buffer and
+ * writes them as text to a Print:
+ *  - a header line "#espilight-capture 1"
+ *  - durations between edges in us, separated by whitespace
+ *  - "x<n>" if n edges were lost because the ring buffer was full, at the
+ *    position of the loss
+ * Lines starting with '#' are comments.
+ */
+class EdgeCapture {
+ public:
+  /**
+   * size: edges of the ring buffer, at least EDGE_CAPTURE_MIN_SIZE
+   */
+  EdgeCapture(Print &output, size_t size);
+  ~EdgeCapture();
+
+  /**
+   * Returns: false if the ring buffer could not be allocated or is too
+   * small
+   */
+  bool valid() const {
+    return (_edges != nullptr) && (_size >= EDGE_CAPTURE_MIN_SIZE);
+  }
+
+  /**
+   * Returns: heap used by the capture in bytes
+   */
+  size_t memoryUsage() const {
+    return sizeof(*this) + _size * sizeof(unsigned long);
+  }
+
+  /**
+   * Record edge, called from the interrupt handler.
+   */
+  void record(unsigned long now);
+
+  /**
+   * Write recorded edges to the output.
+   * Returns: number of written edges
+   */
+  size_t flush();
+
+ private:
+  Print &_output;
+  unsigned long *_edges;
+  size_t _size;
+  volatile size_t _head;
+  volatile size_t _tail;
+  volatile unsigned long _lost;
+  unsigned long _last;
+  bool _hasLast;
+  bool _started;
+};
+
+typedef struct ReplayStats_t {
+  unsigned long edges;     // replayed edges
+  unsigned long lost;      // edges lost during capture
+  unsigned long frames;    // completed frames
+  unsigned long rejected;  // frames with length outside minrawlen/maxrawlen
+  unsigned long dropped;   // frames dropped, because the queue was full
+  unsigned long decoded;   // frames decoded by at least one protocol
+  unsigned long matches;   // protocol matches
+} ReplayStats_t;
+
+/**
+ * Feeds a capture into the receiver logic of ESPiLight with a virtual
+ * clock, the receiver queue is processed every loop interval of virtual
+ * time.
+ */
+class EdgeReplay {
+ public:
+  explicit EdgeReplay(ESPiLight &rf);
+  ~EdgeReplay();
+
+  /**
+   * Replay speed: 0 replays as fast as possible, 1 in real time, n is n
+   * times faster than real time.
+   */
+  void setSpeed(unsigned int speed);
+
+  /**
+   * Virtual time between receiver queue processing, like a sketch calling
+   * ESPiLight::loop() and delay(). Default: 10000 us
+   */
+  void setLoopInterval(unsigned long interval);
+
+  /**
+   * Replay a capture until the end of input.
+   * Returns: false if the capture is invalid
+   */
+  bool replay(Stream &input);
+
+  /**
+   * Replay single edge.
+   */
+  void feed(unsigned long duration);
+
+  /**
+   * Process remaining frames of the receiver queue.
+   */
+  void finish();
+
+  const ReplayStats_t &stats() const { return _stats; }
+
+  /**
+   * Print statistics as a single line.
+   */
+  void printStats(Print &output) const;
+
+  /**
+   * Returns: virtual time of the running replay
+   */
+  static unsigned long now();
+
+ private:
+  void processQueue();
+
+  ESPiLight &_rf;
+  ReplayStats_t _stats;
+  unsigned int _speed;
+  unsigned long _loopInterval;
+  unsigned long _lastLoop;
+  static unsigned long _now;
+};
+
+#endif  // _EDGECAPTURE_H_
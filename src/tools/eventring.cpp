@@ -0,0 +1,99 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include "eventring.h"
+
+EventRing::EventRing(ESPiLightEvent_t *events, uint8_t slots, char *payload,
+                     uint16_t size)
+    : _events(events),
+      _payload(payload),
+      _size(size),
+      _head(0),
+      _held(0),
+      _slots(slots),
+      _first(0),
+      _count(0),
+      _holding(false),
+      _stats() {}
+
+bool EventRing::push(ESPiLightEvent_t &event, const char *message) {
+  const size_t length = strlen(message);
+  const size_t needed = length + 1;
+  bool fits = false;
+  uint16_t offset = 0;
+
+  if (_count < _slots) {
+    if ((_count == 0) && !_holding) {
+      _head = 0;
+      fits = (needed <= _size);
+    } else {
+      // oldest payload in use, the payloads are allocated in ring order
+      const uint16_t tail = _holding ? _held : _events[_first].offset;
+      if (_head > tail) {
+        if (needed <= (size_t)(_size - _head)) {
+          offset = _head;
+          fits = true;
+        } else {
+          fits = (needed < tail);
+        }
+      } else {
+        offset = _head;
+        fits = (needed < (size_t)(tail - _head));
+      }
+    }
+  }
+  if (!fits) {
+    _stats.dropped++;
+    return false;
+  }
+
+  memcpy(_payload + offset, message, needed);
+  _head = offset + (uint16_t)needed;
+  event.offset = offset;
+  event.length = (uint16_t)length;
+  _events[(_first + _count) % _slots] = event;
+  _count++;
+  _stats.pushed++;
+  if (_count > _stats.highWater) {
+    _stats.highWater = _count;
+  }
+  return true;
+}
+
+bool EventRing::poll(ESPiLightEvent_t &event) {
+  _holding = false;
+  if (_count == 0) {
+    return false;
+  }
+  event = _events[_first];
+  _first = (_first + 1) % _slots;
+  _count--;
+  _held = event.offset;
+  _holding = true;
+  return true;
+}
+
+void EventRing::clear() {
+  _head = 0;
+  _first = 0;
+  _count = 0;
+  _holding = false;
+}
+
+void EventRing::resetStats() { _stats = EventRingStats_t(); }
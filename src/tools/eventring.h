@@ -0,0 +1,116 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef _EVENTRING_H_
+#define _EVENTRING_H_
+
+#include <Arduino.h>
+
+#define EVENT_NO_DEVICE_ID INT32_MIN
+
+/**
+ * Decoded message, see EventRing::poll().
+ */
+typedef struct ESPiLightEvent_t {
+  unsigned long time;  // clock of the pulse train, see ESPiLight::setClock()
+  int32_t deviceId;    // numeric "id" of the message or EVENT_NO_DEVICE_ID
+  uint16_t offset;     // json message at EventRing::payload()
+  uint16_t length;     // length of the json message
+  uint8_t protocol;    // protocol index, see ESPiLight::protocolName()
+  uint8_t status;      // PilightRepeatStatus_t
+  uint8_t repeats;
+} ESPiLightEvent_t;
+
+typedef struct EventRingStats_t {
+  unsigned long pushed;   // queued events
+  unsigned long dropped;  // events lost, because the ring was full
+  uint8_t highWater;      // maximal number of queued events
+} EventRingStats_t;
+
+/**
+ * Fixed size queue of decoded messages, filled by ESPiLight in addition to
+ * the callback (see ESPiLight::setEventRing()). The events and
+ * their json messages are stored in the buffers given to the constructor,
+ * the ring does not use the heap. If there is no free slot or not enough
+ * payload space, the new event is dropped.
+ */
+class EventRing {
+ public:
+  EventRing(ESPiLightEvent_t *events, uint8_t slots, char *payload,
+            uint16_t size);
+
+  /**
+   * Queue event, the message is copied into the payload buffer.
+   * Returns: false if the event was dropped
+   */
+  bool push(ESPiLightEvent_t &event, const char *message);
+
+  /**
+   * Dequeue the oldest event. The payload of the event stays valid until
+   * the next call of poll().
+   * Returns: false if the ring is empty
+   */
+  bool poll(ESPiLightEvent_t &event);
+
+  /**
+   * Returns: json message of a polled event
+   */
+  const char *payload(const ESPiLightEvent_t &event) const {
+    return _payload + event.offset;
+  }
+
+  /**
+   * Returns: number of queued events
+   */
+  uint8_t available() const { return _count; }
+
+  void clear();
+
+  const EventRingStats_t &stats() const { return _stats; }
+  void resetStats();
+
+ private:
+  ESPiLightEvent_t *_events;
+  char *_payload;
+  uint16_t _size;
+  uint16_t _head;  // next free payload byte
+  uint16_t _held;  // payload offset of the last polled event
+  uint8_t _slots;
+  uint8_t _first;  // oldest queued event
+  uint8_t _count;
+  bool _holding;
+  EventRingStats_t _stats;
+};
+
+/**
+ * EventRing with embedded buffers, e.g. as global variable:
+ * StaticEventRing<8, 512> events;
+ */
+template <uint8_t Slots, uint16_t PayloadBytes>
+class StaticEventRing : public EventRing {
+ public:
+  StaticEventRing()
+      : EventRing(_eventBuffer, Slots, _payloadBuffer, PayloadBytes) {}
+
+ private:
+  ESPiLightEvent_t _eventBuffer[Slots];
+  char _payloadBuffer[PayloadBytes];
+};
+
+#endif  // _EVENTRING_H_
@@ -0,0 +1,219 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include "fixedpoint.h"
+
+#include <stdio.h>
+#include <string.h>
+#ifdef ESP8266
+#include <stdlib_noniso.h>  // dtostrf()
+#endif
+
+static const uint32_t pow10_table[FIXED_MAX_DECIMALS + 1] = {
+    1,      10,      100,      1000,      10000,
+    100000, 1000000, 10000000, 100000000, 1000000000};
+
+/**
+ * Round mantissa * 2^exponent * scale to an integer like printf: the
+ * exact binary value is rounded, ties to even.
+ * Returns: false if the result does not fit into 64 bits
+ */
+static bool scale_rounded(uint64_t mantissa, int exponent, uint32_t scale,
+                          uint64_t &result) {
+  if (exponent >= 0) {
+    if ((exponent > 63) || (mantissa > (UINT64_MAX >> exponent)) ||
+        ((mantissa << exponent) > UINT64_MAX / scale)) {
+      return false;
+    }
+    result = (mantissa << exponent) * scale;
+    return true;
+  }
+  const int shift = -exponent;
+  // mantissa < 2^53 and scale < 2^30: the product has less than 83 bits
+  if (shift > 84) {
+    result = 0;
+    return true;
+  }
+  const uint64_t low = (mantissa & 0xFFFFFFFF) * scale;
+  const uint64_t high = (mantissa >> 32) * scale;
+  const uint64_t lo = low + (high << 32);
+  const uint64_t hi = (high >> 32) + (lo < low ? 1 : 0);
+  uint64_t quotient;
+  int compare;  // remainder against half of 2^shift
+  if (shift < 64) {
+    if ((hi >> shift) != 0) {
+      return false;
+    }
+    quotient = (lo >> shift) | ((hi << 1) << (63 - shift));
+    const uint64_t remainder = lo & ((UINT64_C(1) << shift) - 1);
+    const uint64_t half = UINT64_C(1) << (shift - 1);
+    compare = (remainder > half) ? 1 : ((remainder == half) ? 0 : -1);
+  } else {
+    quotient = hi >> (shift - 64);
+    const uint64_t remainder = hi & ((UINT64_C(1) << (shift - 64)) - 1);
+    if (shift == 64) {
+      compare = (lo > UINT64_C(1) << 63) ? 1
+                                         : ((lo == UINT64_C(1) << 63) ? 0 : -1);
+    } else {
+      const uint64_t half = UINT64_C(1) << (shift - 65);
+      compare = (remainder > half)
+                    ? 1
+                    : ((remainder < half) ? -1 : ((lo > 0) ? 1 : 0));
+    }
+  }
+  if ((compare > 0) || ((compare == 0) && (quotient & 1))) {
+    if (quotient == UINT64_MAX) {
+      return false;
+    }
+    quotient++;
+  }
+  result = quotient;
+  return true;
+}
+
+/**
+ * Write magnitude / 10^decimals into buffer.
+ * Returns: length of the text or 0 if size is too small
+ */
+static size_t format_scaled(char *buffer, size_t size, bool negative,
+                            uint64_t magnitude, uint8_t decimals) {
+  char digits[24];
+  size_t count = 0;
+  if (decimals > FIXED_MAX_DECIMALS) {
+    return 0;
+  }
+  do {
+    digits[count++] = (char)('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude > 0);
+  while (count <= decimals) {
+    digits[count++] = '0';
+  }
+
+  const size_t length = count + (negative ? 1 : 0) + (decimals > 0 ? 1 : 0);
+  if (length + 1 > size) {
+    return 0;
+  }
+  char *out = buffer;
+  if (negative) {
+    *out++ = '-';
+  }
+  while (count > 0) {
+    if (count == decimals) {
+      *out++ = '.';
+    }
+    *out++ = digits[--count];
+  }
+  *out = '\0';
+  return length;
+}
+
+int json_format_number(char *buf, double num, int decimals) {
+  // IEEE 754 binary64: sign, 11 bits exponent, 52 bits mantissa
+  uint64_t bits;
+  memcpy(&bits, &num, sizeof(bits));
+  const bool negative = (bits >> 63) != 0;  // -0.0 too, like printf
+  const int exponent = (int)((bits >> 52) & 0x7FF);
+  uint64_t mantissa = bits & ((UINT64_C(1) << 52) - 1);
+  if ((decimals >= 0) && (decimals <= FIXED_MAX_DECIMALS) &&
+      (exponent != 0x7FF)) {
+    if (exponent != 0) {
+      mantissa |= UINT64_C(1) << 52;
+    }
+    // |num| = mantissa * 2^(exponent - 1075), subnormals have exponent 1
+    uint64_t magnitude;
+    if (scale_rounded(mantissa, (exponent != 0 ? exponent : 1) - 1075,
+                      pow10_table[decimals], magnitude)) {
+      return (int)format_scaled(buf, 32, negative, magnitude,
+                                (uint8_t)decimals);
+    }
+  }
+  // out of range, infinite or NaN, rejected by number_is_valid() of json.c
+#ifdef ESP8266
+  dtostrf(num, 0, decimals, buf);
+  return (int)strlen(buf);
+#else
+  return sprintf(buf, "%.*f", decimals, num);
+#endif
+}
+
+const char *parseFixedPoint(const char *text, FixedPoint_t &number) {
+  const bool negative = (*text == '-');
+  if (negative) {
+    text++;
+  }
+  if ((*text < '0') || (*text > '9')) {
+    return nullptr;
+  }
+  int64_t value = 0;
+  uint8_t decimals = 0;
+  bool fraction = false;
+  for (;; text++) {
+    if ((*text == '.') && !fraction) {
+      fraction = true;
+      continue;
+    }
+    if ((*text < '0') || (*text > '9')) {
+      break;
+    }
+    if (fraction) {
+      if (decimals == FIXED_MAX_DECIMALS) {
+        continue;  // truncate
+      }
+      decimals++;
+    }
+    value = value * 10 + (*text - '0');
+    if (value > INT32_MAX) {
+      return nullptr;
+    }
+  }
+  number.value = (int32_t)(negative ? -value : value);
+  number.decimals = decimals;
+  return text;
+}
+
+bool findFixedPoint(const char *json, const char *key, FixedPoint_t &number) {
+  const size_t length = strlen(key);
+  for (const char *p = strchr(json, '"'); p != nullptr;
+       p = strchr(p + 1, '"')) {
+    if ((strncmp(p + 1, key, length) != 0) || (p[length + 1] != '"') ||
+        (p[length + 2] != ':')) {
+      continue;
+    }
+    return parseFixedPoint(p + length + 3, number) != nullptr;
+  }
+  return false;
+}
+
+size_t formatFixedPoint(char *buffer, size_t size,
+                        const FixedPoint_t &number) {
+  const bool negative = (number.value < 0);
+  const uint64_t magnitude = negative ? -(int64_t)number.value : number.value;
+  return format_scaled(buffer, size, negative, magnitude, number.decimals);
+}
+
+int32_t roundFixedPoint(const FixedPoint_t &number) {
+  if (number.decimals == 0) {
+    return number.value;
+  }
+  const int64_t scale = pow10_table[number.decimals];
+  const int64_t value = number.value;
+  return (int32_t)((value < 0) ? (value - scale / 2) / scale
+                               : (value + scale / 2) / scale);
+}
@@ -0,0 +1,76 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef _FIXEDPOINT_H_
+#define _FIXEDPOINT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FIXED_MAX_DECIMALS 9
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/* Format num rounded to decimals digits like sprintf("%.*f") with integer
+   arithmetic, used by json.c. buf needs at least 32 bytes for numbers
+   below 2^64 / 10^decimals, larger numbers are formatted by sprintf (by
+   dtostrf on ESP8266). */
+int json_format_number(char *buf, double num, int decimals);
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+/**
+ * Decimal number value / 10^decimals
+ */
+typedef struct FixedPoint_t {
+  int32_t value;
+  uint8_t decimals;
+} FixedPoint_t;
+
+/**
+ * Parse a decimal number (e.g. "-21.5") without floating point.
+ * Returns: pointer behind the number or nullptr if text is not a number
+ * or out of range
+ */
+const char *parseFixedPoint(const char *text, FixedPoint_t &number);
+
+/**
+ * Find the number of key in a flat json object, e.g. the message of the
+ * callback: findFixedPoint(message.c_str(), "temperature", number)
+ * Returns: false if key is not found or its value is not a number
+ */
+bool findFixedPoint(const char *json, const char *key, FixedPoint_t &number);
+
+/**
+ * Format number into buffer.
+ * Returns: length of the text
+ */
+size_t formatFixedPoint(char *buffer, size_t size, const FixedPoint_t &number);
+
+/**
+ * Returns: number rounded to an integer, halfway cases away from zero like
+ * round()
+ */
+int32_t roundFixedPoint(const FixedPoint_t &number);
+#endif
+
+#endif  // _FIXEDPOINT_H_
@@ -0,0 +1,75 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef _PULSETRAINQUEUE_H_
+#define _PULSETRAINQUEUE_H_
+
+#include <stdint.h>
+
+/**
+ * Storage and index arithmetic of the receiver queue of ESPiLightT: Slots
+ * pulse trains of up to MaxPulses pulses. For a power of two Slots or
+ * MaxPulses, the indices wrap with a mask.
+ */
+template <uint8_t Slots, uint8_t MaxPulses>
+class PulseTrainQueue {
+  static_assert(Slots >= 2, "the queue needs at least two slots");
+  static_assert(MaxPulses >= 2, "a pulse train needs at least two pulses");
+
+ public:
+  static const uint8_t slots = Slots;
+  static const uint8_t maxPulses = MaxPulses;
+
+  typedef struct PulseTrain {
+    uint16_t pulses[MaxPulses];
+    uint8_t length;  // 0 if the slot is free
+  } PulseTrain;
+
+  /**
+   * Returns: slot following slot
+   */
+  static inline uint8_t nextSlot(uint8_t slot) {
+    return ((Slots & (Slots - 1)) == 0)
+               ? (uint8_t)((slot + 1) & (Slots - 1))
+               : (uint8_t)((slot + 1 == Slots) ? 0 : slot + 1);
+  }
+
+  /**
+   * Returns: slot preceding slot
+   */
+  static inline uint8_t previousSlot(uint8_t slot) {
+    return ((Slots & (Slots - 1)) == 0)
+               ? (uint8_t)((slot - 1) & (Slots - 1))
+               : (uint8_t)((slot == 0) ? Slots - 1 : slot - 1);
+  }
+
+  /**
+   * Returns: pulse index following pulse, wraps to 0 at MaxPulses
+   */
+  static inline uint8_t nextPulse(uint8_t pulse) {
+    return ((MaxPulses & (MaxPulses - 1)) == 0)
+               ? (uint8_t)((pulse + 1) & (MaxPulses - 1))
+               : (uint8_t)((pulse + 1 == MaxPulses) ? 0 : pulse + 1);
+  }
+
+  PulseTrain trains[Slots];
+  uint8_t count;  // queued pulse trains, head and tail are equal if full
+};
+
+#endif  // _PULSETRAINQUEUE_H_
@@ -0,0 +1,275 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include "rawcodes.h"
+
+/**
+ * Normalize pulse train into types and indices and compute the fingerprint
+ * of the pulse type sequence, sorted is the scratch buffer of the
+ * normalization.
+ * Returns: number of pulse types or 0 if the pulse train is invalid
+ */
+static uint8_t fingerprint(const uint16_t *train, size_t length,
+                           uint16_t *types, uint8_t *indices,
+                           uint16_t *sorted, uint32_t &hash) {
+  if ((length == 0) || (length > MAXPULSESTREAMLENGTH)) {
+    return 0;
+  }
+  const uint8_t ntypes =
+      ESPiLight::normalizePulseTrain(train, length, types, indices, sorted);
+  // FNV-1a
+  hash = (2166136261u ^ ntypes) * 16777619u;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ indices[i]) * 16777619u;
+  }
+  return ntypes;
+}
+
+static bool read_varint(const uint8_t *&pos, const uint8_t *end,
+                        unsigned long &value) {
+  value = 0;
+  for (unsigned int shift = 0; (shift < 32) && (pos < end); shift += 7) {
+    const uint8_t byte = *pos++;
+    value |= (unsigned long)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool within(unsigned long pulse, unsigned long code,
+                   uint8_t tolerance) {
+  const unsigned long diff = (pulse > code) ? pulse - code : code - pulse;
+  return diff * 100 <= code * tolerance;
+}
+
+/**
+ * Compare a code of ESPiLight::pulseTrainToBinary() in place with the
+ * pulse train given by types and indices, without decoding it into a
+ * pulse buffer.
+ * Returns: true if every pulse is within tolerance percent of the code
+ */
+static bool same_code(const uint8_t *code, size_t size,
+                      const uint16_t *types, const uint8_t *indices,
+                      size_t length, uint8_t tolerance) {
+  const uint8_t *pos = code + 2;
+  const uint8_t *end = code + size;
+  unsigned long value;
+  if ((size < 2) || (code[0] != ESPiLight::PULSETRAIN_BINARY_VERSION) ||
+      (code[1] > MAX_PULSE_TYPES) || !read_varint(pos, end, value) ||
+      (value != length)) {
+    return false;
+  }
+  const uint8_t ntypes = code[1];
+  if (ntypes == 0) {
+    for (size_t i = 0; i < length; i++) {
+      if (!read_varint(pos, end, value) ||
+          !within(types[indices[i]], value, tolerance)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  uint16_t codeTypes[MAX_PULSE_TYPES];
+  for (uint8_t i = 0; i < ntypes; i++) {
+    if (!read_varint(pos, end, value)) {
+      return false;
+    }
+    codeTypes[i] = (uint16_t)value;
+  }
+  if ((size_t)(end - pos) < (length + 1) / 2) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i++) {
+    const uint8_t type = (i & 1) ? (pos[i / 2] >> 4) : (pos[i / 2] & 0x0F);
+    if ((type >= ntypes) ||
+        !within(types[indices[i]], codeTypes[type], tolerance)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+RawCodeIndex::RawCodeIndex(size_t capacity)
+    : _entries(nullptr),
+      _capacity(1),
+      _maxSize(capacity),
+      _size(0),
+      _tolerance(20),
+      _callback(nullptr),
+      _pulses(new uint16_t[MAXPULSESTREAMLENGTH]),
+      _indices(new uint8_t[MAXPULSESTREAMLENGTH]),
+      _code(new uint8_t[CODE_SIZE]) {
+  // keep the load factor below 3/4
+  while (_capacity * 3 < capacity * 4) {
+    _capacity <<= 1;
+  }
+  _entries = new Entry[_capacity]();
+}
+
+RawCodeIndex::~RawCodeIndex() {
+  for (size_t i = 0; i < _capacity; i++) {
+    delete[] _entries[i].code;
+    delete[] _entries[i].label;
+  }
+  delete[] _entries;
+  delete[] _pulses;
+  delete[] _indices;
+  delete[] _code;
+}
+
+void RawCodeIndex::setCallback(RawCodeCallBack callback) {
+  _callback = callback;
+}
+
+void RawCodeIndex::setTolerance(uint8_t percent) { _tolerance = percent; }
+
+PulseTrainCallBack RawCodeIndex::callback() {
+  return [this](const uint16_t *pulses, size_t length) {
+    match(pulses, length);
+  };
+}
+
+RawCodeIndex::Entry *RawCodeIndex::find(uint32_t fingerprint,
+                                        const uint16_t *types,
+                                        const uint8_t *indices,
+                                        size_t length) {
+  for (size_t slot = fingerprint & (_capacity - 1);
+       _entries[slot].code != nullptr; slot = (slot + 1) & (_capacity - 1)) {
+    Entry &entry = _entries[slot];
+    if ((entry.fingerprint == fingerprint) &&
+        same_code(entry.code, entry.codeSize, types, indices, length,
+                  _tolerance)) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+bool RawCodeIndex::learn(const uint16_t *pulses, size_t length,
+                         const String &label) {
+  uint16_t types[MAX_PULSE_TYPES];
+  uint32_t hash;
+  if (fingerprint(pulses, length, types, _indices, _pulses, hash) == 0) {
+    return false;
+  }
+  char *name = new char[label.length() + 1];
+  memcpy(name, label.c_str(), label.length() + 1);
+
+  Entry *entry = find(hash, types, _indices, length);
+  if (entry != nullptr) {
+    delete[] entry->label;
+    entry->label = name;
+    return true;
+  }
+  // the sorted pulses are not needed any more
+  for (size_t i = 0; i < length; i++) {
+    _pulses[i] = types[_indices[i]];
+  }
+  const size_t size =
+      ESPiLight::pulseTrainToBinary(_pulses, length, _code, CODE_SIZE);
+  if ((_size >= _maxSize) || (size == 0)) {
+    delete[] name;
+    return false;
+  }
+  size_t slot = hash & (_capacity - 1);
+  while (_entries[slot].code != nullptr) {
+    slot = (slot + 1) & (_capacity - 1);
+  }
+  entry = &_entries[slot];
+  entry->fingerprint = hash;
+  entry->code = new uint8_t[size];
+  memcpy(entry->code, _code, size);
+  entry->codeSize = size;
+  entry->label = name;
+  _size++;
+  return true;
+}
+
+void RawCodeIndex::remove(size_t slot) {
+  delete[] _entries[slot].code;
+  delete[] _entries[slot].label;
+  _entries[slot] = Entry();
+  _size--;
+  // reinsert the rest of the cluster (linear probing without tombstones)
+  for (size_t next = (slot + 1) & (_capacity - 1);
+       _entries[next].code != nullptr; next = (next + 1) & (_capacity - 1)) {
+    Entry entry = _entries[next];
+    _entries[next] = Entry();
+    size_t free = entry.fingerprint & (_capacity - 1);
+    while (_entries[free].code != nullptr) {
+      free = (free + 1) & (_capacity - 1);
+    }
+    _entries[free] = entry;
+  }
+}
+
+size_t RawCodeIndex::forget(const String &label) {
+  size_t removed = 0;
+  for (size_t slot = 0; slot < _capacity; slot++) {
+    while ((_entries[slot].label != nullptr) &&
+           (strcmp(_entries[slot].label, label.c_str()) == 0)) {
+      remove(slot);
+      removed++;
+    }
+  }
+  return removed;
+}
+
+const char *RawCodeIndex::match(const uint16_t *pulses, size_t length) {
+  uint16_t types[MAX_PULSE_TYPES];
+  uint32_t hash;
+  if ((_size == 0) ||
+      (fingerprint(pulses, length, types, _indices, _pulses, hash) == 0)) {
+    return nullptr;
+  }
+  const Entry *entry = find(hash, types, _indices, length);
+  if (entry == nullptr) {
+    return nullptr;
+  }
+  if (_callback != nullptr) {
+    _callback(String(entry->label), pulses, length);
+  }
+  return entry->label;
+}
+
+int RawCodeIndex::pulseTrain(const String &label, uint16_t *pulses,
+                             size_t maxlength) const {
+  for (size_t slot = 0; slot < _capacity; slot++) {
+    const Entry &entry = _entries[slot];
+    if ((entry.label != nullptr) && (strcmp(entry.label, label.c_str()) == 0)) {
+      const int length = ESPiLight::binaryToPulseTrain(
+          entry.code, entry.codeSize, pulses, maxlength);
+      return (length > 0) ? length : 0;
+    }
+  }
+  return 0;
+}
+
+bool RawCodeIndex::send(ESPiLight &rf, const String &label,
+                        size_t repeats) const {
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  const int length = pulseTrain(label, pulses, MAXPULSESTREAMLENGTH);
+  if (length <= 0) {
+    return false;
+  }
+  rf.sendPulseTrain(pulses, (size_t)length, repeats);
+  return true;
+}
@@ -0,0 +1,128 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef _RAWCODES_H_
+#define _RAWCODES_H_
+
+#include <ESPiLight.h>
+
+typedef std::function<void(const String &label, const uint16_t *pulses,
+                           size_t length)>
+    RawCodeCallBack;
+
+/**
+ * Hash index of learned raw codes of remotes without pilight protocol.
+ *
+ * A learned pulse train is normalized (ESPiLight::normalizePulseTrain()),
+ * stored in the compact binary format (ESPiLight::pulseTrainToBinary())
+ * and indexed by a fingerprint of its sequence of pulse types. The
+ * sequence does not change with jitter, so a received pulse train is
+ * found with one hash lookup; the pulse widths of the candidates are
+ * compared with a tolerance directly in the binary format.
+ *
+ * Usage:
+ *   RawCodeIndex codes(16);
+ *   codes.learn(pulses, length, "garage");
+ *   codes.setCallback(rawCodeCallback);
+ *   rf.setUnknownPulseTrainCallBack(codes.callback());
+ */
+class RawCodeIndex {
+ public:
+  /**
+   * capacity: maximal number of codes
+   */
+  explicit RawCodeIndex(size_t capacity = 16);
+  ~RawCodeIndex();
+
+  void setCallback(RawCodeCallBack callback);
+
+  /**
+   * Maximal difference of a pulse width in percent (default 20).
+   */
+  void setTolerance(uint8_t percent);
+
+  /**
+   * Store pulse train with label, an already known code gets the new
+   * label.
+   * Returns: false if the index is full or the pulse train is invalid
+   */
+  bool learn(const uint16_t *pulses, size_t length, const String &label);
+
+  /**
+   * Remove all codes with label.
+   * Returns: number of removed codes
+   */
+  size_t forget(const String &label);
+
+  /**
+   * Look up pulse train and fire the callback with the label.
+   * Returns: label or nullptr if the pulse train is unknown
+   */
+  const char *match(const uint16_t *pulses, size_t length);
+
+  /**
+   * Returns: callback for ESPiLight::setUnknownPulseTrainCallBack() that
+   * calls match()
+   */
+  PulseTrainCallBack callback();
+
+  /**
+   * Write the (normalized) pulse train of label into pulses.
+   * Returns: length of the pulse train or 0 if label is unknown
+   */
+  int pulseTrain(const String &label, uint16_t *pulses,
+                 size_t maxlength) const;
+
+  /**
+   * Transmit the code of label with rf.
+   * Returns: false if label is unknown
+   */
+  bool send(ESPiLight &rf, const String &label, size_t repeats = 10) const;
+
+  size_t size() const { return _size; }
+
+ private:
+  struct Entry {
+    uint32_t fingerprint;
+    uint8_t *code;  // pulseTrainToBinary() of the normalized pulse train
+    size_t codeSize;
+    char *label;
+  };
+
+  // packed format: at most MAX_PULSE_TYPES - 1 types
+  static const size_t CODE_SIZE =
+      4 + MAX_PULSE_TYPES * 3 + (MAXPULSESTREAMLENGTH + 1) / 2;
+
+  Entry *find(uint32_t fingerprint, const uint16_t *types,
+              const uint8_t *indices, size_t length);
+  void remove(size_t slot);
+
+  Entry *_entries;
+  size_t _capacity;  // number of slots, a power of two
+  size_t _maxSize;
+  size_t _size;
+  uint8_t _tolerance;
+  RawCodeCallBack _callback;
+  // scratch buffers of learn() and match(), not on the stack of loop()
+  uint16_t *_pulses;
+  uint8_t *_indices;
+  uint8_t *_code;
+};
+
+#endif  // _RAWCODES_H_
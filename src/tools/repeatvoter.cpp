@@ -0,0 +1,100 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include "repeatvoter.h"
+
+#include <ESPiLight.h>
+
+RepeatVoter::RepeatVoter(uint8_t depth, unsigned long window)
+    : _frames(nullptr),
+      _consensus(nullptr),
+      _window(window),
+      _last(0),
+      _depth((depth < MAX_VOTES) ? depth : MAX_VOTES),
+      _count(0),
+      _next(0),
+      _length(0) {
+  _frames = new uint16_t[(_depth + 1) * MAXPULSESTREAMLENGTH];
+  if (_frames != nullptr) {
+    _consensus = _frames + _depth * MAXPULSESTREAMLENGTH;
+  }
+}
+
+RepeatVoter::~RepeatVoter() { delete[] _frames; }
+
+void RepeatVoter::add(const uint16_t *pulses, uint8_t length,
+                      unsigned long now) {
+  if ((now - _last > _window) || !sameSignature(pulses, length)) {
+    clear();
+  }
+  _length = length;
+  _last = now;
+  memcpy(_frames + _next * MAXPULSESTREAMLENGTH, pulses,
+         length * sizeof(uint16_t));
+  _next = (_next + 1) % _depth;
+  if (_count < _depth) {
+    _count++;
+  }
+}
+
+static bool similar_pulse(uint16_t a, uint16_t b) {
+  const uint16_t larger = (a > b) ? a : b;
+  const uint16_t diff = (a > b) ? a - b : b - a;
+  return diff <= larger / 4 + 50;
+}
+
+bool RepeatVoter::sameSignature(const uint16_t *pulses,
+                                uint8_t length) const {
+  if (length != _length) {
+    return false;
+  }
+  // a glitch of the pulse train, and of the buffered one if it is alone
+  const uint8_t maxGlitches = (_count == 1) ? 2 : 1;
+  uint8_t glitches = 0;
+  for (uint8_t i = 0; i < length; i++) {
+    bool similar = false;
+    for (uint8_t j = 0; !similar && (j < _count); j++) {
+      similar = similar_pulse(pulses[i], _frames[j * MAXPULSESTREAMLENGTH + i]);
+    }
+    if (!similar && (++glitches > maxGlitches)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint16_t *RepeatVoter::vote() {
+  if (_count < MIN_VOTES) {
+    return nullptr;
+  }
+  uint16_t values[MAX_VOTES];
+  for (uint8_t i = 0; i < _length; i++) {
+    // insertion sort of the pulse i of the buffered pulse trains
+    for (uint8_t j = 0; j < _count; j++) {
+      const uint16_t value = _frames[j * MAXPULSESTREAMLENGTH + i];
+      uint8_t k = j;
+      for (; (k > 0) && (values[k - 1] > value); k--) {
+        values[k] = values[k - 1];
+      }
+      values[k] = value;
+    }
+    _consensus[i] = values[_count / 2];
+  }
+  return _consensus;
+}
@@ -0,0 +1,75 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef _REPEATVOTER_H_
+#define _REPEATVOTER_H_
+
+#include <Arduino.h>
+
+/**
+ * Buffer of the last pulse trains with the same length, used to compute a
+ * consensus of corrupted repeats (see ESPiLight::setRepeatVoting()).
+ */
+class RepeatVoter {
+ public:
+  static const uint8_t MIN_VOTES = 3;  // pulse trains of a vote
+  static const uint8_t MAX_VOTES = 9;  // limit of depth
+
+  RepeatVoter(uint8_t depth, unsigned long window);
+  ~RepeatVoter();
+
+  /**
+   * Returns: false if the buffer could not be allocated
+   */
+  bool valid() const { return _frames != nullptr; }
+
+  /**
+   * Add pulse train received at now. The buffer is cleared if the pulse
+   * train has a different length or signature, or the last one is older
+   * than window. The signature matches, if every pulse is within 25% of
+   * the same pulse of at least one buffered pulse train. A single pulse
+   * (a glitch) may differ, two if only one pulse train is buffered.
+   */
+  void add(const uint16_t *pulses, uint8_t length, unsigned long now);
+
+  /**
+   * Returns: median of every pulse of the buffered pulse trains or nullptr
+   * if less than MIN_VOTES pulse trains are buffered
+   */
+  uint16_t *vote();
+
+  void clear() {
+    _count = 0;
+    _next = 0;
+  }
+
+ private:
+  bool sameSignature(const uint16_t *pulses, uint8_t length) const;
+
+  uint16_t *_frames;     // depth pulse trains of MAXPULSESTREAMLENGTH
+  uint16_t *_consensus;  // MAXPULSESTREAMLENGTH
+  unsigned long _window;
+  unsigned long _last;
+  uint8_t _depth;
+  uint8_t _count;
+  uint8_t _next;  // slot of the next pulse train
+  uint8_t _length;
+};
+
+#endif  // _REPEATVOTER_H_
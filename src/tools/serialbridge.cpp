@@ -0,0 +1,281 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include "serialbridge.h"
+
+uint16_t bridgeCrc16(uint16_t crc, const uint8_t *data, size_t length) {
+  while (length-- > 0) {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021)
+                           : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static void writeFrameHeader(uint8_t *frame, uint8_t type, size_t length) {
+  frame[0] = BRIDGE_SYNC;
+  frame[1] = type;
+  frame[2] = (uint8_t)(length & 0xFF);
+  frame[3] = (uint8_t)(length >> 8);
+}
+
+static void writeFrameCrc(uint8_t *frame, size_t length) {
+  const uint16_t crc = bridgeCrc16(0xFFFF, frame + 1, length + 3);
+  frame[length + 4] = (uint8_t)(crc & 0xFF);
+  frame[length + 5] = (uint8_t)(crc >> 8);
+}
+
+size_t encodeBridgeFrame(uint8_t type, const uint8_t *payload, size_t length,
+                         uint8_t *buffer, size_t size) {
+  if ((length > 0xFFFF) || (length + BRIDGE_OVERHEAD > size)) {
+    return 0;
+  }
+  writeFrameHeader(buffer, type, length);
+  memcpy(buffer + 4, payload, length);
+  writeFrameCrc(buffer, length);
+  return length + BRIDGE_OVERHEAD;
+}
+
+BridgeFrameParser::BridgeFrameParser(size_t maxPayload)
+    : _payload(new uint8_t[maxPayload + 1]),
+      _maxPayload(maxPayload),
+      _length(0),
+      _received(0),
+      _errors(0),
+      _crc(0),
+      _state(SYNC),
+      _type(0) {}
+
+BridgeFrameParser::~BridgeFrameParser() { delete[] _payload; }
+
+bool BridgeFrameParser::feed(uint8_t c) {
+  switch (_state) {
+    case SYNC:
+      if (c == BRIDGE_SYNC) {
+        _crc = 0xFFFF;
+        _state = TYPE;
+      }
+      return false;
+    case TYPE:
+      _type = c;
+      _state = LENGTH_LOW;
+      break;
+    case LENGTH_LOW:
+      _length = c;
+      _state = LENGTH_HIGH;
+      break;
+    case LENGTH_HIGH:
+      _length |= (size_t)c << 8;
+      _received = 0;
+      if (_length > _maxPayload) {
+        _errors++;
+        _state = SYNC;
+        return false;
+      }
+      _state = (_length > 0) ? PAYLOAD : CRC_LOW;
+      break;
+    case PAYLOAD:
+      _payload[_received++] = c;
+      if (_received == _length) {
+        _state = CRC_LOW;
+      }
+      break;
+    case CRC_LOW:
+      _received = c;
+      _state = CRC_HIGH;
+      return false;
+    case CRC_HIGH:
+      _state = SYNC;
+      if ((((uint16_t)c << 8) | _received) != _crc) {
+        _errors++;
+        return false;
+      }
+      _payload[_length] = '\0';
+      return true;
+  }
+  _crc = bridgeCrc16(_crc, &c, 1);
+  return false;
+}
+
+SerialBridge::SerialBridge(Stream &stream, ESPiLight &rf, size_t batchSize,
+                           size_t commandSize)
+    : _stream(stream),
+      _rf(rf),
+      _parser(commandSize),
+      _batch(new uint8_t[batchSize]),
+      _batchSize(batchSize),
+      _used(0),
+      _frame(0),
+      _stats(),
+      _credits(0),
+      _flowControl(true) {}
+
+SerialBridge::~SerialBridge() { delete[] _batch; }
+
+ESPiLightCallBack SerialBridge::callback() {
+  return [this](const String &protocol, const String &message, int status,
+                size_t repeats, const String &deviceID) {
+    queueMessage(protocol, message, status, repeats, deviceID);
+  };
+}
+
+PulseTrainCallBack SerialBridge::pulseTrainCallback() {
+  return [this](const uint16_t *pulses, size_t length) {
+    queuePulseTrain(pulses, length);
+  };
+}
+
+bool SerialBridge::queueMessage(const String &protocol, const String &message,
+                                int status, size_t repeats,
+                                const String &deviceID) {
+  const size_t length =
+      protocol.length() + deviceID.length() + message.length() + 4;
+  uint8_t *payload = beginFrame(BRIDGE_MESSAGE, length, true);
+  if (payload == nullptr) {
+    return false;
+  }
+  payload[0] = (uint8_t)(int8_t)status;
+  payload[1] = (uint8_t)((repeats > 0xFF) ? 0xFF : repeats);
+  uint8_t *pos = payload + 2;
+  memcpy(pos, protocol.c_str(), protocol.length() + 1);
+  pos += protocol.length() + 1;
+  memcpy(pos, deviceID.c_str(), deviceID.length() + 1);
+  pos += deviceID.length() + 1;
+  memcpy(pos, message.c_str(), message.length());
+  endFrame(length, true);
+  return true;
+}
+
+bool SerialBridge::queuePulseTrain(const uint16_t *pulses, size_t length) {
+  for (uint8_t attempt = 0; attempt < 2; attempt++) {
+    uint8_t *payload = beginFrame(BRIDGE_PULSETRAIN, 0, true);
+    if (payload == nullptr) {
+      return false;
+    }
+    const size_t size = ESPiLight::pulseTrainToBinary(
+        pulses, length, payload, _batchSize - _used - BRIDGE_OVERHEAD);
+    if (size > 0) {
+      endFrame(size, true);
+      return true;
+    }
+    if (_used == 0) {
+      break;
+    }
+    // retry with an empty batch
+    flush();
+  }
+  _stats.dropped++;
+  return false;
+}
+
+uint8_t *SerialBridge::beginFrame(uint8_t type, size_t length, bool credit) {
+  if ((credit && _flowControl && (_credits == 0)) ||
+      (length + BRIDGE_OVERHEAD > _batchSize)) {
+    _stats.dropped++;
+    return nullptr;
+  }
+  if (_used + length + BRIDGE_OVERHEAD > _batchSize) {
+    flush();
+  }
+  _frame = _used;
+  _batch[_frame + 1] = type;
+  return _batch + _frame + 4;
+}
+
+void SerialBridge::endFrame(size_t length, bool credit) {
+  uint8_t *frame = _batch + _frame;
+  writeFrameHeader(frame, frame[1], length);
+  writeFrameCrc(frame, length);
+  _used = _frame + length + BRIDGE_OVERHEAD;
+  _stats.frames++;
+  if (credit && _flowControl) {
+    _credits--;
+  }
+}
+
+void SerialBridge::loop() {
+  const unsigned long errors = _parser.errors();
+  while (_stream.available() > 0) {
+    const int c = _stream.read();
+    if (c < 0) {
+      break;
+    }
+    if (_parser.feed((uint8_t)c)) {
+      execute(_parser.type(), _parser.payload(), _parser.length());
+    }
+  }
+  _stats.errors += _parser.errors() - errors;
+  flush();
+}
+
+void SerialBridge::execute(uint8_t type, const uint8_t *payload,
+                           size_t length) {
+  int result = ERROR_INVALID_COMMAND;
+  switch (type) {
+    case BRIDGE_CREDIT:
+      if (length == 2) {
+        const uint32_t credits =
+            (uint32_t)_credits + (payload[0] | ((uint32_t)payload[1] << 8));
+        _credits = (credits > 0xFFFF) ? 0xFFFF : (uint16_t)credits;
+      }
+      return;
+    case BRIDGE_SEND_PULSETRAIN:
+      if (length > 1) {
+        uint16_t pulses[MAXPULSESTREAMLENGTH];
+        result = ESPiLight::binaryToPulseTrain(payload + 1, length - 1, pulses,
+                                               MAXPULSESTREAMLENGTH);
+        if (result > 0) {
+          _rf.sendPulseTrain(pulses, (size_t)result, payload[0]);
+        }
+      }
+      break;
+    case BRIDGE_SEND_MESSAGE:
+      // the parser terminates the payload, the json is the last field
+      if ((length > 1) && (memchr(payload + 1, '\0', length - 1) != nullptr)) {
+        const char *protocol = (const char *)payload + 1;
+        const char *json = protocol + strlen(protocol) + 1;
+        result = _rf.send(String(protocol), String(json), payload[0]);
+      }
+      break;
+    default:
+      break;
+  }
+  _stats.commands++;
+  uint8_t *frame = beginFrame(BRIDGE_RESULT, 3, false);
+  if (frame != nullptr) {
+    frame[0] = type;
+    frame[1] = (uint8_t)(result & 0xFF);
+    frame[2] = (uint8_t)((result >> 8) & 0xFF);
+    endFrame(3, false);
+  }
+}
+
+size_t SerialBridge::flush() {
+  if (_used == 0) {
+    return 0;
+  }
+  const size_t written = _stream.write(_batch, _used);
+  _stats.writes++;
+  _used = 0;
+  return written;
+}
+
+void SerialBridge::resetStats() { _stats = BridgeStats_t(); }
@@ -0,0 +1,218 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef _SERIALBRIDGE_H_
+#define _SERIALBRIDGE_H_
+
+#include <ESPiLight.h>
+
+/**
+ * Binary framing of the serial bridge, every frame is:
+ *  - sync byte BRIDGE_SYNC
+ *  - frame type (BridgeFrameType_t)
+ *  - payload length n, uint16_t little endian
+ *  - n bytes payload
+ *  - CRC-16/CCITT-FALSE of type, length and payload, little endian
+ */
+#define BRIDGE_SYNC 0xA5
+#define BRIDGE_OVERHEAD 6
+
+enum BridgeFrameType_t {
+  // device to host
+  BRIDGE_PULSETRAIN = 0x01,  // pulse train (ESPiLight::pulseTrainToBinary())
+  BRIDGE_MESSAGE = 0x02,     // int8_t status, uint8_t repeats, protocol,
+                             // '\0', deviceID, '\0', json message
+  BRIDGE_RESULT = 0x03,      // command type, int16_t result (little endian)
+  // host to device
+  BRIDGE_CREDIT = 0x81,           // uint16_t frames the host accepts more
+  BRIDGE_SEND_PULSETRAIN = 0x82,  // uint8_t repeats, binary pulse train
+  BRIDGE_SEND_MESSAGE = 0x83      // uint8_t repeats, protocol, '\0', json
+};
+
+/**
+ * Returns: CRC-16/CCITT-FALSE of data, continued from crc (start: 0xFFFF)
+ */
+uint16_t bridgeCrc16(uint16_t crc, const uint8_t *data, size_t length);
+
+/**
+ * Write a frame into buffer.
+ * Returns: number of written bytes or 0 if the buffer is too small
+ */
+size_t encodeBridgeFrame(uint8_t type, const uint8_t *payload, size_t length,
+                         uint8_t *buffer, size_t size);
+
+/**
+ * Incremental frame decoder, used by the device for the commands and by
+ * the host for the frames of the device. Bytes before a sync byte, frames
+ * with a wrong CRC and frames larger than the payload buffer are skipped.
+ */
+class BridgeFrameParser {
+ public:
+  explicit BridgeFrameParser(size_t maxPayload = 256);
+  ~BridgeFrameParser();
+
+  /**
+   * Returns: false if the payload buffer could not be allocated
+   */
+  bool valid() const { return _payload != nullptr; }
+
+  /**
+   * Feed the next received byte.
+   * Returns: true if a frame is complete, type(), payload() and length()
+   * stay valid until the next call. The payload is followed by a '\0'.
+   */
+  bool feed(uint8_t c);
+
+  uint8_t type() const { return _type; }
+  const uint8_t *payload() const { return _payload; }
+  size_t length() const { return _length; }
+
+  /**
+   * Returns: number of skipped frames
+   */
+  unsigned long errors() const { return _errors; }
+
+ private:
+  enum State_t {
+    SYNC,
+    TYPE,
+    LENGTH_LOW,
+    LENGTH_HIGH,
+    PAYLOAD,
+    CRC_LOW,
+    CRC_HIGH
+  };
+
+  uint8_t *_payload;
+  size_t _maxPayload;
+  size_t _length;
+  size_t _received;
+  unsigned long _errors;
+  uint16_t _crc;
+  State_t _state;
+  uint8_t _type;
+};
+
+typedef struct BridgeStats_t {
+  unsigned long frames;    // frames written to the stream
+  unsigned long writes;    // batches written to the stream
+  unsigned long dropped;   // frames dropped without credit or batch space
+  unsigned long commands;  // commands executed
+  unsigned long errors;    // skipped frames of the host
+} BridgeStats_t;
+
+/**
+ * Streams the received pulse trains and decoded messages of ESPiLight to a
+ * host in the binary framing above and transmits the commands of the host.
+ * Frames are collected in a batch buffer and written with a single write()
+ * by loop() or if the batch is full. The host grants credits with
+ * BRIDGE_CREDIT frames, every pulse train and message frame takes one
+ * credit, without credit the frame is dropped. Every command is answered
+ * with a BRIDGE_RESULT frame, which does not need a credit: the result of
+ * ESPiLight::send(), the length of the transmitted pulse train or an error
+ * of ESPiLight::binaryToPulseTrain().
+ *
+ * Nothing else may be written to the stream. If it is Serial, the pilight
+ * messages (default output: Serial) have to be redirected with
+ * ESPiLight::setErrorOutput(), otherwise they corrupt the frames.
+ *
+ * Usage:
+ *   ESPiLight::setErrorOutput(Serial1);
+ *   SerialBridge bridge(Serial, rf);
+ *   rf.setCallback(bridge.callback());
+ *   rf.setPulseTrainCallBack(bridge.pulseTrainCallback());
+ *   ...
+ *   rf.loop();
+ *   bridge.loop();
+ */
+class SerialBridge {
+ public:
+  /**
+   * batchSize: size of the batch buffer, it limits the size of the frames.
+   * commandSize: maximal payload of the commands.
+   */
+  SerialBridge(Stream &stream, ESPiLight &rf, size_t batchSize = 256,
+               size_t commandSize = 256);
+  ~SerialBridge();
+
+  /**
+   * Returns: false if the buffers could not be allocated
+   */
+  bool valid() const { return (_batch != nullptr) && _parser.valid(); }
+
+  /**
+   * Returns: callback for ESPiLight::setCallback() that queues a
+   * BRIDGE_MESSAGE frame
+   */
+  ESPiLightCallBack callback();
+
+  /**
+   * Returns: callback for ESPiLight::setPulseTrainCallBack() that queues
+   * a BRIDGE_PULSETRAIN frame
+   */
+  PulseTrainCallBack pulseTrainCallback();
+
+  bool queueMessage(const String &protocol, const String &message, int status,
+                    size_t repeats, const String &deviceID);
+  bool queuePulseTrain(const uint16_t *pulses, size_t length);
+
+  /**
+   * Without flow control (default: enabled), frames are written without
+   * credits, e.g. for a host that reads fast enough.
+   */
+  void setFlowControl(bool enabled) { _flowControl = enabled; }
+  uint16_t credits() const { return _credits; }
+
+  /**
+   * Execute the received commands and write the batch.
+   */
+  void loop();
+
+  /**
+   * Write the batch to the stream.
+   * Returns: number of written bytes
+   */
+  size_t flush();
+
+  const BridgeStats_t &stats() const { return _stats; }
+  void resetStats();
+
+  /**
+   * Result of an unknown or invalid command
+   */
+  static const int ERROR_INVALID_COMMAND = -100;
+
+ private:
+  uint8_t *beginFrame(uint8_t type, size_t length, bool credit);
+  void endFrame(size_t length, bool credit);
+  void execute(uint8_t type, const uint8_t *payload, size_t length);
+
+  Stream &_stream;
+  ESPiLight &_rf;
+  BridgeFrameParser _parser;
+  uint8_t *_batch;
+  size_t _batchSize;
+  size_t _used;
+  size_t _frame;  // start of the frame in construction
+  BridgeStats_t _stats;
+  uint16_t _credits;
+  bool _flowControl;
+};
+
+#endif  // _SERIALBRIDGE_H_
@@ -0,0 +1,87 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+
+#include "statestore.h"
+
+#if defined(ESP32) || defined(__linux__) || defined(__APPLE__)
+#include <stdio.h>
+#endif
+
+#if defined(ESP8266)
+bool RtcStateStore::write(const uint8_t *data, size_t length) {
+  uint32_t words[RTC_STATE_SIZE / 4];
+  if (length > capacity()) {
+    return false;
+  }
+  words[0] = length;
+  memcpy(&words[1], data, length);
+  return ESP.rtcUserMemoryWrite(_offset, words, 4 + ((length + 3) & ~3u));
+}
+
+size_t RtcStateStore::read(uint8_t *data, size_t size) {
+  uint32_t words[RTC_STATE_SIZE / 4];
+  if (!ESP.rtcUserMemoryRead(_offset, words, sizeof(words)) ||
+      (words[0] > capacity()) || (words[0] > size)) {
+    return 0;
+  }
+  memcpy(data, &words[1], words[0]);
+  return words[0];
+}
+#elif defined(ESP32)
+RTC_DATA_ATTR static uint32_t rtc_state[RTC_STATE_SIZE / 4];
+
+bool RtcStateStore::write(const uint8_t *data, size_t length) {
+  if (length > capacity()) {
+    return false;
+  }
+  rtc_state[0] = length;
+  memcpy(&rtc_state[1], data, length);
+  return true;
+}
+
+size_t RtcStateStore::read(uint8_t *data, size_t size) {
+  if ((rtc_state[0] > capacity()) || (rtc_state[0] > size)) {
+    return 0;
+  }
+  memcpy(data, &rtc_state[1], rtc_state[0]);
+  return rtc_state[0];
+}
+#endif
+
+#if defined(ESP32) || defined(__linux__) || defined(__APPLE__)
+bool FileStateStore::write(const uint8_t *data, size_t length) {
+  FILE *file = fopen(_path, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  const bool written = (fwrite(data, 1, length, file) == length);
+  return (fclose(file) == 0) && written;
+}
+
+size_t FileStateStore::read(uint8_t *data, size_t size) {
+  FILE *file = fopen(_path, "rb");
+  if (file == nullptr) {
+    return 0;
+  }
+  const size_t length = fread(data, 1, size, file);
+  fclose(file);
+  return length;
+}
+#endif
@@ -0,0 +1,103 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+
+#ifndef _STATESTORE_H_
+#define _STATESTORE_H_
+
+#include <Arduino.h>
+
+/**
+ * Byte store of a state snapshot for a warm start, see
+ * ESPiLight::saveState() and ESPiLight::restoreState(). A snapshot is
+ * only valid for the firmware image that saved it: it refers to the
+ * protocols by their registration index, and restoreState() rejects it
+ * if the fingerprint of the protocols (offsets of their registration
+ * functions, their number and ids) differs, e.g. after an OTA update.
+ */
+class StateStore {
+ public:
+  virtual ~StateStore() {}
+
+  /**
+   * Returns: maximal size of a snapshot in bytes
+   */
+  virtual size_t capacity() const = 0;
+
+  /**
+   * Returns: false if the snapshot could not be stored
+   */
+  virtual bool write(const uint8_t *data, size_t length) = 0;
+
+  /**
+   * Returns: length of the stored snapshot or 0 if there is none
+   */
+  virtual size_t read(uint8_t *data, size_t size) = 0;
+};
+
+#if defined(ESP8266) || defined(ESP32)
+// bytes of RTC memory for the snapshot, the ESP8266 has 512 bytes of user
+// RTC memory, the first 128 bytes are used by OTA updates
+#ifndef RTC_STATE_SIZE
+#define RTC_STATE_SIZE 256
+#endif
+
+/**
+ * Snapshot in the RTC memory, which keeps its content during deep sleep.
+ * The content is random (ESP8266) or cleared (ESP32) after power on,
+ * ESPiLight::restoreState() detects it by the checksum.
+ */
+class RtcStateStore : public StateStore {
+ public:
+  /**
+   * offset: of the snapshot in the user RTC memory of the ESP8266 in
+   * blocks of 4 bytes, ignored by the ESP32
+   */
+  explicit RtcStateStore(uint32_t offset = 32) : _offset(offset) {}
+
+  size_t capacity() const override { return RTC_STATE_SIZE - 4; }
+  bool write(const uint8_t *data, size_t length) override;
+  size_t read(uint8_t *data, size_t size) override;
+
+ private:
+  uint32_t _offset;
+};
+#endif
+
+#if defined(ESP32) || defined(__linux__) || defined(__APPLE__)
+/**
+ * Snapshot in a file, e.g. on the host or a mounted file system of the
+ * ESP32.
+ */
+class FileStateStore : public StateStore {
+ public:
+  explicit FileStateStore(const char *path, size_t capacity = 1024)
+      : _path(path), _capacity(capacity) {}
+
+  size_t capacity() const override { return _capacity; }
+  bool write(const uint8_t *data, size_t length) override;
+  size_t read(uint8_t *data, size_t size) override;
+
+ private:
+  const char *_path;
+  size_t _capacity;
+};
+#endif
+
+#endif  // _STATESTORE_H_
@@ -0,0 +1,79 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include "streamdecoder.h"
+
+PwmStreamDecoder::PwmStreamDecoder(const char *protocol, uint8_t bits,
+                                   uint16_t shortPulse, uint16_t longPulse,
+                                   Formatter formatter, uint8_t tolerance)
+    : _protocol(protocol),
+      _bits(bits > 64 ? 64 : bits),
+      _short(shortPulse),
+      _long(longPulse),
+      _tolerance(tolerance),
+      _formatter(formatter),
+      _value(0),
+      _count(0),
+      _first(PULSE_NONE) {}
+
+void PwmStreamDecoder::reset() {
+  _value = 0;
+  _count = 0;
+  _first = PULSE_NONE;
+}
+
+PwmStreamDecoder::PulseClass_t PwmStreamDecoder::classify(
+    uint16_t pulse) const {
+  const uint32_t shortDiff =
+      (pulse > _short) ? pulse - _short : _short - pulse;
+  if (shortDiff * 100 <= (uint32_t)_short * _tolerance) {
+    return PULSE_SHORT;
+  }
+  const uint32_t longDiff = (pulse > _long) ? pulse - _long : _long - pulse;
+  if (longDiff * 100 <= (uint32_t)_long * _tolerance) {
+    return PULSE_LONG;
+  }
+  return PULSE_NONE;
+}
+
+bool PwmStreamDecoder::feed(uint16_t pulse) {
+  const PulseClass_t pulseClass = classify(pulse);
+  if (pulseClass == PULSE_NONE) {
+    reset();
+    return false;
+  }
+  if (_first == PULSE_NONE) {
+    _first = pulseClass;
+    return false;
+  }
+  if (_first == pulseClass) {
+    // no valid pair, resynchronize with this pulse
+    reset();
+    _first = pulseClass;
+    return false;
+  }
+  _value = (_value << 1) | ((_first == PULSE_LONG) ? 1 : 0);
+  _first = PULSE_NONE;
+  if (++_count < _bits) {
+    return false;
+  }
+  const uint64_t value = _value;
+  reset();
+  return (_formatter != nullptr) && _formatter(value, _message);
+}
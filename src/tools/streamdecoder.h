@@ -0,0 +1,109 @@
+/*
+  ESPiLight - pilight 433.92 MHz protocols library for Arduino
+  Copyright (c) 2016 Puuu.  All right reserved.
+
+  Project home: https://github.com/puuu/espilight/
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with library. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef _STREAMDECODER_H_
+#define _STREAMDECODER_H_
+
+#include <Arduino.h>
+#include <functional>
+
+/**
+ * Incremental decoder, fed pulse by pulse by ESPiLight::loop() while the
+ * frame is still received (see ESPiLight::addStreamingDecoder()). If the
+ * decoder does not complete a frame, the frame is decoded by the pilight
+ * protocols as usual.
+ */
+class StreamingDecoder {
+ public:
+  StreamingDecoder() : _next(nullptr) {}
+  virtual ~StreamingDecoder() {}
+
+  /**
+   * Protocol name of the messages. If it is the id of a pilight protocol,
+   * this protocol is skipped for frames already decoded by the streaming
+   * decoder.
+   */
+  virtual const char *protocol() const = 0;
+
+  /**
+   * Start of a new frame.
+   */
+  virtual void reset() = 0;
+
+  /**
+   * Feed next pulse.
+   * Returns: true if a complete message is available by message()
+   */
+  virtual bool feed(uint16_t pulse) = 0;
+
+  /**
+   * Returns: the message (json) of the last completed frame
+   */
+  virtual const String &message() const = 0;
+
+ private:
+  friend class ESPiLightBase;
+  StreamingDecoder *_next;
+};
+
+/**
+ * Streaming decoder of pulse width modulated frames: a bit is a pair of a
+ * short and a long pulse, short-long is 0 and long-short is 1. The bits
+ * are collected most significant bit first. After bits bits, the
+ * formatter checks the value (e.g. a checksum) and writes the message.
+ */
+class PwmStreamDecoder : public StreamingDecoder {
+ public:
+  /**
+   * Returns: false if value is invalid
+   */
+  typedef std::function<bool(uint64_t value, String &message)> Formatter;
+
+  /**
+   * protocol: name of the messages, bits: number of bits (at most 64),
+   * shortPulse and longPulse: pulse widths in us, tolerance: maximal
+   * difference of a pulse width in percent
+   */
+  PwmStreamDecoder(const char *protocol, uint8_t bits, uint16_t shortPulse,
+                   uint16_t longPulse, Formatter formatter,
+                   uint8_t tolerance = 30);
+
+  const char *protocol() const override { return _protocol; }
+  void reset() override;
+  bool feed(uint16_t pulse) override;
+  const String &message() const override { return _message; }
+
+ private:
+  enum PulseClass_t { PULSE_NONE, PULSE_SHORT, PULSE_LONG };
+
+  PulseClass_t classify(uint16_t pulse) const;
+
+  const char *_protocol;
+  uint8_t _bits;
+  uint16_t _short;
+  uint16_t _long;
+  uint8_t _tolerance;
+  Formatter _formatter;
+  uint64_t _value;
+  uint8_t _count;
+  PulseClass_t _first;
+  String _message;
+};
+
+#endif  // _STREAMDECODER_H_
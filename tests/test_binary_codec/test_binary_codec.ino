@@ -0,0 +1,67 @@
+/*
+ Basic ESPiLight binary pulse train format test
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+
+#define PROTOCOL "elro_800_switch"
+#define JMESSAGE "{\"systemcode\":17,\"unitcode\":1,\"on\":1}"
+
+ESPiLight rf(-1);  // use -1 to disable transmitter
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  int length = 0;
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  uint16_t decoded[MAXPULSESTREAMLENGTH];
+  uint8_t buffer[3 * MAXPULSESTREAMLENGTH + 5];
+
+  // pulse train from pilight json message
+  length = rf.createPulseTrain(pulses, PROTOCOL, JMESSAGE);
+  String data = rf.pulseTrainToString(pulses, length);
+
+  // packed pulse types
+  size_t size = rf.pulseTrainToBinary(pulses, length, buffer, sizeof(buffer));
+  Serial.print("binary size: ");
+  Serial.print(size);
+  Serial.print(", string size: ");
+  Serial.println(data.length());
+  check("packed", buffer[1] > 0 && size < data.length());
+  int dlength = rf.binaryToPulseTrain(buffer, size, decoded,
+                                      MAXPULSESTREAMLENGTH);
+  check("packed round trip",
+        dlength == length && rf.pulseTrainToString(decoded, dlength) == data);
+  check("buffer too small",
+        rf.pulseTrainToBinary(pulses, length, buffer, size - 1) == 0);
+  dlength = rf.binaryToPulseTrain(buffer, size - 1, decoded,
+                                  MAXPULSESTREAMLENGTH);
+  check("truncated",
+        dlength == ESPiLight::ERROR_INVALID_PULSETRAIN_BIN_TRUNCATED);
+  buffer[0] = 0;
+  dlength = rf.binaryToPulseTrain(buffer, size, decoded, MAXPULSESTREAMLENGTH);
+  check("version", dlength == ESPiLight::ERROR_INVALID_PULSETRAIN_BIN_VERSION);
+
+  // too many pulse types are stored lossless
+  for (int i = 0; i < 40; i++) {
+    pulses[i] = 200 + i * 300;
+  }
+  size = rf.pulseTrainToBinary(pulses, 40, buffer, sizeof(buffer));
+  dlength = rf.binaryToPulseTrain(buffer, size, decoded, MAXPULSESTREAMLENGTH);
+  bool equal = (buffer[1] == 0) && (dlength == 40);
+  for (int i = 0; equal && i < dlength; i++) {
+    equal = (pulses[i] == decoded[i]);
+  }
+  check("varint round trip", equal);
+}
+
+void loop() {
+  // nothing
+}
@@ -0,0 +1,87 @@
+/*
+ Basic ESPiLight receiver calibration test: limitProtocols() restarts the
+ calibration with the bounds of the new protocols
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+#include <tools/calibration.h>
+
+#define PROTOCOL_A "elro_800_switch"
+#define JMESSAGE_A "{\"systemcode\":17,\"unitcode\":1,\"on\":1}"
+#define PROTOCOL_B "arctech_switch"
+#define JMESSAGE_B "{\"id\":100,\"unit\":1,\"on\":1}"
+
+ESPiLight rf(-1);  // use -1 to disable transmitter
+uint16_t frameA[MAXPULSESTREAMLENGTH];
+uint16_t frameB[MAXPULSESTREAMLENGTH];
+int lengthA;
+int lengthB;
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+void callback(const String &protocol, const String &message, int status,
+              size_t repeats, const String &deviceID) {}
+
+void parse(const uint16_t *frame, int length, int count) {
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  for (int i = 0; i < count; i++) {
+    memcpy(pulses, frame, length * sizeof(uint16_t));
+    rf.parsePulseTrain(pulses, (uint8_t)length);
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  lengthA = rf.createPulseTrain(frameA, PROTOCOL_A, JMESSAGE_A);
+  lengthB = rf.createPulseTrain(frameB, PROTOCOL_B, JMESSAGE_B);
+  rf.setCallback(callback);
+
+  // bounds of the protocols without calibration
+  ESPiLight::limitProtocols("[\"" PROTOCOL_A "\",\"" PROTOCOL_B "\"]");
+  const uint16_t minBoth = ESPiLight::minpulselen;
+  const uint16_t maxBoth = ESPiLight::maxpulselen;
+  ESPiLight::limitProtocols("[\"" PROTOCOL_A "\"]");
+  const uint16_t minA = ESPiLight::minpulselen;
+  const uint16_t maxA = ESPiLight::maxpulselen;
+
+  ESPiLight::setCalibrationEnabled(true, true);
+  parse(frameA, lengthA, 2 * PulseCalibration::CALIBRATION_MIN_FRAMES);
+  const uint16_t narrowed = ESPiLight::minpulselen;
+  check("narrowed", (narrowed > minA) && (ESPiLight::maxpulselen <= maxA));
+
+  // the new protocols reset the bounds and the calibration
+  ESPiLight::limitProtocols("[\"" PROTOCOL_A "\",\"" PROTOCOL_B "\"]");
+  check("reset bounds", (ESPiLight::minpulselen == minBoth) &&
+                            (ESPiLight::maxpulselen == maxBoth));
+  parse(frameA, lengthA, 1);
+  const PulseCalibration *calibration = ESPiLight::getCalibration();
+  check("restarted", (calibration->decoded() == 1) &&
+                         (ESPiLight::minpulselen == minBoth) &&
+                         (ESPiLight::maxpulselen == maxBoth));
+
+  // room for the protocol that was not decoded yet
+  parse(frameA, lengthA, 2 * PulseCalibration::CALIBRATION_MIN_FRAMES);
+  const uint16_t unseen = ESPiLight::minpulselen;
+  check("unseen room", (unseen >= minBoth) && (unseen < narrowed) &&
+                           (ESPiLight::maxpulselen >= ESPiLight::maxgaplen));
+
+  // both protocols decoded
+  for (unsigned int i = 0; i < 2 * PulseCalibration::CALIBRATION_MIN_FRAMES;
+       i++) {
+    parse(frameA, lengthA, 1);
+    parse(frameB, lengthB, 1);
+  }
+  check("seen", (ESPiLight::minpulselen > unseen) && !calibration->reverted());
+
+  ESPiLight::setCalibrationEnabled(false);
+}
+
+void loop() {
+  // nothing
+}
@@ -0,0 +1,65 @@
+/*
+ Basic ESPiLight deferred logging test: messages above the log level are
+ discarded, recorded messages are written by loop()
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+#include <pilight/libs/pilight/core/log.h>
+
+ESPiLight rf(-1);  // use -1 to disable transmitter
+
+class CapturePrint : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    text += (char)c;
+    return 1;
+  }
+  using Print::write;
+
+  String text;
+};
+
+CapturePrint capture;
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+bool captured(const char *text) {
+  return strstr(capture.text.c_str(), text) != nullptr;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  ESPiLight::setErrorOutput(capture);
+  ESPiLight::setLogLevel(LOG_ERR);
+
+  // synchronous output
+  alog_P(LOG_ERR, PSTR("written %d"), 1);
+  alog_P(LOG_DEBUG, PSTR("filtered %d"), 2);
+  check("written", captured("written 1"));
+  check("filtered", !captured("filtered"));
+
+  // deferred output
+  capture.text = "";
+  check("buffer", ESPiLight::setDeferredLogging(256));
+  alog_P(LOG_ERR, PSTR("queued %d %s"), 3, "text");
+  alog_P(LOG_DEBUG, PSTR("filtered %d"), 4);
+  check("deferred", capture.text.length() == 0);
+  rf.loop();
+  check("flushed", captured("queued 3 text") && !captured("filtered"));
+  capture.text = "";
+  check("empty", (ESPiLight::flushLog() == 0) && (capture.text.length() == 0));
+
+  ESPiLight::setDeferredLogging(0);
+  ESPiLight::setLogLevel(LOG_DEBUG);
+  ESPiLight::setErrorOutput(Serial);
+}
+
+void loop() {
+  // nothing
+}
@@ -0,0 +1,87 @@
+/*
+ Basic ESPiLight device state table test
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+#include <tools/devicestate.h>
+
+#define PROTOCOL "arctech_switch"
+#define JMESSAGE_ON "{\"id\":100,\"unit\":1,\"state\":\"on\"}"
+#define JMESSAGE_OFF "{\"id\":100,\"unit\":1,\"state\":\"off\"}"
+#define JMESSAGE_UNIT2 "{\"id\":100,\"unit\":2,\"state\":\"on\"}"
+
+ESPiLight rf(-1);  // use -1 to disable transmitter
+DeviceStateTable states(2);
+int published = 0;
+DeviceStateReason_t lastReason;
+
+// callback function. It is called if the state of a device changed
+void stateCallback(const String &protocol, const String &device,
+                   const String &message, DeviceStateReason_t reason) {
+  Serial.print("state [");
+  Serial.print(protocol);
+  Serial.print("][");
+  Serial.print(device);
+  Serial.print("] (");
+  Serial.print(reason);
+  Serial.print(") ");
+  Serial.println(message);
+  published++;
+  lastReason = reason;
+}
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+void setup() {
+  Serial.begin(115200);
+  states.setCallback(stateCallback);
+
+  check("device", DeviceStateTable::deviceOf(JMESSAGE_ON) ==
+                      "{\"id\":100,\"unit\":1}");
+  check("new", states.update(PROTOCOL, JMESSAGE_ON) &&
+                   (lastReason == DEVICE_NEW));
+  check("repeat", !states.update(PROTOCOL, JMESSAGE_ON) && (published == 1));
+  check("changed", states.update(PROTOCOL, JMESSAGE_OFF) &&
+                       (lastReason == DEVICE_CHANGED));
+  check("second device", states.update(PROTOCOL, JMESSAGE_UNIT2) &&
+                             (states.size() == 2));
+  check("find", strcmp(states.find(PROTOCOL, "{\"unit\":1,\"id\":100}"),
+                       JMESSAGE_OFF) == 0);
+  check("find unknown",
+        states.find(PROTOCOL, "{\"id\":100,\"unit\":3}") == nullptr);
+
+  states.setHeartbeat(10);
+  delay(20);
+  check("heartbeat", states.update(PROTOCOL, JMESSAGE_OFF) &&
+                         (lastReason == DEVICE_HEARTBEAT));
+
+  // decoded messages
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  int length = rf.createPulseTrain(
+      pulses, "elro_800_switch", "{\"systemcode\":17,\"unitcode\":1,\"on\":1}");
+  rf.setCallback(states.callback());
+  published = 0;
+  for (int i = 0; i < 5; i++) {
+    rf.parsePulseTrain(pulses, length);
+  }
+  check("decoded", published == 1);
+  states.forEach([](const char *protocol, const char *device,
+                    const char *message, unsigned long lastSeen) {
+    Serial.print(protocol);
+    Serial.print(' ');
+    Serial.print(device);
+    Serial.print(' ');
+    Serial.print(message);
+    Serial.print(' ');
+    Serial.println(lastSeen);
+  });
+}
+
+void loop() {
+  // nothing
+}
@@ -0,0 +1,106 @@
+/*
+ Basic ESPiLight event ring test
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+#include <tools/eventring.h>
+
+#define PROTOCOL "elro_800_switch"
+#define JMESSAGE "{\"systemcode\":17,\"unitcode\":1,\"on\":1}"
+
+// 4 slots, payload for 3 messages of 9 characters
+StaticEventRing<4, 30> events;
+StaticEventRing<4, 256> decoded;
+ESPiLight rf(-1);  // use -1 to disable transmitter
+int callbacks = 0;
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+bool push(const char *message, uint8_t repeats = 1) {
+  ESPiLightEvent_t event;
+  event.time = 0;
+  event.deviceId = EVENT_NO_DEVICE_ID;
+  event.protocol = 0;
+  event.status = 0;
+  event.repeats = repeats;
+  return events.push(event, message);
+}
+
+void callback(const String &protocol, const String &message, int status,
+              size_t repeats, const String &deviceID) {
+  callbacks++;
+}
+
+// Returns: message of the polled event or "" if the ring is empty
+String poll(ESPiLightEvent_t &event) {
+  if (!events.poll(event)) {
+    return String();
+  }
+  return String(events.payload(event));
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  ESPiLightEvent_t a;
+  ESPiLightEvent_t b;
+  ESPiLightEvent_t c;
+  ESPiLightEvent_t d;
+
+  check("push", push("message_a", 1) && push("message_b", 2));
+  check("available", events.available() == 2);
+  check("fifo", (poll(a) == "message_a") && (a.repeats == 1) &&
+                    (a.length == 9) && (a.offset == 0));
+
+  // the payload of the polled event is held until the next poll()
+  check("end of payload", push("message_c"));
+  check("held dropped", !push("message_d"));
+  check("held payload", strcmp(events.payload(a), "message_a") == 0);
+  check("second", (poll(b) == "message_b") && (b.repeats == 2));
+  check("third", (poll(c) == "message_c") && (c.offset == 20));
+
+  // message_b is released, message_c still held
+  check("wrap around", push("message_d"));
+  check("wrapped held payload", strcmp(events.payload(c), "message_c") == 0);
+  check("wrapped", (poll(d) == "message_d") && (d.offset == 0));
+  check("empty", (poll(d) == "") && (events.available() == 0));
+
+  // after the ring ran empty, the payload starts again at 0
+  check("restart", push("message_e") && (poll(a) == "message_e") &&
+                       (a.offset == 0));
+
+  // slots and payload limit
+  events.clear();
+  events.resetStats();
+  check("slots", push("1") && push("2") && push("3") && push("4"));
+  check("slots full", !push("5"));
+  events.clear();
+  check("payload too long", !push("this message is longer than the payload"));
+  const EventRingStats_t &stats = events.stats();
+  check("stats", (stats.pushed == 4) && (stats.dropped == 2) &&
+                     (stats.highWater == 4));
+  events.resetStats();
+  check("reset stats", (stats.pushed == 0) && (stats.dropped == 0) &&
+                           (stats.highWater == 0));
+
+  // ESPiLight queues the decoded messages and still fires the callback
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  const int length = rf.createPulseTrain(pulses, PROTOCOL, JMESSAGE);
+  rf.setCallback(callback);
+  rf.setEventRing(&decoded);
+  rf.parsePulseTrain(pulses, (uint8_t)length);
+  check("queued and callback",
+        (decoded.available() > 0) && (callbacks == decoded.available()));
+  check("protocol",
+        decoded.poll(a) &&
+            (strcmp(ESPiLight::protocolName(a.protocol), PROTOCOL) == 0));
+}
+
+void loop() {
+  // nothing
+}
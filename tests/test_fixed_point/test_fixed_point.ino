@@ -0,0 +1,85 @@
+/*
+ Basic ESPiLight fixed point test
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+#include <tools/fixedpoint.h>
+
+#include <stdio.h>
+
+struct Case {
+  double number;
+  int decimals;
+  const char *expected;  // of snprintf("%.*f")
+};
+
+// ties are decided on the binary value, not on the decimal literal
+const Case cases[] = {
+    {1.115, 2, "1.11"},      {-1.115, 2, "-1.11"},
+    {-0.0, 2, "-0.00"},      {0.125, 2, "0.12"},
+    {0.375, 2, "0.38"},      {2.5, 0, "2"},
+    {-2.5, 0, "-2"},         {3.5, 0, "4"},
+    {-0.001, 2, "-0.00"},    {21.5, 1, "21.5"},
+    {1e-300, 3, "0.000"},    {-273.15, 1, "-273.1"},
+    {0.5, 0, "0"},           {1.0000000005, 9, "1.000000001"},
+    {9.2e18, 0, "9200000000000000000"},
+};
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  char buffer[64];
+  bool equal = true;
+  for (const Case &c : cases) {
+    json_format_number(buffer, c.number, c.decimals);
+    if (strcmp(buffer, c.expected) != 0) {
+      Serial.print(c.expected);
+      Serial.print(" != ");
+      Serial.println(buffer);
+      equal = false;
+    }
+  }
+  check("format", equal);
+
+#ifndef ESP8266
+  // snprintf formats floats everywhere but on ESP8266
+  char expected[64];
+  equal = true;
+  for (int i = -20000; i <= 20000; i += 7) {
+    const double number = i / 1000.0 + i / 8.0;
+    for (int decimals = 0; decimals <= FIXED_MAX_DECIMALS; decimals++) {
+      snprintf(expected, sizeof(expected), "%.*f", decimals, number);
+      json_format_number(buffer, number, decimals);
+      equal = equal && (strcmp(buffer, expected) == 0);
+    }
+  }
+  check("snprintf", equal);
+#endif
+
+  FixedPoint_t number;
+  check("parse", (parseFixedPoint("-21.50", number) != nullptr) &&
+                     (number.value == -2150) && (number.decimals == 2));
+  formatFixedPoint(buffer, sizeof(buffer), number);
+  check("round trip", strcmp(buffer, "-21.50") == 0);
+  check("find", findFixedPoint("{\"id\":1,\"temperature\":-3.5}",
+                               "temperature", number) &&
+                    (number.value == -35) && (number.decimals == 1));
+
+  // like round() of the device id
+  const FixedPoint_t halves[] = {{25, 1}, {-25, 1}, {249, 2}, {-7, 0}};
+  check("round", (roundFixedPoint(halves[0]) == 3) &&
+                     (roundFixedPoint(halves[1]) == -3) &&
+                     (roundFixedPoint(halves[2]) == 2) &&
+                     (roundFixedPoint(halves[3]) == -7));
+}
+
+void loop() {
+  // nothing
+}
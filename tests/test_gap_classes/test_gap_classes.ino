@@ -0,0 +1,132 @@
+/*
+ Basic ESPiLight gap class test: a protocol with a long footer and a pulse
+ longer than the footer of the other protocols is received
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+
+extern "C" {
+#include <pilight/libs/pilight/protocols/protocol.h>
+}
+
+#define SHORT_LENGTH 50  // 24 bits of 300/900 us pulses and a footer
+#define SHORT_GAP 5000
+#define LONG_LENGTH 36  // 16 bits of 1000/2000 us pulses, 8 ms, footer
+#define LONG_INNER 8000
+#define LONG_GAP 30000
+
+ESPiLight rf(-1);  // use -1 to disable transmitter
+protocol_t *gapShort;
+protocol_t *gapLong;
+unsigned long now = 100000;
+String decoded;
+int count;
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+int validateShort() {
+  return ((gapShort->rawlen == SHORT_LENGTH) &&
+          (gapShort->raw[SHORT_LENGTH - 1] > SHORT_GAP))
+             ? 0
+             : -1;
+}
+
+int validateLong() {
+  return ((gapLong->rawlen == LONG_LENGTH) &&
+          (gapLong->raw[LONG_LENGTH - 2] == LONG_INNER) &&
+          (gapLong->raw[LONG_LENGTH - 1] > LONG_GAP))
+             ? 0
+             : -1;
+}
+
+void parseShort() { gapShort->message = json_mkobject(); }
+
+void parseLong() { gapLong->message = json_mkobject(); }
+
+// test protocols with known footers, the protocols of pilight may change
+protocol_t *add(const char *id, uint8_t length, uint16_t mingaplen,
+                uint16_t maxgaplen, int (*validate)(void),
+                void (*parseCode)(void)) {
+  protocol_t *protocol;
+  protocol_register(&protocol);
+  protocol_set_id(protocol, (char *)id);
+  protocol->minrawlen = length;
+  protocol->maxrawlen = length;
+  protocol->mingaplen = mingaplen;
+  protocol->maxgaplen = maxgaplen;
+  protocol->validate = validate;
+  protocol->parseCode = parseCode;
+  return protocol;
+}
+
+void callback(const String &protocol, const String &message, int status,
+              size_t repeats, const String &deviceID) {
+  decoded = protocol;
+  count++;
+}
+
+void receive(const uint16_t *pulses, int length) {
+  // a gap between the frames
+  now += 1000000;
+  ESPiLight::handleEdge(now);
+  for (int i = 0; i < length; i++) {
+    now += pulses[i];
+    ESPiLight::handleEdge(now);
+  }
+  decoded = "";
+  count = 0;
+  rf.loop();
+  rf.loop();
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  gapShort = add("gap_short", SHORT_LENGTH, SHORT_GAP, 12000, validateShort,
+                 parseShort);
+  gapLong = add("gap_long", LONG_LENGTH, LONG_GAP, 45000, validateLong,
+                parseLong);
+  rf.setCallback(callback);
+  ESPiLight::limitProtocols("[\"gap_short\",\"gap_long\"]");
+  ESPiLight::enableReceiver();
+
+  GapClass_t classes[MAX_GAP_CLASSES];
+  const uint8_t nrclasses =
+      ESPiLight::getGapClasses(classes, MAX_GAP_CLASSES);
+  check("classes", (nrclasses == 2) && (classes[0].mingaplen == SHORT_GAP) &&
+                       (classes[1].mingaplen == LONG_GAP));
+
+  uint16_t shortFrame[SHORT_LENGTH];
+  for (int i = 0; i < SHORT_LENGTH - 2; i++) {
+    shortFrame[i] = ((i % 4) < 2) ? 300 : 900;
+  }
+  shortFrame[SHORT_LENGTH - 2] = 300;
+  shortFrame[SHORT_LENGTH - 1] = 10000;
+  receive(shortFrame, SHORT_LENGTH);
+  check("class 0", (count == 1) && (decoded == "gap_short"));
+
+  // the inner pulse ends the frame of class 0, not of class 1
+  uint16_t longFrame[LONG_LENGTH];
+  for (int i = 0; i < LONG_LENGTH - 2; i++) {
+    longFrame[i] = ((i % 4) < 2) ? 1000 : 2000;
+  }
+  longFrame[LONG_LENGTH - 2] = LONG_INNER;
+  longFrame[LONG_LENGTH - 1] = 35000;
+  receive(longFrame, LONG_LENGTH);
+  check("inner pulse", (count == 1) && (decoded == "gap_long"));
+
+  // both in a row
+  receive(shortFrame, SHORT_LENGTH);
+  const bool first = (count == 1) && (decoded == "gap_short");
+  receive(longFrame, LONG_LENGTH);
+  check("in a row", first && (count == 1) && (decoded == "gap_long"));
+}
+
+void loop() {
+  // nothing
+}
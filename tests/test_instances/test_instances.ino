@@ -0,0 +1,63 @@
+/*
+ Basic ESPiLight instance test: decode and encode through two instances do
+ not share the repeat detection
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+
+#define PROTOCOL "elro_800_switch"
+#define JMESSAGE "{\"systemcode\":17,\"unitcode\":1,\"on\":1}"
+#define JMESSAGE2 "{\"systemcode\":17,\"unitcode\":2,\"on\":1}"
+
+ESPiLight first(-1);  // use -1 to disable transmitter
+ESPiLight second(-1);
+int firstStatus;
+int secondStatus;
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+void firstCallback(const String &protocol, const String &message, int status,
+                   size_t repeats, const String &deviceID) {
+  firstStatus = status;
+}
+
+void secondCallback(const String &protocol, const String &message,
+                    int status, size_t repeats, const String &deviceID) {
+  secondStatus = status;
+}
+
+int parse(ESPiLight &rf, const uint16_t *frame, int length, int &status) {
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  memcpy(pulses, frame, length * sizeof(uint16_t));
+  status = -1;
+  rf.parsePulseTrain(pulses, (uint8_t)length);
+  return status;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  uint16_t frame[MAXPULSESTREAMLENGTH];
+  uint16_t other[MAXPULSESTREAMLENGTH];
+  const int length = first.createPulseTrain(frame, PROTOCOL, JMESSAGE);
+  first.setCallback(firstCallback);
+  second.setCallback(secondCallback);
+
+  check("first", parse(first, frame, length, firstStatus) == FIRST);
+  check("own repeats", parse(second, frame, length, secondStatus) == FIRST);
+  check("repeat", parse(first, frame, length, firstStatus) == VALID);
+
+  // an encode of the second instance in between
+  check("encode", second.createPulseTrain(other, PROTOCOL, JMESSAGE2) > 0);
+  check("second repeat", parse(second, frame, length, secondStatus) == VALID);
+  check("known", parse(first, frame, length, firstStatus) == KNOWN);
+}
+
+void loop() {
+  // nothing
+}
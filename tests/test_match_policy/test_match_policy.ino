@@ -0,0 +1,104 @@
+/*
+ Basic ESPiLight match policy test: two protocols decode the same pulse
+ train
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+
+#define PROTOCOL_A "arctech_switch"
+#define PROTOCOL_B "arctech_screen"
+#define JMESSAGE "{\"id\":100,\"unit\":1,\"on\":1}"
+
+ESPiLight rf(-1);  // use -1 to disable transmitter
+uint16_t frame[MAXPULSESTREAMLENGTH];
+int length;
+int count;
+String reported;
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+void callback(const String &protocol, const String &message, int status,
+              size_t repeats, const String &deviceID) {
+  count++;
+  reported = protocol;
+}
+
+// Returns: number of callbacks
+int parse() {
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  memcpy(pulses, frame, length * sizeof(uint16_t));
+  count = 0;
+  reported = "";
+  rf.parsePulseTrain(pulses, (uint8_t)length);
+  return count;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  MatchStats_t stats;
+  length = rf.createPulseTrain(frame, PROTOCOL_A, JMESSAGE);
+  rf.setCallback(callback);
+
+  // the protocol tried first wins, the other one is second
+  rf.setMatchPolicy(MATCH_FIRST);
+  parse();
+  const String first = reported;
+  const String second = (first == PROTOCOL_A) ? PROTOCOL_B : PROTOCOL_A;
+  check("first", (first == PROTOCOL_A) || (first == PROTOCOL_B));
+
+  // adaptive order: the protocol with more matches than first is tried
+  // first, the registered protocols keep their order
+  const String available = ESPiLight::availableProtocols();
+  rf.setAdaptiveOrderEnabled(true);
+  rf.setMatchPolicy(MATCH_PRIORITY);
+  ESPiLight::setProtocolPriority(second, 1);
+  parse();
+  parse();
+  rf.setMatchPolicy(MATCH_FIRST);
+  check("adaptive order", (parse() == 1) && (reported == second));
+  check("registered order", ESPiLight::availableProtocols() == available);
+  rf.setAdaptiveOrderEnabled(false);
+  ESPiLight::setProtocolPriority(second, 0);
+
+  // only the pair of protocols, in the order of limitProtocols()
+  ESPiLight::limitProtocols("[\"" PROTOCOL_A "\",\"" PROTOCOL_B "\"]");
+  parse();
+  const String tried = reported;
+  const String other = (tried == PROTOCOL_A) ? PROTOCOL_B : PROTOCOL_A;
+  ESPiLight::getMatchStats(stats, true);
+
+  rf.setMatchPolicy(MATCH_ALL);
+  check("all", parse() == 2);
+  ESPiLight::getMatchStats(stats, true);
+  check("all stats", (stats.frames == 1) && (stats.matched == 1) &&
+                         (stats.conflicts == 1) && (stats.suppressed == 0));
+
+  rf.setMatchPolicy(MATCH_FIRST);
+  check("match first", (parse() == 1) && (reported == tried));
+  ESPiLight::getMatchStats(stats, true);
+  check("first stats", (stats.frames == 1) && (stats.matched == 1) &&
+                           (stats.conflicts == 0) && (stats.suppressed == 0));
+
+  rf.setMatchPolicy(MATCH_PRIORITY);
+  check("equal priority", (parse() == 1) && (reported == tried));
+  ESPiLight::setProtocolPriority(other, 1);
+  check("higher priority", (parse() == 1) && (reported == other));
+  ESPiLight::setProtocolPriority(other, -1);
+  check("lower priority", (parse() == 1) && (reported == tried));
+  ESPiLight::getMatchStats(stats, true);
+  check("priority stats", (stats.frames == 3) && (stats.matched == 3) &&
+                              (stats.conflicts == 3) &&
+                              (stats.suppressed == 3));
+  check("unknown priority",
+        !ESPiLight::setProtocolPriority("unknown_protocol", 1));
+}
+
+void loop() {
+  // nothing
+}
@@ -0,0 +1,82 @@
+/*
+ Basic ESPiLight pulse clustering test
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+// every pulse within percent of its type
+bool withinPercent(const uint16_t *pulses, size_t length,
+                   const uint16_t *types, const uint8_t *indices,
+                   unsigned long percent) {
+  for (size_t i = 0; i < length; i++) {
+    const unsigned long type = types[indices[i]];
+    const unsigned long diff =
+        (type > pulses[i]) ? type - pulses[i] : pulses[i] - type;
+    if (diff * 100 > pulses[i] * percent) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  uint16_t types[MAX_PULSE_TYPES];
+  uint8_t indices[MAXPULSESTREAMLENGTH];
+  uint8_t nrtypes;
+
+  // jitter of two pulse widths and a footer
+  const uint16_t jitter[] = {290, 910, 310, 880, 930, 300, 870, 295, 10200};
+  const size_t jitterLength = sizeof(jitter) / sizeof(jitter[0]);
+  memcpy(pulses, jitter, sizeof(jitter));
+  nrtypes = ESPiLight::normalizePulseTrain(pulses, jitterLength, types,
+                                           indices, true);
+  check("jitter types", nrtypes == 3);
+  check("jitter order", (indices[0] == 0) && (indices[1] == 1) &&
+                            (indices[4] == 1) && (indices[8] == 2));
+  check("jitter close",
+        withinPercent(jitter, jitterLength, types, indices, 5));
+  check("rewrite", (pulses[0] == types[0]) && (pulses[3] == types[1]) &&
+                       (pulses[8] == types[2]));
+
+  // a constant pulse train with a scratch buffer gives the same types
+  uint16_t constTypes[MAX_PULSE_TYPES];
+  uint8_t constIndices[MAXPULSESTREAMLENGTH];
+  uint16_t sorted[MAXPULSESTREAMLENGTH];
+  check("constant",
+        (ESPiLight::normalizePulseTrain(jitter, jitterLength, constTypes,
+                                        constIndices, sorted) == nrtypes) &&
+            (memcmp(constTypes, types, nrtypes * sizeof(uint16_t)) == 0) &&
+            (memcmp(constIndices, indices, jitterLength) == 0));
+
+  // 20 widths 30% apart are more than the pulse types: the closest
+  // neighbours are merged, also of the widest pulses
+  uint16_t spread[40];
+  unsigned long width = 100;
+  for (size_t i = 0; i < 20; i++) {
+    spread[2 * i] = (uint16_t)width;
+    spread[2 * i + 1] = (uint16_t)width;
+    width = width * 13 / 10;
+  }
+  memcpy(pulses, spread, sizeof(spread));
+  nrtypes = ESPiLight::normalizePulseTrain(pulses, 40, types, indices);
+  check("spread types", nrtypes == MAX_PULSE_TYPES - 1);
+  check("spread close", withinPercent(spread, 40, types, indices, 20));
+  check("spread widest", types[indices[39]] == spread[39]);
+
+  check("empty", ESPiLight::normalizePulseTrain(pulses, 0, types,
+                                                indices) == 0);
+}
+
+void loop() {
+  // nothing
+}
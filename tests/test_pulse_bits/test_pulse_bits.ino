@@ -0,0 +1,110 @@
+/*
+ Basic ESPiLight shared pulse bit vector test
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+
+extern "C" {
+#include <pilight/libs/pilight/core/binary.h>
+#include <pilight/libs/pilight/protocols/protocol.h>
+}
+
+#define BITS 24
+#define LENGTH (2 + 2 * BITS + 1)
+
+const unsigned long value = 0xA5C3F1;
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+// sync pulse, BITS of value as long-short (1) or short-long (0) pairs and
+// a footer
+void frame(uint16_t *pulses, uint16_t sync) {
+  pulses[0] = 300;
+  pulses[1] = sync;
+  for (int i = 0; i < BITS; i++) {
+    const bool bit = (value >> (BITS - 1 - i)) & 1;
+    pulses[2 + 2 * i] = bit ? 900 : 300;
+    pulses[3 + 2 * i] = bit ? 300 : 900;
+  }
+  pulses[LENGTH - 1] = 10200;
+}
+
+// pulse_bits_to_dec*() and binToDec*() agree for all spans
+bool sameAsBinary(const pulse_bits_t *bits) {
+  int binary[LENGTH];
+  for (int i = 0; i < LENGTH; i++) {
+    binary[i] = (bits->pulses[i / 32] >> (i % 32)) & 1;
+  }
+  for (int s = 0; s < LENGTH; s++) {
+    for (int e = s; (e < LENGTH) && (e - s < 31); e++) {
+      if ((pulse_bits_to_dec(bits->pulses, s, e) !=
+           (unsigned long)binToDec(binary, s, e)) ||
+          (pulse_bits_to_dec_rev(bits->pulses, s, e) !=
+           (unsigned long)binToDecRev(binary, s, e))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  uint16_t pulses[LENGTH];
+  uint16_t other[LENGTH];
+  const pulse_bits_t *bits;
+
+  // the sync pulse is long, but does not move the threshold above the
+  // long pulses of the data
+  frame(pulses, 2700);
+  protocol_pulse_bits_reset();
+  bits = protocol_pulse_bits(pulses, LENGTH);
+  check("threshold", (bits->threshold > 300) && (bits->threshold < 900));
+  check("sync", ((bits->pulses[0] & 3) == 2));
+  check("footer", (bits->pulses[(LENGTH - 1) / 32] >>
+                   ((LENGTH - 1) % 32)) & 1);
+  check("value", pulse_bits_to_dec_rev(bits->pairBits, 1, BITS) == value);
+  check("pair errors", (bits->length == LENGTH) &&
+                           (bits->pairs == LENGTH / 2) &&
+                           (bits->pairErrors == 0));
+  check("binToDec", sameAsBinary(bits));
+
+  // cached for the same raw until the next frame
+  pulses[2] = 300;
+  const uint32_t first = bits->pulses[0];
+  check("cached", protocol_pulse_bits(pulses, LENGTH)->pulses[0] == first);
+  frame(other, 2700);
+  other[2] = 300;
+  check("other raw", (protocol_pulse_bits(other, LENGTH)->pairErrors == 1));
+  frame(pulses, 2700);
+  protocol_pulse_bits_reset();
+  check("reset", protocol_pulse_bits(pulses, LENGTH)->pairErrors == 0);
+
+  // a sync pulse close to the long pulses
+  frame(pulses, 1300);
+  protocol_pulse_bits_reset();
+  bits = protocol_pulse_bits(pulses, LENGTH);
+  check("short sync",
+        pulse_bits_to_dec_rev(bits->pairBits, 1, BITS) == value);
+
+  // without two pulse widths, all pulses are short
+  for (int i = 0; i < LENGTH; i++) {
+    pulses[i] = (i & 1) ? 310 : 290;
+  }
+  protocol_pulse_bits_reset();
+  bits = protocol_pulse_bits(pulses, LENGTH);
+  check("single width", (bits->pulses[0] == 0) &&
+                            (bits->pairErrors == LENGTH / 2));
+
+  check("empty", protocol_pulse_bits(pulses, 0)->length == 0);
+}
+
+void loop() {
+  // nothing
+}
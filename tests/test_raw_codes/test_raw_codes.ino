@@ -0,0 +1,123 @@
+/*
+ Basic ESPiLight raw code index test
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+#include <tools/rawcodes.h>
+
+#define CODES 6
+#define LENGTH 26
+
+const char *const labels[CODES] = {"code0", "code1", "code2",
+                                   "code3", "code4", "code5"};
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+// 12 bits of value as short-long (0) or long-short (1) pairs and a footer,
+// every pulse is off by jitter percent, alternating up and down
+void code(uint16_t *pulses, unsigned int value, int jitter = 0) {
+  for (int i = 0; i < 12; i++) {
+    const bool bit = (value >> (11 - i)) & 1;
+    pulses[2 * i] = bit ? 900 : 300;
+    pulses[2 * i + 1] = bit ? 300 : 900;
+  }
+  pulses[24] = 300;
+  pulses[25] = 9000;
+  for (int i = 0; i < LENGTH; i++) {
+    const int delta = pulses[i] * jitter / 100;
+    pulses[i] += (i & 1) ? delta : -delta;
+  }
+}
+
+// Returns: true if all learned codes except forgotten are found
+bool matchAll(RawCodeIndex &codes, unsigned int forgotten) {
+  uint16_t pulses[LENGTH];
+  for (unsigned int i = 0; i < CODES; i++) {
+    code(pulses, 0x5A0 + i);
+    const char *label = codes.match(pulses, LENGTH);
+    const bool known = (label != nullptr) && (strcmp(label, labels[i]) == 0);
+    if (known != ((forgotten & (1 << i)) == 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  uint16_t pulses[LENGTH];
+  uint16_t sent[MAXPULSESTREAMLENGTH];
+  RawCodeIndex codes(CODES);  // 8 slots, the codes form clusters
+
+  bool learned = true;
+  for (unsigned int i = 0; i < CODES; i++) {
+    code(pulses, 0x5A0 + i);
+    learned &= codes.learn(pulses, LENGTH, labels[i]);
+  }
+  check("learn", learned && (codes.size() == CODES));
+  code(pulses, 0x123);
+  check("full", !codes.learn(pulses, LENGTH, "other"));
+  check("match all", matchAll(codes, 0));
+
+  // the normalized code, e.g. for send()
+  const int length = codes.pulseTrain("code2", sent, MAXPULSESTREAMLENGTH);
+  check("pulse train", (length == LENGTH) && (sent[0] == 300) &&
+                           (sent[1] == 900) && (sent[LENGTH - 1] == 9000));
+  check("unknown pulse train",
+        codes.pulseTrain("other", sent, MAXPULSESTREAMLENGTH) == 0);
+
+  // jitter within the tolerance of 20%
+  String matched;
+  codes.setCallback([&matched](const String &label, const uint16_t *pulses,
+                               size_t length) { matched = label; });
+  code(pulses, 0x5A3, 10);
+  check("jitter", (codes.match(pulses, LENGTH) != nullptr) &&
+                      (matched == "code3"));
+  // a 30% slower remote
+  code(pulses, 0x5A3);
+  for (int i = 0; i < LENGTH; i++) {
+    pulses[i] = pulses[i] * 13 / 10;
+  }
+  check("beyond tolerance", codes.match(pulses, LENGTH) == nullptr);
+  codes.setTolerance(40);
+  check("tolerance", codes.match(pulses, LENGTH) != nullptr);
+  codes.setTolerance(20);
+  code(pulses, 0x123);
+  check("unknown", codes.match(pulses, LENGTH) == nullptr);
+
+  // a known code gets the new label
+  code(pulses, 0x5A1, 5);
+  check("relabel", codes.learn(pulses, LENGTH, "renamed") &&
+                       (codes.size() == CODES) &&
+                       (strcmp(codes.match(pulses, LENGTH), "renamed") == 0));
+  check("forget relabeled", codes.forget("renamed") == 1);
+  code(pulses, 0x5A1);
+  check("learn again", codes.learn(pulses, LENGTH, labels[1]));
+
+  // the rest of a cluster is reinserted, every code stays reachable
+  unsigned int forgotten = 0;
+  bool reachable = true;
+  for (unsigned int i = 0; i < CODES; i += 2) {
+    reachable &= (codes.forget(labels[i]) == 1);
+    forgotten |= 1 << i;
+    reachable &= matchAll(codes, forgotten);
+  }
+  check("forget", reachable && (codes.size() == CODES / 2));
+  check("forget unknown", codes.forget("code0") == 0);
+  for (unsigned int i = 1; i < CODES; i += 2) {
+    reachable &= (codes.forget(labels[i]) == 1);
+    forgotten |= 1 << i;
+    reachable &= matchAll(codes, forgotten);
+  }
+  check("forget all", reachable && (codes.size() == 0));
+}
+
+void loop() {
+  // nothing
+}
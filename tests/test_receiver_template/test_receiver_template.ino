@@ -0,0 +1,89 @@
+/*
+ Basic ESPiLight receiver template test
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+
+class ESPiLight;  // can be forward declared, it is not a typedef
+
+#define PROTOCOL "elro_800_switch"
+#define JMESSAGE "{\"systemcode\":17,\"unitcode\":1,\"on\":1}"
+
+typedef ESPiLightT<2, 100> SmallReceiver;  // 2 slots of 100 pulses
+typedef ESPiLightT<2, 32> TinyReceiver;    // too short for the frames
+
+SmallReceiver rf(-1);  // use -1 to disable transmitter
+unsigned long now = 100000;
+String received;
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+template <typename Receiver>
+EdgeStatus_t feed(const uint16_t *pulses, int length) {
+  EdgeStatus_t status = EDGE_IGNORED;
+  for (int i = 0; i < length; i++) {
+    now += pulses[i];
+    status = Receiver::handleEdge(now);
+  }
+  return status;
+}
+
+void callback(const String &protocol, const String &message, int status,
+              size_t repeats, const String &deviceID) {
+  received = message;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  uint16_t queued[100];
+  const int length = rf.createPulseTrain(pulses, PROTOCOL, JMESSAGE);
+  rf.setCallback(callback);
+  SmallReceiver::enableReceiver();
+  TinyReceiver::enableReceiver();
+
+  // the frame is queued by the instantiation that received the edges
+  now += 20000;
+  SmallReceiver::handleEdge(now);
+  check("frame", feed<SmallReceiver>(pulses, length) == EDGE_FRAME);
+  check("own queue", (SmallReceiver::nextPulseTrainLength() == length) &&
+                         (ESPiLight::nextPulseTrainLength() == 0));
+  rf.loop();
+  check("decoded", received.length() > 0);
+
+  // two slots
+#ifdef RECEIVER_TELEMETRY
+  ReceiverTelemetry_t telemetry;
+  SmallReceiver::getReceiverTelemetry(telemetry);
+#endif
+  check("second slot", feed<SmallReceiver>(pulses, length) == EDGE_FRAME);
+#ifdef RECEIVER_TELEMETRY
+  SmallReceiver::getReceiverTelemetry(telemetry);
+  check("one queued", telemetry.queueHighWater == 1);
+#endif
+  check("third slot", feed<SmallReceiver>(pulses, length) == EDGE_FRAME);
+  check("full", feed<SmallReceiver>(pulses, length) == EDGE_DROPPED);
+#ifdef RECEIVER_TELEMETRY
+  SmallReceiver::getReceiverTelemetry(telemetry);
+  check("two queued", telemetry.queueHighWater == 2);
+#endif
+  check("dequeue", (SmallReceiver::receivePulseTrain(queued) == length) &&
+                       (SmallReceiver::receivePulseTrain(queued) == length) &&
+                       (SmallReceiver::receivePulseTrain(queued) == 0));
+
+  // frames longer than the slots are rejected
+  now += 20000;
+  TinyReceiver::handleEdge(now);
+  check("too long", feed<TinyReceiver>(pulses, length) == EDGE_REJECTED);
+  check("tiny queue", TinyReceiver::nextPulseTrainLength() == 0);
+}
+
+void loop() {
+  // nothing
+}
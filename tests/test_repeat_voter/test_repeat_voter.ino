@@ -0,0 +1,79 @@
+/*
+ Basic ESPiLight repeat voting test
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+#include <tools/repeatvoter.h>
+
+#define PROTOCOL "elro_800_switch"
+#define JMESSAGE "{\"systemcode\":17,\"unitcode\":1,\"on\":1}"
+#define JMESSAGE2 "{\"systemcode\":17,\"unitcode\":2,\"on\":1}"
+
+ESPiLight rf(-1);  // use -1 to disable transmitter
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+bool equal(const uint16_t *a, const uint16_t *b, int length) {
+  for (int i = 0; i < length; i++) {
+    if (a[i] != b[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  uint16_t other[MAXPULSESTREAMLENGTH];
+  uint16_t repeat[MAXPULSESTREAMLENGTH];
+  int length = rf.createPulseTrain(pulses, PROTOCOL, JMESSAGE);
+  rf.createPulseTrain(other, PROTOCOL, JMESSAGE2);
+  RepeatVoter voter(5, 500000);
+  check("allocated", voter.valid());
+
+  // every repeat has a single glitch at another pulse
+  for (int i = 0; i < 3; i++) {
+    memcpy(repeat, pulses, length * sizeof(uint16_t));
+    repeat[4 + 8 * i] = 3000;
+    voter.add(repeat, length, 1000 + i * 20000);
+  }
+  uint16_t *consensus = voter.vote();
+  check("glitches", consensus != nullptr && equal(consensus, pulses, length));
+
+  // a different code starts a new group
+  voter.add(other, length, 80000);
+  check("other code", voter.vote() == nullptr);
+  voter.add(other, length, 100000);
+  voter.add(other, length, 120000);
+  consensus = voter.vote();
+  check("other code group",
+        consensus != nullptr && equal(consensus, other, length));
+
+  // a cleared buffer does not mix in older pulse trains
+  voter.clear();
+  for (int i = 0; i < 3; i++) {
+    voter.add(pulses, length, 140000 + i * 20000);
+  }
+  consensus = voter.vote();
+  check("cleared", consensus != nullptr && equal(consensus, pulses, length));
+
+  // window expired
+  voter.add(pulses, length, 2000000);
+  check("window", voter.vote() == nullptr);
+
+  // less than MIN_VOTES repeats can never vote
+  check("depth", !rf.setRepeatVoting(RepeatVoter::MIN_VOTES - 1) &&
+                     rf.setRepeatVoting(RepeatVoter::MIN_VOTES) &&
+                     rf.setRepeatVoting(0));
+}
+
+void loop() {
+  // nothing
+}
@@ -0,0 +1,110 @@
+/*
+ Basic ESPiLight streaming decoder test: a frame decoded by a streaming
+ decoder is not decoded again by the pilight protocol of the same name
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+#include <tools/edgecapture.h>
+#include <tools/streamdecoder.h>
+
+#define PROTOCOL "elro_800_switch"
+#define JMESSAGE "{\"systemcode\":17,\"unitcode\":1,\"on\":1}"
+#define SMESSAGE "{\"streamed\":1}"
+
+ESPiLight rf(-1);     // use -1 to disable transmitter
+ESPiLight other(-1);  // without streaming decoder
+unsigned long now = 100000;
+bool accept = true;
+int streamed = 0;
+int decoded = 0;
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+bool format(uint64_t value, String &message) {
+  message = SMESSAGE;
+  return accept;
+}
+
+void callback(const String &protocol, const String &message, int status,
+              size_t repeats, const String &deviceID) {
+  if (protocol != PROTOCOL) {
+    return;
+  }
+  if (message == SMESSAGE) {
+    streamed++;
+  } else {
+    decoded++;
+  }
+}
+
+void receive(const uint16_t *pulses, int length) {
+  // a gap between the frames, the streaming decoder repeats otherwise
+  now += 1000000;
+  ESPiLight::handleEdge(now);
+  for (int i = 0; i < length; i++) {
+    now += pulses[i];
+    ESPiLight::handleEdge(now);
+  }
+  streamed = 0;
+  decoded = 0;
+  rf.loop();
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  const int length = rf.createPulseTrain(pulses, PROTOCOL, JMESSAGE);
+  // the protocol sends pairs of a short and a long pulse
+  const bool shortFirst = pulses[0] < pulses[1];
+  const uint16_t shortPulse = shortFirst ? pulses[0] : pulses[1];
+  const uint16_t longPulse = shortFirst ? pulses[1] : pulses[0];
+  PwmStreamDecoder decoder(PROTOCOL, (uint8_t)((length - 2) / 2), shortPulse,
+                           longPulse, format);
+  rf.setCallback(callback);
+  other.setCallback(callback);
+  rf.addStreamingDecoder(&decoder);
+  ESPiLight::enableReceiver();
+
+  receive(pulses, length);
+  check("streamed", streamed == 1);
+  check("batch skipped", decoded == 0);
+
+  // the skip is consumed by the frame
+  decoded = 0;
+  rf.parsePulseTrain(pulses, (uint8_t)length);
+  check("next frame", decoded == 1);
+
+  // the skip belongs to the instance of the streaming decoder
+  receive(pulses, length);
+  decoded = 0;
+  other.parsePulseTrain(pulses, (uint8_t)length);
+  check("other instance", decoded == 1);
+
+  // rejected by the streaming decoder
+  accept = false;
+  receive(pulses, length);
+  check("not streamed", streamed == 0);
+  check("batch decoded", decoded == 1);
+
+  // a replay skips the streamed frame like loop()
+  accept = true;
+  EdgeReplay replay(rf);
+  streamed = 0;
+  decoded = 0;
+  replay.feed(1000000);
+  for (int i = 0; i < length; i++) {
+    replay.feed(pulses[i]);
+  }
+  replay.finish();
+  check("replay", (streamed == 1) && (decoded == 0));
+}
+
+void loop() {
+  // nothing
+}
@@ -0,0 +1,87 @@
+/*
+ Basic ESPiLight string codec test
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+#include <StreamString.h>
+
+#define PROTOCOL "elro_800_switch"
+#define JMESSAGE "{\"systemcode\":17,\"unitcode\":1,\"on\":1}"
+
+ESPiLight rf(-1);  // use -1 to disable transmitter
+
+bool equalPulseTrains(const uint16_t *a, int alength, const uint16_t *b,
+                      int blength) {
+  if (alength != blength) {
+    return false;
+  }
+  for (int i = 0; i < alength; i++) {
+    if (a[i] != b[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  int length = 0;
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  uint16_t decoded[MAXPULSESTREAMLENGTH];
+  char buffer[MAXPULSESTREAMLENGTH + 6 * MAX_PULSE_TYPES + 7];
+
+  // pulse train from pilight json message
+  length = rf.createPulseTrain(pulses, PROTOCOL, JMESSAGE);
+  String data = rf.pulseTrainToString(pulses, length);
+  Serial.print("string format: ");
+  Serial.println(data);
+
+  // encoder into buffer and Print give the same string
+  size_t size = rf.pulseTrainToString(pulses, length, buffer, sizeof(buffer));
+  check("buffer encoder", size == data.length() && data == buffer);
+  StreamString stream;
+  check("Print encoder", rf.pulseTrainToString(pulses, length, stream) ==
+                             size && stream == data);
+  check("buffer too small",
+        rf.pulseTrainToString(pulses, length, buffer, size) == 0);
+
+  // decoders of String, buffer and Stream give the same pulse train
+  int dlength = rf.stringToPulseTrain(data, decoded, MAXPULSESTREAMLENGTH);
+  String redata = rf.pulseTrainToString(decoded, dlength);
+  check("String round trip", redata == data);
+  dlength = rf.stringToPulseTrain(data.c_str(), data.length(), decoded,
+                                  MAXPULSESTREAMLENGTH);
+  check("buffer decoder", rf.pulseTrainToString(decoded, dlength) == data);
+  dlength = rf.stringToPulseTrain(stream, decoded, MAXPULSESTREAMLENGTH);
+  check("Stream decoder", rf.pulseTrainToString(decoded, dlength) == data);
+  int rlength = rf.stringToPulseTrain(redata, pulses, MAXPULSESTREAMLENGTH);
+  check("decoded pulses",
+        equalPulseTrains(pulses, rlength, decoded, dlength));
+
+  // output is limited by maxlength, not by the string index
+  check("maxlength", rf.stringToPulseTrain(data, decoded, 10) == 10);
+
+  // invalid strings
+  check("missing c", rf.stringToPulseTrain("p:300,900@", decoded, 10) ==
+                         ESPiLight::ERROR_INVALID_PULSETRAIN_MSG_C);
+  check("missing p", rf.stringToPulseTrain("c:0101@", decoded, 10) ==
+                         ESPiLight::ERROR_INVALID_PULSETRAIN_MSG_P);
+  check("missing end", rf.stringToPulseTrain("c:0101;p:300,900", decoded,
+                                             10) ==
+                           ESPiLight::ERROR_INVALID_PULSETRAIN_MSG_END);
+  check("undefined type", rf.stringToPulseTrain("c:0121;p:300,900@", decoded,
+                                                10) ==
+                              ESPiLight::ERROR_INVALID_PULSETRAIN_MSG_TYPE);
+}
+
+void loop() {
+  // nothing
+}
@@ -0,0 +1,67 @@
+/*
+ Basic ESPiLight warm start test
+
+ https://github.com/puuu/espilight
+*/
+
+#include <ESPiLight.h>
+
+#define PROTOCOL "elro_800_switch"
+#define JMESSAGE "{\"systemcode\":17,\"unitcode\":1,\"on\":1}"
+
+int lastStatus = -1;
+
+void rfCallback(const String &protocol, const String &message, int status,
+                size_t repeats, const String &deviceID) {
+  lastStatus = status;
+}
+
+void check(const char *name, bool result) {
+  Serial.print(name);
+  Serial.println(result ? ": OK" : ": FAILED");
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  uint16_t pulses[MAXPULSESTREAMLENGTH];
+  uint8_t buffer[256];
+  uint8_t small[256];
+
+  ESPiLight rf(-1);  // use -1 to disable transmitter
+  rf.setCallback(rfCallback);
+  ESPiLight::limitProtocols("[\"" PROTOCOL "\"]");
+  int length = rf.createPulseTrain(pulses, PROTOCOL, JMESSAGE);
+  rf.parsePulseTrain(pulses, length);
+  check("first message", lastStatus == FIRST);
+
+  size_t size = rf.saveState(buffer, sizeof(buffer));
+  Serial.print("snapshot size: ");
+  Serial.println(size);
+  check("snapshot", size > 0);
+  check("buffer too small", rf.saveState(small, size - 1) == 0);
+  check("truncated", ESPiLight::restoreState(buffer, 5) ==
+                         ESPiLight::ERROR_INVALID_STATE_TRUNCATED);
+  buffer[8] ^= 1;
+  check("checksum", ESPiLight::restoreState(buffer, size) ==
+                        ESPiLight::ERROR_INVALID_STATE_CHECKSUM);
+  buffer[8] ^= 1;
+  buffer[2] = 0;
+  check("version", ESPiLight::restoreState(buffer, size) ==
+                       ESPiLight::ERROR_INVALID_STATE_VERSION);
+  buffer[2] = ESPiLight::STATE_SNAPSHOT_VERSION;
+
+  // the repeat detection is taken over by the next instance
+  ESPiLight::limitProtocols("[]");
+  check("restore", ESPiLight::restoreState(buffer, size, 100000) == 1);
+  check("enabled protocols",
+        ESPiLight::enabledProtocols() == "[\"" PROTOCOL "\"]");
+  ESPiLight woken(-1);
+  woken.setCallback(rfCallback);
+  woken.parsePulseTrain(pulses, length);
+  check("repeated message", lastStatus == VALID);
+}
+
+void loop() {
+  // nothing
+}